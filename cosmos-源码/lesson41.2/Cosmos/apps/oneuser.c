@@ -77,12 +77,43 @@ void skb_buff_clear(shellkbbuff_t* skb)
 	return;
 }
 
+sint_t shc_cmd_is(char_t* cmdstr, char_t* name)
+{
+	while(*name != 0)
+	{
+		if(*cmdstr != *name)
+		{
+			return 0;
+		}
+		cmdstr++;
+		name++;
+	}
+	return (0 == *cmdstr);
+}
+
+void shc_cmd_lockstat()
+{
+	hand_t hand = open_keyboard();
+	if(-1 == hand)
+	{
+		return;
+	}
+	ioctrl(hand, NULL, UART_IOCTRCD_LOCKSTAT, 0);
+	close_keyboard(hand);
+	return;
+}
+
 sint_t shc_cmd_run(char_t* cmdstr)
 {
 	if(NULL == cmdstr)
 	{
 		return -1;
 	}
+	if(shc_cmd_is(cmdstr, "lockstat"))
+	{
+		shc_cmd_lockstat();
+		return -3;
+	}
 	if(exel(cmdstr, 0) != SYSSTUSERR)
 	{
 		return 0;
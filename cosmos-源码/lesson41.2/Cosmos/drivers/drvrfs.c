@@ -13,6 +13,7 @@ void rfsdevext_t_init(rfsdevext_t *initp)
     initp->rde_stus = 0;
     initp->rde_mstart = NULL;
     initp->rde_msize = 0;
+    initp->rde_blkhint = 2;
     initp->rde_ext = NULL;
     return;
 }
@@ -22,6 +23,7 @@ void rfsdir_t_init(rfsdir_t *initp)
     initp->rdr_stus = 0;
     initp->rdr_type = RDR_NUL_TYPE;
     initp->rdr_blknr = 0;
+    initp->rdr_hnext = 0;
     for (uint_t i = 0; i < DR_NM_MAX; i++)
     {
         initp->rdr_name[i] = 0;
@@ -29,6 +31,17 @@ void rfsdir_t_init(rfsdir_t *initp)
     return;
 }
 
+void rfsdiridx_t_init(rfsdiridx_t *initp)
+{
+    initp->rdi_entnr = 0;
+    initp->rdi_freehd = 0;
+    for (uint_t i = 0; i < RFSDIR_HASH_MAX; i++)
+    {
+        initp->rdi_hash[i] = 0;
+    }
+    return;
+}
+
 void filblks_t_init(filblks_t *initp)
 {
     initp->fb_blkstart = 0;
@@ -73,6 +86,7 @@ void fimgrhd_t_init(fimgrhd_t *initp)
     }
     initp->fmd_linkpblk = 0;
     initp->fmd_linknblk = 0;
+    refcount_init(&initp->fmd_mapcnt);
     return;
 }
 
@@ -263,7 +277,15 @@ drvstus_t rfs_write(device_t *devp, void *iopack)
 
 drvstus_t rfs_lseek(device_t *devp, void *iopack)
 {
-    return DFCERRSTUS;
+    objnode_t *obp = (objnode_t *)iopack;
+    fimgrhd_t *fmp = (fimgrhd_t *)obp->on_finode;
+    //on_len是要定位到的文件偏移
+    if (fmp == NULL || obp->on_len > fmp->fmd_filesz)
+    {
+        return DFCERRSTUS;
+    }
+    obp->on_currops = obp->on_len;
+    return DFCOKSTUS;
 }
 
 drvstus_t rfs_ioctrl(device_t *devp, void *iopack)
@@ -274,6 +296,10 @@ drvstus_t rfs_ioctrl(device_t *devp, void *iopack)
 
         return rfs_del_file(devp, obp->on_fname, 0);
     }
+    if (obp->on_ioctrd == FSDEV_IOCTRCD_FILEPAGES)
+    {
+        return rfs_retn_filepages(devp, iopack);
+    }
     return DFCERRSTUS;
 }
 
@@ -336,19 +362,35 @@ drvstus_t rfs_del_file(device_t *devp, char_t *fname, uint_t flg)
 drvstus_t rfs_read_file(device_t *devp, void *iopack)
 {
     objnode_t *obp = (objnode_t *)iopack;
-    if (obp->on_finode == NULL || obp->on_buf == NULL ||
-        obp->on_bufsz != FSYS_ALCBLKSZ)
+    fimgrhd_t *fmp = (fimgrhd_t *)obp->on_finode;
+    if (fmp == NULL || obp->on_buf == NULL ||
+        obp->on_len > obp->on_bufsz)
     {
         return DFCERRSTUS;
     }
-    return rfs_readfileblk(devp, (fimgrhd_t *)obp->on_finode, obp->on_buf, obp->on_len);
+    //已经读到文件末尾,读到0个字节
+    if (obp->on_currops >= fmp->fmd_filesz)
+    {
+        obp->on_len = 0;
+        return DFCOKSTUS;
+    }
+    if (obp->on_len > (fmp->fmd_filesz - obp->on_currops))
+    {
+        obp->on_len = fmp->fmd_filesz - obp->on_currops;
+    }
+    if (rfs_readfileblk(devp, fmp, obp->on_currops, obp->on_buf, obp->on_len) == DFCERRSTUS)
+    {
+        return DFCERRSTUS;
+    }
+    obp->on_currops += obp->on_len;
+    return DFCOKSTUS;
 }
 
 drvstus_t rfs_write_file(device_t *devp, void *iopack)
 {
     objnode_t *obp = (objnode_t *)iopack;
     if (obp->on_finode == NULL || obp->on_buf == NULL ||
-        obp->on_bufsz != FSYS_ALCBLKSZ)
+        obp->on_len > obp->on_bufsz)
     {
         return DFCERRSTUS;
     }
@@ -372,6 +414,49 @@ drvstus_t rfs_open_file(device_t *devp, void *iopack)
     return DFCOKSTUS;
 }
 
+drvstus_t rfs_retn_filepages(device_t *devp, void *iopack)
+{
+    objnode_t *obp = (objnode_t *)iopack;
+    fimgrhd_t *fmp = (fimgrhd_t *)obp->on_finode;
+    adr_t *pages = (adr_t *)obp->on_buf;
+    uint_t pgnr, fblk, run = 0, blk;
+    if (fmp == NULL || pages == NULL || fmp->fmd_fileifstbkoff != FMD_FIL_DATOFF)
+    {
+        return DFCERRSTUS;
+    }
+    //on_buf是调用者给的地址数组,on_len是数组项数,返回实际的页数
+    pgnr = (fmp->fmd_filesz + FSYS_ALCBLKSZ - 1) / FSYS_ALCBLKSZ;
+    if (pgnr > obp->on_len)
+    {
+        pgnr = obp->on_len;
+    }
+    fblk = FMD_FIL_DATOFF / FSYS_ALCBLKSZ;
+    for (uint_t i = 0; i < pgnr; i++)
+    {
+        blk = rfs_fileblk_map(fmp, fblk + i, &run);
+        if (blk == 0)
+        {
+            return DFCERRSTUS;
+        }
+        pages[i] = (adr_t)ret_rfsdevblk(devp, blk);
+        if (pages[i] == NULL)
+        {
+            return DFCERRSTUS;
+        }
+    }
+    //数据块分配时没有清零,最后一页文件末尾之后可能是已删除文件的数据,不能让映射者看到
+    if (pgnr > 0 && (pgnr * FSYS_ALCBLKSZ) > fmp->fmd_filesz)
+    {
+        hal_memset((void *)(pages[pgnr - 1] + (fmp->fmd_filesz % FSYS_ALCBLKSZ)), 0,
+                   FSYS_ALCBLKSZ - (fmp->fmd_filesz % FSYS_ALCBLKSZ));
+    }
+    //映射区引用着文件,on_extp返回映射计数,映射区释放时由内存管理减1
+    refcount_inc(&fmp->fmd_mapcnt);
+    obp->on_extp = (void *)&fmp->fmd_mapcnt;
+    obp->on_len = pgnr;
+    return DFCOKSTUS;
+}
+
 drvstus_t rfs_close_file(device_t *devp, void *iopack)
 {
     objnode_t *obp = (objnode_t *)iopack;
@@ -452,53 +537,167 @@ void rfs_fmat(device_t *devp)
     return;
 }
 
+uint_t rfs_fileblk_map(fimgrhd_t *fmp, uint_t fblk, uint_t *retrun)
+{
+    for (uint_t i = 0; i < FBLKS_MAX && fmp->fmd_fleblk[i].fb_blknr != 0; i++)
+    {
+        if (fblk < fmp->fmd_fleblk[i].fb_blknr)
+        {
+            //从该块起在设备上连续的块数
+            *retrun = fmp->fmd_fleblk[i].fb_blknr - fblk;
+            return fmp->fmd_fleblk[i].fb_blkstart + fblk;
+        }
+        fblk -= fmp->fmd_fleblk[i].fb_blknr;
+    }
+    return 0;
+}
+
+bool_t rfs_extend_fileblk(device_t *devp, fimgrhd_t *fmp, uint_t blks)
+{
+    uint_t idx, goal, blk, nr = 0;
+    while (fmp->fmd_fileallbk < blks)
+    {
+        for (idx = 0; idx < (FBLKS_MAX - 1) && fmp->fmd_fleblk[idx + 1].fb_blknr != 0; idx++)
+            ;
+        //尽量紧接着最后一个区段分配,这样区段只需变长
+        goal = fmp->fmd_fleblk[idx].fb_blkstart + fmp->fmd_fleblk[idx].fb_blknr;
+        blk = rfs_new_blks(devp, goal, blks - fmp->fmd_fileallbk, &nr);
+        if (blk == 0)
+        {
+            return FALSE;
+        }
+        if (blk == goal)
+        {
+            fmp->fmd_fleblk[idx].fb_blknr += nr;
+        }
+        else if (idx < (FBLKS_MAX - 1))
+        {
+            fmp->fmd_fleblk[idx + 1].fb_blkstart = blk;
+            fmp->fmd_fleblk[idx + 1].fb_blknr = nr;
+        }
+        else
+        {
+            rfs_del_blks(devp, blk, nr);
+            return FALSE;
+        }
+        fmp->fmd_fileallbk += nr;
+    }
+    return TRUE;
+}
+
+void rfs_free_fileblk(device_t *devp, fimgrhd_t *fmp)
+{
+    for (uint_t i = 0; i < FBLKS_MAX && fmp->fmd_fleblk[i].fb_blknr != 0; i++)
+    {
+        rfs_del_blks(devp, fmp->fmd_fleblk[i].fb_blkstart, fmp->fmd_fleblk[i].fb_blknr);
+    }
+    return;
+}
+
 drvstus_t rfs_writefileblk(device_t *devp, fimgrhd_t *fmp, void *buf, uint_t len)
 {
-    if (fmp->fmd_sfblk != fmp->fmd_curfwritebk ||
-        fmp->fmd_curfwritebk != fmp->fmd_fleblk[0].fb_blkstart)
+    uint_t fpos, fblk, inoff, blk, run = 0, cpsz = 0;
+    u8_t *src = (u8_t *)buf, *dst = NULL;
+    if (fmp->fmd_type != FMD_FIL_TYPE ||
+        fmp->fmd_sfblk != fmp->fmd_fleblk[0].fb_blkstart)
+    {
+        return DFCERRSTUS;
+    }
+    //文件数据从fmd_fileifstbkoff处开始,写入总是追加在文件末尾
+    fpos = fmp->fmd_fileifstbkoff + fmp->fmd_filesz;
+    if (len == 0 || (fpos + len) < fpos)
     {
         return DFCERRSTUS;
     }
-    if ((fmp->fmd_curfinwbkoff + len) >= FSYS_ALCBLKSZ)
+    if (rfs_extend_fileblk(devp, fmp, (fpos + len + FSYS_ALCBLKSZ - 1) / FSYS_ALCBLKSZ) == FALSE)
     {
         return DFCERRSTUS;
     }
-    void *wrp = (void *)((uint_t)fmp + fmp->fmd_curfinwbkoff);
-    hal_memcpy(buf, wrp, len);
+    for (uint_t left = len; left > 0; left -= cpsz, src += cpsz, fpos += cpsz)
+    {
+        fblk = fpos / FSYS_ALCBLKSZ;
+        inoff = fpos % FSYS_ALCBLKSZ;
+        blk = rfs_fileblk_map(fmp, fblk, &run);
+        if (blk == 0)
+        {
+            return DFCERRSTUS;
+        }
+        //区段内的块在内存盘上是连续的,一次复制
+        dst = (u8_t *)ret_rfsdevblk(devp, blk);
+        if (dst == NULL)
+        {
+            return DFCERRSTUS;
+        }
+        dst += inoff;
+        cpsz = (run * FSYS_ALCBLKSZ) - inoff;
+        if (cpsz > left)
+        {
+            cpsz = left;
+        }
+        hal_memcpy((void *)src, (void *)dst, cpsz);
+    }
     fmp->fmd_filesz += len;
-    fmp->fmd_curfinwbkoff += len;
-    write_rfsdevblk(devp, (void *)fmp, fmp->fmd_curfwritebk);
+    fblk = (fpos - 1) / FSYS_ALCBLKSZ;
+    fmp->fmd_curfwritebk = rfs_fileblk_map(fmp, fblk, &run);
+    fmp->fmd_curfinwbkoff = fpos - (fblk * FSYS_ALCBLKSZ);
+    fmp->fmd_fileiendbkoff = fmp->fmd_curfinwbkoff;
     return DFCOKSTUS;
 }
 
-drvstus_t rfs_readfileblk(device_t *devp, fimgrhd_t *fmp, void *buf, uint_t len)
+drvstus_t rfs_readfileblk(device_t *devp, fimgrhd_t *fmp, uint_t fops, void *buf, uint_t len)
 {
-    if (fmp->fmd_sfblk != fmp->fmd_curfwritebk ||
-        fmp->fmd_curfwritebk != fmp->fmd_fleblk[0].fb_blkstart)
+    uint_t fpos, fblk, inoff, blk, run = 0, cpsz = 0;
+    u8_t *src = NULL, *dst = (u8_t *)buf;
+    if (fmp->fmd_type != FMD_FIL_TYPE ||
+        fmp->fmd_sfblk != fmp->fmd_fleblk[0].fb_blkstart)
     {
         return DFCERRSTUS;
     }
-    if (len > (FSYS_ALCBLKSZ - fmp->fmd_fileifstbkoff))
+    if (fops >= fmp->fmd_filesz || len > (fmp->fmd_filesz - fops))
     {
         return DFCERRSTUS;
     }
-    void *wrp = (void *)((uint_t)fmp + fmp->fmd_fileifstbkoff);
-    hal_memcpy(wrp, buf, len);
+    fpos = fmp->fmd_fileifstbkoff + fops;
+    for (uint_t left = len; left > 0; left -= cpsz, dst += cpsz, fpos += cpsz)
+    {
+        fblk = fpos / FSYS_ALCBLKSZ;
+        inoff = fpos % FSYS_ALCBLKSZ;
+        blk = rfs_fileblk_map(fmp, fblk, &run);
+        if (blk == 0)
+        {
+            return DFCERRSTUS;
+        }
+        src = (u8_t *)ret_rfsdevblk(devp, blk);
+        if (src == NULL)
+        {
+            return DFCERRSTUS;
+        }
+        src += inoff;
+        cpsz = (run * FSYS_ALCBLKSZ) - inoff;
+        if (cpsz > left)
+        {
+            cpsz = left;
+        }
+        hal_memcpy((void *)src, (void *)dst, cpsz);
+    }
     return DFCOKSTUS;
 }
 
 drvstus_t rfs_closefileblk(device_t *devp, void *fblkp)
 {
+    //文件管理头就在内存盘上,打开期间的修改已经生效,无需写回
     fimgrhd_t *fmp = (fimgrhd_t *)fblkp;
-    write_rfsdevblk(devp, fblkp, fmp->fmd_sfblk);
-    del_buf(fblkp, FSYS_ALCBLKSZ);
+    if (fmp->fmd_type != FMD_FIL_TYPE)
+    {
+        return DFCERRSTUS;
+    }
     return DFCOKSTUS;
 }
 
 void *rfs_openfileblk(device_t *devp, char_t *fname)
 {
     char_t fne[DR_NM_MAX];
-    void *rets = NULL, *buf = NULL;
+    void *rets = NULL;
     hal_memset((void *)fne, 0, DR_NM_MAX);
     if (rfs_ret_fname(fne, fname) != 0)
     {
@@ -518,52 +717,21 @@ void *rfs_openfileblk(device_t *devp, char_t *fname)
         rets = NULL;
         goto err;
     }
-    if (fmp->fmd_curfwritebk == fmp->fmd_fleblk[0].fb_blkstart &&
-        fmp->fmd_curfinwbkoff == fmp->fmd_fileifstbkoff)
+    rfsdir_t *dirp = rfs_dir_lookup(devp, fmp, fne, RDR_FIL_TYPE, NULL);
+    if (dirp == NULL)
     {
         rets = NULL;
         goto err;
     }
-    rfsdir_t *dirp = (rfsdir_t *)((uint_t)(fmp) + fmp->fmd_fileifstbkoff);
-    void *maxchkp = (void *)((uint_t)rblkp + FSYS_ALCBLKSZ - 1);
-    for (; (void *)dirp < maxchkp;)
-    {
-        if (dirp->rdr_type == RDR_FIL_TYPE)
-        {
-
-            if (rfs_strcmp(dirp->rdr_name, fne) == 1)
-            {
-                goto opfblk;
-            }
-        }
-        dirp++;
-    }
-
-    rets = NULL;
-    goto err;
-opfblk:
-    buf = new_buf(FSYS_ALCBLKSZ);
-    if (buf == NULL)
+    //直接返回内存盘上的文件管理头,不再复制一份
+    fimgrhd_t *ffmp = (fimgrhd_t *)ret_rfsdevblk(devp, dirp->rdr_blknr);
+    if (ffmp == NULL || ffmp->fmd_type == FMD_NUL_TYPE ||
+        ffmp->fmd_fileifstbkoff != FMD_FIL_DATOFF)
     {
         rets = NULL;
         goto err;
     }
-    if (read_rfsdevblk(devp, buf, dirp->rdr_blknr) == DFCERRSTUS)
-    {
-        rets = NULL;
-        goto err1;
-    }
-    fimgrhd_t *ffmp = (fimgrhd_t *)buf;
-    if (ffmp->fmd_type == FMD_NUL_TYPE || ffmp->fmd_fileifstbkoff != 0x200)
-    {
-        rets = NULL;
-        goto err1;
-    }
-    rets = buf;
-    goto err;
-
-err1:
-    del_buf(buf, FSYS_ALCBLKSZ);
+    rets = (void *)ffmp;
 err:
     del_rootdirfile_blk(devp, rblkp);
     return rets;
@@ -576,14 +744,13 @@ drvstus_t rfs_new_dirfileblk(device_t *devp, char_t *fname, uint_t flgtype, uint
     {
         return DFCERRSTUS;
     }
-    void *buf = new_buf(FSYS_ALCBLKSZ);
-    if (buf == NULL)
+    uint_t fblk = rfs_new_blk(devp);
+    if (fblk == 0)
     {
         return DFCERRSTUS;
     }
-    hal_memset(buf, 0, FSYS_ALCBLKSZ);
-    uint_t fblk = rfs_new_blk(devp);
-    if (fblk == 0)
+    void *buf = ret_rfsdevblk(devp, fblk);
+    if (buf == NULL)
     {
         rets = DFCERRSTUS;
         goto err1;
@@ -595,36 +762,34 @@ drvstus_t rfs_new_dirfileblk(device_t *devp, char_t *fname, uint_t flgtype, uint
         goto err1;
     }
     fimgrhd_t *fmp = (fimgrhd_t *)rdirblk;
-    rfsdir_t *wrdirp = (rfsdir_t *)((uint_t)rdirblk + fmp->fmd_curfinwbkoff);
-    if (((uint_t)wrdirp) >= ((uint_t)rdirblk + FSYS_ALCBLKSZ))
+    rfsdir_t *wrdirp = rfs_dir_new_entry(devp, fmp, fname);
+    if (wrdirp == NULL)
     {
         rets = DFCERRSTUS;
         goto err;
     }
-    wrdirp->rdr_stus = 0;
     wrdirp->rdr_type = flgtype;
     wrdirp->rdr_blknr = fblk;
-    rfs_strcpy(fname, wrdirp->rdr_name);
-    fmp->fmd_filesz += (uint_t)(sizeof(rfsdir_t));
-    fmp->fmd_curfinwbkoff += (uint_t)(sizeof(rfsdir_t));
+    //文件管理头直接建在内存盘的块上
+    hal_memset(buf, 0, FSYS_ALCBLKSZ);
     fimgrhd_t *ffmp = (fimgrhd_t *)buf;
     fimgrhd_t_init(ffmp);
     ffmp->fmd_type = FMD_FIL_TYPE;
     ffmp->fmd_sfblk = fblk;
+    ffmp->fmd_fileifstbkoff = FMD_FIL_DATOFF;
     ffmp->fmd_curfwritebk = fblk;
-    ffmp->fmd_curfinwbkoff = 0x200;
+    ffmp->fmd_curfinwbkoff = FMD_FIL_DATOFF;
     ffmp->fmd_fleblk[0].fb_blkstart = fblk;
     ffmp->fmd_fleblk[0].fb_blknr = 1;
-    if (write_rfsdevblk(devp, buf, fblk) == DFCERRSTUS)
-    {
-        rets = DFCERRSTUS;
-        goto err;
-    }
+    ffmp->fmd_fileallbk = 1;
     rets = DFCOKSTUS;
 err:
     del_rootdirfile_blk(devp, rdirblk);
 err1:
-    del_buf(buf, FSYS_ALCBLKSZ);
+    if (rets == DFCERRSTUS)
+    {
+        rfs_del_blk(devp, fblk);
+    }
     return rets;
 }
 
@@ -650,6 +815,7 @@ drvstus_t rfs_del_dirfileblk(device_t *devp, char_t *fname, uint_t flgtype, uint
 sint_t del_dirfileblk_core(device_t *devp, char_t *fname)
 {
     sint_t rets = 6;
+    uint_t idx = 0;
     void *rblkp = get_rootdirfile_blk(devp);
     if (rblkp == NULL)
     {
@@ -663,36 +829,167 @@ sint_t del_dirfileblk_core(device_t *devp, char_t *fname)
         rets = 4;
         goto err;
     }
-    if (fmp->fmd_curfwritebk == fmp->fmd_fleblk[0].fb_blkstart &&
-        fmp->fmd_curfinwbkoff == fmp->fmd_fileifstbkoff)
+    rfsdir_t *dirp = rfs_dir_lookup(devp, fmp, fname, RDR_FIL_TYPE, &idx);
+    if (dirp == NULL)
     {
-        rets = 3;
+        rets = 1;
+        goto err;
+    }
+    //释放文件所有区段,文件管理头所在块就在第一个区段中
+    fimgrhd_t *ffmp = (fimgrhd_t *)ret_rfsdevblk(devp, dirp->rdr_blknr);
+    //文件的数据页还被映射着,释放了块就会被别的文件用掉
+    if (ffmp != NULL && ffmp->fmd_type == FMD_FIL_TYPE &&
+        refcount_read(&ffmp->fmd_mapcnt) > 0)
+    {
+        rets = 7;
         goto err;
     }
-    rfsdir_t *dirp = (rfsdir_t *)((uint_t)(fmp) + fmp->fmd_fileifstbkoff);
-    void *maxchkp = (void *)((uint_t)rblkp + FSYS_ALCBLKSZ - 1);
-    for (; (void *)dirp < maxchkp;)
+    if (ffmp != NULL && ffmp->fmd_type == FMD_FIL_TYPE &&
+        ffmp->fmd_fleblk[0].fb_blkstart == dirp->rdr_blknr)
+    {
+        rfs_free_fileblk(devp, ffmp);
+    }
+    else
     {
-        if (dirp->rdr_type == RDR_FIL_TYPE)
+        rfs_del_blk(devp, dirp->rdr_blknr);
+    }
+    rfs_dir_del_entry(devp, fmp, idx);
+    rets = 0;
+err:
+    del_rootdirfile_blk(devp, rblkp);
+    return rets;
+}
+
+uint_t rfs_dir_hash(char_t *fname)
+{
+    uint_t h = 0;
+    while (*fname != 0)
+    {
+        h = (h * 31) + (u8_t)(*fname);
+        fname++;
+    }
+    return h % RFSDIR_HASH_MAX;
+}
+
+rfsdir_t *rfs_dir_retn_entry(device_t *devp, fimgrhd_t *dfmp, uint_t idx)
+{
+    uint_t run = 0;
+    uint_t pos = dfmp->fmd_fileifstbkoff + (idx * (uint_t)sizeof(rfsdir_t));
+    uint_t blk = rfs_fileblk_map(dfmp, pos / FSYS_ALCBLKSZ, &run);
+    if (blk == 0)
+    {
+        return NULL;
+    }
+    u8_t *p = (u8_t *)ret_rfsdevblk(devp, blk);
+    if (p == NULL)
+    {
+        return NULL;
+    }
+    return (rfsdir_t *)(p + (pos % FSYS_ALCBLKSZ));
+}
+
+rfsdir_t *rfs_dir_lookup(device_t *devp, fimgrhd_t *dfmp, char_t *fname, uint_t type, uint_t *retidx)
+{
+    rfsdiridx_t *dip = (rfsdiridx_t *)((uint_t)dfmp + RFSDIR_IDXOFF);
+    rfsdir_t *dirp = NULL;
+    //只比较同一个散列链上的目录项
+    for (uint_t ent = dip->rdi_hash[rfs_dir_hash(fname)]; ent != 0; ent = dirp->rdr_hnext)
+    {
+        dirp = rfs_dir_retn_entry(devp, dfmp, ent - 1);
+        if (dirp == NULL)
         {
+            return NULL;
+        }
+        if (dirp->rdr_type == type && rfs_strcmp(dirp->rdr_name, fname) == 1)
+        {
+            if (retidx != NULL)
+            {
+                *retidx = ent - 1;
+            }
+            return dirp;
+        }
+    }
+    return NULL;
+}
 
-            if (rfs_strcmp(dirp->rdr_name, fname) == 1)
+rfsdir_t *rfs_dir_new_entry(device_t *devp, fimgrhd_t *dfmp, char_t *fname)
+{
+    rfsdiridx_t *dip = (rfsdiridx_t *)((uint_t)dfmp + RFSDIR_IDXOFF);
+    rfsdir_t *dirp = NULL;
+    uint_t idx, h, blks;
+    if (dip->rdi_freehd != 0)
+    {
+        //先用删除后留下的目录项
+        idx = dip->rdi_freehd - 1;
+        dirp = rfs_dir_retn_entry(devp, dfmp, idx);
+        if (dirp == NULL)
+        {
+            return NULL;
+        }
+        dip->rdi_freehd = dirp->rdr_hnext;
+    }
+    else
+    {
+        idx = dip->rdi_entnr;
+        blks = (dfmp->fmd_fileifstbkoff + ((idx + 1) * (uint_t)sizeof(rfsdir_t)) +
+                FSYS_ALCBLKSZ - 1) / FSYS_ALCBLKSZ;
+        if (dfmp->fmd_fileallbk < blks)
+        {
+            //按RFSDIR_GROW_BLKS成批增长,分不到整批时有够用的块也行
+            rfs_extend_fileblk(devp, dfmp, blks + RFSDIR_GROW_BLKS - 1);
+            if (dfmp->fmd_fileallbk < blks)
             {
-                rfs_del_blk(devp, dirp->rdr_blknr);
-                rfsdir_t_init(dirp);
-                dirp->rdr_type = RDR_DEL_TYPE;
-                rets = 0;
-                goto err;
+                return NULL;
             }
         }
-        dirp++;
+        dirp = rfs_dir_retn_entry(devp, dfmp, idx);
+        if (dirp == NULL)
+        {
+            return NULL;
+        }
+        dip->rdi_entnr++;
+        dfmp->fmd_filesz += (uint_t)(sizeof(rfsdir_t));
     }
-    rets = 1;
-err:
-    del_rootdirfile_blk(devp, rblkp);
-    return rets;
+    rfsdir_t_init(dirp);
+    rfs_strcpy(fname, dirp->rdr_name);
+    h = rfs_dir_hash(fname);
+    dirp->rdr_hnext = dip->rdi_hash[h];
+    dip->rdi_hash[h] = idx + 1;
+    return dirp;
+}
+
+void rfs_dir_del_entry(device_t *devp, fimgrhd_t *dfmp, uint_t idx)
+{
+    rfsdiridx_t *dip = (rfsdiridx_t *)((uint_t)dfmp + RFSDIR_IDXOFF);
+    rfsdir_t *dirp = rfs_dir_retn_entry(devp, dfmp, idx);
+    rfsdir_t *prev = NULL;
+    if (dirp == NULL)
+    {
+        return;
+    }
+    uint_t *pp = &dip->rdi_hash[rfs_dir_hash(dirp->rdr_name)];
+    while (*pp != 0 && *pp != (idx + 1))
+    {
+        prev = rfs_dir_retn_entry(devp, dfmp, *pp - 1);
+        if (prev == NULL)
+        {
+            return;
+        }
+        pp = &prev->rdr_hnext;
+    }
+    if (*pp == 0)
+    {
+        return;
+    }
+    *pp = dirp->rdr_hnext;
+    rfsdir_t_init(dirp);
+    dirp->rdr_type = RDR_DEL_TYPE;
+    dirp->rdr_hnext = dip->rdi_freehd;
+    dip->rdi_freehd = idx + 1;
+    return;
 }
 
+//内存盘的块可以直接访问,get_XXX返回块在内存盘上的地址,del_XXX不再写回和释放
 void *get_rootdirfile_blk(device_t *devp)
 {
     void *retptr = NULL;
@@ -701,36 +998,18 @@ void *get_rootdirfile_blk(device_t *devp)
     {
         return NULL;
     }
-    void *buf = new_buf(FSYS_ALCBLKSZ);
-    if (buf == NULL)
-    {
-        retptr = NULL;
-        goto errl1;
-    }
-    hal_memset(buf, 0, FSYS_ALCBLKSZ);
-    if (read_rfsdevblk(devp, buf, rtdir->rdr_blknr) == DFCERRSTUS)
-    {
-        retptr = NULL;
-        goto errl;
-    }
-    retptr = buf;
-    goto errl1;
-errl:
-    del_buf(buf, FSYS_ALCBLKSZ);
-errl1:
+    retptr = ret_rfsdevblk(devp, rtdir->rdr_blknr);
     del_rootdir(devp, rtdir);
-
     return retptr;
 }
 
 void del_rootdirfile_blk(device_t *devp, void *blkp)
 {
     fimgrhd_t *fmp = (fimgrhd_t *)blkp;
-    if (write_rfsdevblk(devp, blkp, fmp->fmd_sfblk) == DFCERRSTUS)
+    if (fmp->fmd_type != FMD_DIR_TYPE)
     {
         hal_sysdie("del_rootfile_blk err");
     }
-    del_buf(blkp, FSYS_ALCBLKSZ);
     return;
 }
 
@@ -763,27 +1042,15 @@ void del_rootdir(device_t *devp, rfsdir_t *rdir)
 
 rfssublk_t *get_superblk(device_t *devp)
 {
-    void *buf = new_buf(FSYS_ALCBLKSZ);
-    if (buf == NULL)
-    {
-        return NULL;
-    }
-    hal_memset(buf, 0, FSYS_ALCBLKSZ);
-    if (read_rfsdevblk(devp, buf, 0) == DFCERRSTUS)
-    {
-        del_buf(buf, FSYS_ALCBLKSZ);
-        return NULL;
-    }
-    return (rfssublk_t *)buf;
+    return (rfssublk_t *)ret_rfsdevblk(devp, 0);
 }
 
 void del_superblk(device_t *devp, rfssublk_t *sbp)
 {
-    if (write_rfsdevblk(devp, (void *)sbp, 0) == DFCERRSTUS)
+    if (sbp != (rfssublk_t *)ret_rfsdevblk(devp, 0))
     {
         hal_sysdie("del superblk err");
     }
-    del_buf((void *)sbp, FSYS_ALCBLKSZ);
     return;
 }
 
@@ -794,58 +1061,93 @@ u8_t *get_bitmapblk(device_t *devp)
     {
         return NULL;
     }
-    void *buf = new_buf(FSYS_ALCBLKSZ);
-    if (buf == NULL)
-    {
-        return NULL;
-    }
-    hal_memset(buf, 0, FSYS_ALCBLKSZ);
-    if (read_rfsdevblk(devp, buf, sbp->rsb_bmpbks) == DFCERRSTUS)
-    {
-        del_buf(buf, FSYS_ALCBLKSZ);
-        del_superblk(devp, sbp);
-        return NULL;
-    }
+    u8_t *bitmap = (u8_t *)ret_rfsdevblk(devp, sbp->rsb_bmpbks);
     del_superblk(devp, sbp);
-    return (u8_t *)buf;
+    return bitmap;
 }
 
 void del_bitmapblk(device_t *devp, u8_t *bitmap)
 {
-    rfssublk_t *sbp = get_superblk(devp);
-    if (sbp == NULL)
-    {
-        hal_sysdie("del superblk err");
-        return;
-    }
-    if (write_rfsdevblk(devp, (void *)bitmap, sbp->rsb_bmpbks) == DFCERRSTUS)
+    if (bitmap == NULL)
     {
-        del_superblk(devp, sbp);
-        hal_sysdie("del superblk err1");
+        hal_sysdie("del bitmap err");
     }
-    del_superblk(devp, sbp);
-    del_buf((void *)bitmap, FSYS_ALCBLKSZ);
     return;
 }
 
 uint_t rfs_new_blk(device_t *devp)
 {
-    uint_t retblk = 0;
+    uint_t nr = 0;
+    return rfs_new_blks(devp, 0, 1, &nr);
+}
+
+uint_t rfs_new_blks(device_t *devp, uint_t goal, uint_t nr, uint_t *retnr)
+{
+    uint_t retblk = 0, blknr, wnr, wi, maxblk = ret_rfsdevmaxblknr(devp);
+    u64_t fw;
+    rfsdevext_t *rfsexp = ret_rfsdevext(devp);
+    if (nr == 0 || retnr == NULL)
+    {
+        return 0;
+    }
+    if (maxblk > FSYS_BMPBITS)
+    {
+        maxblk = FSYS_BMPBITS;
+    }
     u8_t *bitmap = get_bitmapblk(devp);
     if (bitmap == NULL)
     {
         return 0;
     }
-    for (uint_t blknr = 2; blknr < FSYS_ALCBLKSZ; blknr++)
+    u64_t *bmpw = (u64_t *)bitmap;
+    //调用者希望的块空闲就用它,哪怕只有一块
+    if (goal > 1 && goal < maxblk && (bitmap[goal >> 3] & (1 << (goal & 7))) == 0)
+    {
+        retblk = goal;
+        goto alcl;
+    }
+    //从上次分配结束处按64位字扫描,跳过全满的字,到尾部后回绕
+    blknr = rfsexp->rde_blkhint;
+    if (blknr < 2 || blknr >= maxblk)
+    {
+        blknr = 2;
+    }
+    wnr = (maxblk + 63) >> 6;
+    for (uint_t k = 0; k <= wnr; k++)
     {
-        if (bitmap[blknr] == 0)
+        wi = ((blknr >> 6) + k) % wnr;
+        fw = ~bmpw[wi];
+        if (k == 0)
+        {
+            fw &= (~0UL) << (blknr & 63);
+        }
+        else if (k == wnr)
+        {
+            fw &= ~((~0UL) << (blknr & 63));
+        }
+        if (fw == 0)
         {
-            bitmap[blknr] = 1;
-            retblk = blknr;
-            goto retl;
+            continue;
+        }
+        retblk = (wi << 6) + (uint_t)(search_64rlbits(fw & (~fw + 1)) - 1);
+        if (retblk < maxblk)
+        {
+            goto alcl;
         }
     }
     retblk = 0;
+    goto retl;
+alcl:
+    for (blknr = retblk; blknr < (retblk + nr) && blknr < maxblk; blknr++)
+    {
+        if ((bitmap[blknr >> 3] & (1 << (blknr & 7))) != 0)
+        {
+            break;
+        }
+        bitmap[blknr >> 3] |= (u8_t)(1 << (blknr & 7));
+    }
+    *retnr = blknr - retblk;
+    rfsexp->rde_blkhint = blknr;
 retl:
     del_bitmapblk(devp, bitmap);
     return retblk;
@@ -853,7 +1155,13 @@ retl:
 
 void rfs_del_blk(device_t *devp, uint_t blknr)
 {
-    if (blknr > FSYS_ALCBLKSZ)
+    rfs_del_blks(devp, blknr, 1);
+    return;
+}
+
+void rfs_del_blks(device_t *devp, uint_t blkstart, uint_t nr)
+{
+    if (blkstart < 2 || (blkstart + nr) > FSYS_BMPBITS || (blkstart + nr) < blkstart)
     {
         hal_sysdie("rfs del blk err");
         return;
@@ -865,7 +1173,10 @@ void rfs_del_blk(device_t *devp, uint_t blknr)
         hal_sysdie("rfs del blk err1");
         return;
     }
-    bitmap[blknr] = 0;
+    for (uint_t blknr = blkstart; blknr < (blkstart + nr); blknr++)
+    {
+        bitmap[blknr >> 3] &= (u8_t)(~(1 << (blknr & 7)));
+    }
     del_bitmapblk(devp, bitmap);
     return;
 }
@@ -930,27 +1241,11 @@ sint_t rfs_chkfileisindev(device_t *devp, char_t *fname)
         rets = 3;
         goto err;
     }
-    if (fmp->fmd_curfwritebk == fmp->fmd_fleblk[0].fb_blkstart &&
-        fmp->fmd_curfinwbkoff == fmp->fmd_fileifstbkoff)
+    if (rfs_dir_lookup(devp, fmp, fname, RDR_FIL_TYPE, NULL) != NULL)
     {
-        rets = 0;
+        rets = 1;
         goto err;
     }
-    rfsdir_t *dirp = (rfsdir_t *)((uint_t)(fmp) + fmp->fmd_fileifstbkoff);
-    void *maxchkp = (void *)((uint_t)rdblkp + FSYS_ALCBLKSZ - 1);
-    for (; (void *)dirp < maxchkp;)
-    {
-        if (dirp->rdr_type == RDR_FIL_TYPE)
-        {
-
-            if (rfs_strcmp(dirp->rdr_name, fname) == 1)
-            {
-                rets = 1;
-                goto err;
-            }
-        }
-        dirp++;
-    }
     rets = 0;
 err:
     del_rootdirfile_blk(devp, rdblkp);
@@ -991,17 +1286,18 @@ bool_t create_bitmap(device_t *devp)
     }
     uint_t bitmapblk = sbp->rsb_bmpbks;
     uint_t devmaxblk = sbp->rsb_fsysallblk;
-    if (devmaxblk > FSYS_ALCBLKSZ)
+    if (devmaxblk > FSYS_BMPBITS)
     {
         rets = FALSE;
         goto errlable;
     }
 
-    hal_memset(buf, 1, FSYS_ALCBLKSZ);
+    //每位对应一块,置位表示已占用,超级块、位图块和设备外的块都置位
+    hal_memset(buf, 0xff, FSYS_ALCBLKSZ);
     u8_t *bitmap = (u8_t *)buf;
     for (uint_t bi = 2; bi < devmaxblk; bi++)
     {
-        bitmap[bi] = 0;
+        bitmap[bi >> 3] &= (u8_t)(~(1 << (bi & 7)));
     }
     if (write_rfsdevblk(devp, buf, bitmapblk) == DFCERRSTUS)
     {
@@ -1023,19 +1319,19 @@ bool_t create_rootdir(device_t *devp)
     {
         return FALSE;
     }
-    void *buf = new_buf(FSYS_ALCBLKSZ);
-    if (buf == NULL)
+    uint_t blk = rfs_new_blk(devp);
+    if (blk == 0)
     {
         rets = FALSE;
-        goto errlable1;
+        goto errlable;
     }
-    hal_memset(buf, 0, FSYS_ALCBLKSZ);
-    uint_t blk = rfs_new_blk(devp);
-    if (blk == 0)
+    void *buf = ret_rfsdevblk(devp, blk);
+    if (buf == NULL)
     {
         rets = FALSE;
         goto errlable;
     }
+    hal_memset(buf, 0, FSYS_ALCBLKSZ);
     sbp->rsb_rootdir.rdr_name[0] = '/';
     sbp->rsb_rootdir.rdr_type = RDR_DIR_TYPE;
     sbp->rsb_rootdir.rdr_blknr = blk;
@@ -1043,21 +1339,16 @@ bool_t create_rootdir(device_t *devp)
     fimgrhd_t_init(fmp);
     fmp->fmd_type = FMD_DIR_TYPE;
     fmp->fmd_sfblk = blk;
+    fmp->fmd_fileifstbkoff = FMD_FIL_DATOFF;
     fmp->fmd_curfwritebk = blk;
-    fmp->fmd_curfinwbkoff = 0x200;
+    fmp->fmd_curfinwbkoff = FMD_FIL_DATOFF;
     fmp->fmd_fleblk[0].fb_blkstart = blk;
     fmp->fmd_fleblk[0].fb_blknr = 1;
-    if (write_rfsdevblk(devp, buf, blk) == DFCERRSTUS)
-    {
-        rets = FALSE;
-        goto errlable;
-    }
+    fmp->fmd_fileallbk = 1;
+    rfsdiridx_t_init((rfsdiridx_t *)((uint_t)buf + RFSDIR_IDXOFF));
     rets = TRUE;
 errlable:
-    del_buf(buf, FSYS_ALCBLKSZ);
-errlable1:
     del_superblk(devp, sbp);
-
     return rets;
 }
 
@@ -1076,9 +1367,9 @@ void test_rfs_bitmap(device_t *devp)
     }
     u8_t *bmp = (u8_t *)buf;
     uint_t b = 0;
-    for (uint_t i = 0; i < FSYS_ALCBLKSZ; i++)
+    for (uint_t i = 0; i < FSYS_BMPBITS; i++)
     {
-        if (bmp[i] == 0)
+        if ((bmp[i >> 3] & (1 << (i & 7))) == 0)
         {
             b++;
         }
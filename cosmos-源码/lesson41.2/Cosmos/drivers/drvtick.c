@@ -17,6 +17,34 @@ void init_8254()
 
     return;
 }
+
+//空转时把8254改成单次计数,计完count个数只来一次中断
+void systick_set_oneshot(uint_t count)
+{
+    if (count > TIMEONESHOT_MAX)
+    {
+        count = TIMEONESHOT_MAX;
+    }
+    osktime.kt_tickless = 1;
+    out_u8_p(PTIPROTM, TIMEONESHOT);
+
+    out_u8_p(PTIPROT1, (u8_t)(count & 0xff));
+
+    out_u8_p(PTIPROT1, (u8_t)((count >> 8) & 0xff));
+
+    return;
+}
+
+void systick_set_periodic()
+{
+    if (osktime.kt_tickless == 0)
+    {
+        return;
+    }
+    osktime.kt_tickless = 0;
+    init_8254();
+    return;
+}
 void systick_set_driver(driver_t *drvp)
 {
     drvp->drv_dipfun[IOIF_CODE_OPEN] = systick_open;
@@ -99,8 +127,9 @@ drvstus_t systick_exit(driver_t *drvp, uint_t val, void *p)
 
 drvstus_t systick_handle(uint_t ift_nr, void *devp, void *sframe)
 {
+    systick_set_periodic();
     krlthd_inc_tick(krlsched_retn_currthread());
-    krlupdate_times_from_cmos();
+    krltime_tick();
     //kprint("systick_handle run devname:%s intptnr:%d\n", ((device_t *)devp)->dev_name, ift_nr);
     // hal_sysdie("systick_hand\n");
     return DFCOKSTUS;
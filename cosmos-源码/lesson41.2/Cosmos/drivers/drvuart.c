@@ -387,6 +387,12 @@ drvstus_t uart_lseek(device_t *devp, void *iopack)
 
 drvstus_t uart_ioctrl(device_t *devp, void *iopack)
 {
+    objnode_t *obp = (objnode_t *)iopack;
+    if (obp->on_ioctrd == UART_IOCTRCD_LOCKSTAT)
+    {
+        krlspinlock_stat_dump();
+        return DFCOKSTUS;
+    }
     return DFCERRSTUS;
 }
 
@@ -37,62 +37,181 @@ void hal_cpuflag_cli(cpuflg_t* cpuflg)
     restore_flags_cli(cpuflg);
 }
 
+KLINE u32_t spinlock_cmpxchg(volatile u32_t *p, u32_t old, u32_t new)
+{
+    u32_t prev;
+    __asm__ __volatile__("lock; cmpxchgl %2,%1"
+                         : "=a"(prev), "+m"(*p)
+                         : "r"(new), "0"(old)
+                         : "memory");
+    return prev;
+}
+
+KLINE void spinlock_pause()
+{
+    __asm__ __volatile__("pause" : : : "memory");
+    return;
+}
+
+KLINE spinnode_t *spinnode_retn(u32_t code)
+{
+    code--;
+    return &osspinnode[code / SPINNODE_MAX][code % SPINNODE_MAX];
+}
+
+void spinlock_stat_init(spinlock_t *lock)
+{
+#ifdef CFG_SPINLOCK_STAT
+    lock->st_rsv = 0;
+    lock->st_acquires = 0;
+    lock->st_contends = 0;
+    lock->st_holdtsc = 0;
+    lock->st_maxhold = 0;
+    lock->st_name = NULL;
+#endif
+    return;
+}
+
+void spinlock_stat_acquired(spinlock_t *lock, bool_t contended)
+{
+#ifdef CFG_SPINLOCK_STAT
+    lock->st_acquires++;
+    if (contended == TRUE)
+    {
+        lock->st_contends++;
+    }
+    lock->st_holdtsc = x86_rdtsc();
+#endif
+    return;
+}
+
+void spinlock_stat_release(spinlock_t *lock)
+{
+#ifdef CFG_SPINLOCK_STAT
+    u64_t hold = x86_rdtsc() - lock->st_holdtsc;
+    if (hold > lock->st_maxhold)
+    {
+        lock->st_maxhold = hold;
+    }
+#endif
+    return;
+}
+
+//MCS排队锁:锁空闲且没人排队时一条cmpxchg拿到,否则挂到队尾,
+//在自己CPU的节点上自旋,等前一个把队头交过来,再等持有者放锁
+void spinlock_acquire(spinlock_t *lock)
+{
+    uint_t cpuid, idx;
+    spinnode_t *node;
+    u32_t tail, old;
+    bool_t last = FALSE;
+
+    if (spinlock_cmpxchg(&lock->lock, 0, SPINLOCK_LOCKED) == 0)
+    {
+        spinlock_stat_acquired(lock, FALSE);
+        return;
+    }
+    cpuid = hal_retn_cpuid();
+    idx = osspinnest[cpuid];
+    if (idx >= SPINNODE_MAX)
+    {
+        //中断嵌套太深,节点用完了,只好直接抢锁字
+        for (;;)
+        {
+            old = lock->lock;
+            if ((old & SPINLOCK_LOCKMASK) == 0 &&
+                spinlock_cmpxchg(&lock->lock, old, old | SPINLOCK_LOCKED) == old)
+            {
+                break;
+            }
+            spinlock_pause();
+        }
+        spinlock_stat_acquired(lock, TRUE);
+        return;
+    }
+    osspinnest[cpuid] = idx + 1;
+    node = &osspinnode[cpuid][idx];
+    node->sn_next = NULL;
+    node->sn_locked = 0;
+    tail = (u32_t)(cpuid * SPINNODE_MAX + idx + 1) << SPINLOCK_TAILSHIFT;
+
+    do
+    {
+        old = lock->lock;
+    } while (spinlock_cmpxchg(&lock->lock, old, (old & SPINLOCK_LOCKMASK) | tail) != old);
+
+    if ((old >> SPINLOCK_TAILSHIFT) != 0)
+    {
+        spinnode_retn(old >> SPINLOCK_TAILSHIFT)->sn_next = node;
+        while (node->sn_locked == 0)
+        {
+            spinlock_pause();
+        }
+    }
+
+    for (;;)
+    {
+        old = lock->lock;
+        if ((old & SPINLOCK_LOCKMASK) != 0)
+        {
+            spinlock_pause();
+            continue;
+        }
+        //自己还是队尾,拿锁的同时把队列清空
+        last = ((old & ~(u32_t)SPINLOCK_LOCKMASK) == tail) ? TRUE : FALSE;
+        if (spinlock_cmpxchg(&lock->lock, old,
+                             last == TRUE ? SPINLOCK_LOCKED : (old | SPINLOCK_LOCKED)) == old)
+        {
+            break;
+        }
+    }
+
+    if (last == FALSE)
+    {
+        while (node->sn_next == NULL)
+        {
+            spinlock_pause();
+        }
+        node->sn_next->sn_locked = 1;
+    }
+    osspinnest[cpuid] = idx;
+    spinlock_stat_acquired(lock, TRUE);
+    return;
+}
+
+void spinlock_release(spinlock_t *lock)
+{
+    spinlock_stat_release(lock);
+    __asm__ __volatile__("lock; andl %1,%0"
+                         : "+m"(lock->lock)
+                         : "ir"(~(u32_t)SPINLOCK_LOCKMASK)
+                         : "memory");
+    return;
+}
+
 void hal_spinlock_init(spinlock_t *lock)
 {
     lock->lock = 0;
+    spinlock_stat_init(lock);
     return;
 }
 
 void hal_spinlock_lock(spinlock_t *lock)
 {
-    __asm__ __volatile__(
-        "1:         \n"
-        "lock; xchg  %0, %1 \n"
-        "cmpl   $0, %0      \n"
-        "jnz    2f      \n"
-        ".section .spinlock.text,"
-        "\"ax\""
-        "\n"                    // 重新定义一个代码段所以jnz 2f下面并不是
-        "2:         \n"         //cmpl $0,%1 事实上下面的代码不会常常执行,
-        "cmpl   $0, %1      \n" //这是为了不在cpu指令高速缓存中填充无用代码
-        "jne    2b      \n"     //要知道那可是用每位6颗晶体管做的双极性静态
-        "jmp    1b      \n"     //储存器,比内存条快几千个数量级
-        ".previous      \n"
-        :
-        : "r"(1), "m"(*lock));
+    spinlock_acquire(lock);
     return;
 }
 
 void hal_spinlock_unlock(spinlock_t *lock)
 {
-    __asm__ __volatile__(
-        "movl   $0, %0\n"
-        :
-        : "m"(*lock));
+    spinlock_release(lock);
     return;
 }
 
 void hal_spinlock_saveflg_cli(spinlock_t *lock, cpuflg_t *cpuflg)
 {
-    __asm__ __volatile__(
-        "pushfq             \n\t"
-        "cli                \n\t"
-        "popq %0            \n\t"
-
-        "1:                 \n\t"
-        "lock; xchg  %1, %2 \n\t"
-        "cmpl   $0,%1       \n\t"
-        "jnz    2f          \n\t"
-        ".section .spinlock.text,"
-        "\"ax\""
-        "\n\t"                    //重新定义一个代码段所以jnz 2f下面并不是
-        "2:                 \n\t" //cmpl $0,%1 事实上下面的代码不会常常执行,
-        "cmpl   $0,%2       \n\t" //这是为了不在cpu指令高速缓存中填充无用代码
-        "jne    2b          \n\t"
-        "jmp    1b          \n\t"
-        ".previous          \n\t"
-        : "=m"(*cpuflg)
-        : "r"(1), "m"(*lock));
+    save_flags_cli(cpuflg);
+    spinlock_acquire(lock);
     return;
 }
 void knl_spinlock(spinlock_t * lock)
@@ -109,82 +228,74 @@ void knl_spinunlock(spinlock_t * lock)
 
 void hal_spinunlock_restflg_sti(spinlock_t *lock, cpuflg_t *cpuflg)
 {
-    __asm__ __volatile__(
-        "movl   $0, %0\n\t"
-        "pushq %1 \n\t"
-        "popfq \n\t"
-        :
-        : "m"(*lock), "m"(*cpuflg));
+    spinlock_release(lock);
+    restore_flags_sti(cpuflg);
     return;
 }
 
 void knl_spinlock_init(spinlock_t *lock)
 {
     lock->lock = 0;
+    spinlock_stat_init(lock);
     return;
 }
 
 void knl_spinlock_lock(spinlock_t *lock)
 {
-    __asm__ __volatile__(
-        "1:         \n"
-        "lock; xchg  %0, %1 \n"
-        "cmpl   $0, %0      \n"
-        "jnz    2f      \n"
-        ".section .spinlock.text,"
-        "\"ax\""
-        "\n"                    // 重新定义一个代码段所以jnz 2f下面并不是
-        "2:         \n"         //cmpl $0,%1 事实上下面的代码不会常常执行,
-        "cmpl   $0, %1      \n" //这是为了不在cpu指令高速缓存中填充无用代码
-        "jne    2b      \n"     //要知道那可是用每位6颗晶体管做的双极性静态
-        "jmp    1b      \n"     //储存器,比内存条快几千个数量级
-        ".previous      \n"
-        :
-        : "r"(1), "m"(*lock));
+    spinlock_acquire(lock);
     return;
 }
 
 void knl_spinlock_unlock(spinlock_t *lock)
 {
-    __asm__ __volatile__(
-        "movl   $0, %0\n"
-        :
-        : "m"(*lock));
+    spinlock_release(lock);
     return;
 }
 
 void knl_spinlock_cli(spinlock_t *lock, cpuflg_t *cpuflg)
 {
-    __asm__ __volatile__(
-        "pushfq             \n\t"
-        "cli                \n\t"
-        "popq %0            \n\t"
-
-        "1:                 \n\t"
-        "lock; xchg  %1, %2 \n\t"
-        "cmpl   $0,%1       \n\t"
-        "jnz    2f          \n\t"
-        ".section .spinlock.text,"
-        "\"ax\""
-        "\n\t"                    //重新定义一个代码段所以jnz 2f下面并不是
-        "2:                 \n\t" //cmpl $0,%1 事实上下面的代码不会常常执行,
-        "cmpl   $0,%2       \n\t" //这是为了不在cpu指令高速缓存中填充无用代码
-        "jne    2b          \n\t"
-        "jmp    1b          \n\t"
-        ".previous          \n\t"
-        : "=m"(*cpuflg)
-        : "r"(1), "m"(*lock));
+    save_flags_cli(cpuflg);
+    spinlock_acquire(lock);
     return;
 }
 
 void knl_spinunlock_sti(spinlock_t *lock, cpuflg_t *cpuflg)
 {
-    __asm__ __volatile__(
-        "movl   $0, %0\n\t"
-        "pushq %1 \n\t"
-        "popfq \n\t"
-        :
-        : "m"(*lock), "m"(*cpuflg));
+    spinlock_release(lock);
+    restore_flags_sti(cpuflg);
+    return;
+}
+
+//给锁起个名字并登记到osspinstat,hal_spinlock_stat_dump只打印登记过的锁
+void hal_spinlock_stat_name(spinlock_t *lock, char_t *name)
+{
+#ifdef CFG_SPINLOCK_STAT
+    cpuflg_t cpuflg;
+    lock->st_name = name;
+    save_flags_cli(&cpuflg);
+    if (osspinstatnr < SPINSTAT_MAX)
+    {
+        osspinstat[osspinstatnr++] = lock;
+    }
+    restore_flags_sti(&cpuflg);
+#endif
+    return;
+}
+
+void hal_spinlock_stat_dump()
+{
+#ifdef CFG_SPINLOCK_STAT
+    spinlock_t *lock;
+    kprint("自旋锁 地址 获取次数 排队次数 最长持有(TSC)\n");
+    for (uint_t i = 0; i < osspinstatnr; i++)
+    {
+        lock = osspinstat[i];
+        kprint("%s %x %d %d %d\n", lock->st_name, (uint_t)lock,
+               lock->st_acquires, lock->st_contends, lock->st_maxhold);
+    }
+#else
+    kprint("自旋锁统计没有打开,要在config.h中定义CFG_SPINLOCK_STAT\n");
+#endif
     return;
 }
 
@@ -572,6 +572,8 @@ bool_t hal_mmu_transform_core(mmudsc_t* mmu, adr_t vadrs, adr_t padrs, u64_t fla
 	msadsc_t* smsa = NULL;
 	msadsc_t* imsa = NULL;
 	msadsc_t* mmsa = NULL;
+	//中间各级页表项总是可写的,只读由最后一级决定,否则一个只读页会让同一页表下的页都只读
+	u64_t dirflags = flags | PML4E_RW;
 
 	knl_spinlock(&mmu->mud_lock);
 	
@@ -582,21 +584,21 @@ bool_t hal_mmu_transform_core(mmudsc_t* mmu, adr_t vadrs, adr_t padrs, u64_t fla
 		goto out;
 	}
 
-	sdirearr = mmu_transform_sdire(mmu, tdirearr, vadrs, flags, &smsa);
+	sdirearr = mmu_transform_sdire(mmu, tdirearr, vadrs, dirflags, &smsa);
 	if(NULL == sdirearr)
 	{
 		rets = FALSE;
 		goto untf_sdire;		
 	}
 
-	idirearr = mmu_transform_idire(mmu, sdirearr, vadrs, flags, &imsa);
+	idirearr = mmu_transform_idire(mmu, sdirearr, vadrs, dirflags, &imsa);
 	if(NULL == idirearr)
 	{
 		rets = FALSE;
 		goto untf_idire;		
 	}
 
-	mdirearr = mmu_transform_mdire(mmu, idirearr, vadrs, flags, &mmsa);
+	mdirearr = mmu_transform_mdire(mmu, idirearr, vadrs, dirflags, &mmsa);
 	if(NULL == mdirearr)
 	{
 		rets = FALSE;
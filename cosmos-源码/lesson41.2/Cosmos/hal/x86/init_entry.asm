@@ -49,6 +49,7 @@ _start:
 ;开启 PE 和 paging
     mov eax, cr0
     bts eax, 0                      ; CR0.PE =1
+    bts eax, 16                     ; CR0.WP =1 内核写只读页也要缺页,文件映射页才能写时复制
     bts eax, 31
 
 ;开启 CACHE       
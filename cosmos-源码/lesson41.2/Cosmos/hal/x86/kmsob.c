@@ -90,6 +90,7 @@ void kmsobmgrhed_t_init(kmsobmgrhed_t *initp)
 {
 	size_t koblsz = 32;
 	knl_spinlock_init(&initp->ks_lock);
+	hal_spinlock_stat_name(&initp->ks_lock, "ks_lock");
 	list_init(&initp->ks_tclst);
 	initp->ks_tcnr = 0;
 	initp->ks_msobnr = 0;
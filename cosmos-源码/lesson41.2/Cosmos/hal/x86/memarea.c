@@ -80,6 +80,7 @@ void memarea_t_init(memarea_t *initp)
 {
 	list_init(&initp->ma_list);
 	knl_spinlock_init(&initp->ma_lock);
+	hal_spinlock_stat_name(&initp->ma_lock, "ma_lock");
 	initp->ma_stus = 0;
 	initp->ma_flgs = 0;
 	initp->ma_type = MA_TYPE_INIT;
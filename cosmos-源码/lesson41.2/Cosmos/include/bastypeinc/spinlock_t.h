@@ -8,8 +8,30 @@
 
 
 
+//锁字低8位是持有标志,高16位是排队线程的队尾节点编号(0表示没人排队)
+//排队的CPU各自在自己的spinnode_t上自旋,不再一起抢同一条缓存行
+#define SPINLOCK_LOCKED 0x1
+#define SPINLOCK_LOCKMASK 0xff
+#define SPINLOCK_TAILSHIFT 16
+#define SPINNODE_MAX 4 //每个CPU最多同时有4层(中断嵌套)在排队
+#define SPINSTAT_MAX 64
+
+typedef struct s_SPINNODE
+{
+	struct s_SPINNODE* volatile sn_next;
+	volatile u32_t sn_locked;
+} __attribute__((aligned(64))) spinnode_t;
+
 typedef struct
 {
 	 volatile u32_t lock;
+#ifdef CFG_SPINLOCK_STAT
+	 u32_t st_rsv;
+	 u64_t st_acquires;  //获取次数
+	 u64_t st_contends;  //获取时要排队的次数
+	 u64_t st_holdtsc;   //本次获取时的TSC
+	 u64_t st_maxhold;   //最长持有时间,单位是TSC计数
+	 char_t* st_name;
+#endif
 } spinlock_t;
 #endif
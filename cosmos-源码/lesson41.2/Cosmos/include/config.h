@@ -8,4 +8,5 @@
 
 #define CFG_X86_PLATFORM
 #define APPRUN_START_VITRUALADDR (0x100000)
+//#define CFG_SPINLOCK_STAT //统计登记过的自旋锁的排队次数和最长持有时间
 #endif
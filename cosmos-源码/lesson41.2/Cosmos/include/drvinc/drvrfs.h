@@ -2,6 +2,7 @@
 #define DRVRFS_H
 void rfsdevext_t_init(rfsdevext_t* initp);
 void rfsdir_t_init(rfsdir_t* initp);
+void rfsdiridx_t_init(rfsdiridx_t* initp);
 void filblks_t_init(filblks_t* initp);
 void rfssublk_t_init(rfssublk_t* initp);
 void fimgrhd_t_init(fimgrhd_t* initp);
@@ -34,6 +35,7 @@ drvstus_t rfs_del_file(device_t* devp,char_t* fname,uint_t flg);
 drvstus_t rfs_read_file(device_t* devp,void* iopack);
 drvstus_t rfs_write_file(device_t* devp,void* iopack);
 drvstus_t rfs_open_file(device_t* devp,void* iopack);
+drvstus_t rfs_retn_filepages(device_t* devp,void* iopack);
 drvstus_t rfs_close_file(device_t* devp,void* iopack);
 sint_t rfs_strcmp(char_t* str_s,char_t* str_d);
 sint_t rfs_strlen(char* str_s);
@@ -41,12 +43,20 @@ sint_t rfs_strcpy(char_t* str_s,char_t* str_d);
 void init_rfs(device_t* devp);
 void rfs_fmat(device_t* devp);
 drvstus_t rfs_writefileblk(device_t* devp,fimgrhd_t* fmp,void* buf,uint_t len);
-drvstus_t rfs_readfileblk(device_t* devp,fimgrhd_t* fmp,void* buf,uint_t len);
+drvstus_t rfs_readfileblk(device_t* devp,fimgrhd_t* fmp,uint_t fops,void* buf,uint_t len);
+uint_t rfs_fileblk_map(fimgrhd_t* fmp,uint_t fblk,uint_t* retrun);
+bool_t rfs_extend_fileblk(device_t* devp,fimgrhd_t* fmp,uint_t blks);
+void rfs_free_fileblk(device_t* devp,fimgrhd_t* fmp);
 drvstus_t rfs_closefileblk(device_t *devp, void* fblkp);
 void* rfs_openfileblk(device_t *devp, char_t* fname);
 drvstus_t rfs_new_dirfileblk(device_t* devp,char_t* fname,uint_t flgtype,uint_t val);
 drvstus_t rfs_del_dirfileblk(device_t* devp,char_t* fname,uint_t flgtype,uint_t val);
 sint_t del_dirfileblk_core(device_t* devp,char_t* fname);
+uint_t rfs_dir_hash(char_t* fname);
+rfsdir_t* rfs_dir_retn_entry(device_t* devp,fimgrhd_t* dfmp,uint_t idx);
+rfsdir_t* rfs_dir_lookup(device_t* devp,fimgrhd_t* dfmp,char_t* fname,uint_t type,uint_t* retidx);
+rfsdir_t* rfs_dir_new_entry(device_t* devp,fimgrhd_t* dfmp,char_t* fname);
+void rfs_dir_del_entry(device_t* devp,fimgrhd_t* dfmp,uint_t idx);
 void* get_rootdirfile_blk(device_t* devp);
 void del_rootdirfile_blk(device_t* devp,void* blkp);
 rfsdir_t* get_rootdir(device_t* devp);
@@ -56,7 +66,9 @@ void del_superblk(device_t* devp,rfssublk_t* sbp);
 u8_t* get_bitmapblk(device_t* devp);
 void del_bitmapblk(device_t* devp,u8_t* bitmap);
 uint_t rfs_new_blk(device_t* devp);
+uint_t rfs_new_blks(device_t* devp,uint_t goal,uint_t nr,uint_t* retnr);
 void rfs_del_blk(device_t* devp,uint_t  blknr);
+void rfs_del_blks(device_t* devp,uint_t blkstart,uint_t nr);
 sint_t rfs_chkfilepath(char_t* fname);
 sint_t rfs_ret_fname(char_t* buf,char_t* fpath);
 sint_t rfs_chkfileisindev(device_t* devp,char_t* fname);
@@ -1,6 +1,6 @@
 #ifndef DRVRFS_T_H
 #define DRVRFS_T_H
-#define DR_NM_MAX (128-(sizeof(uint_t)*3))
+#define DR_NM_MAX (128-(sizeof(uint_t)*4))
 #define FBLKS_MAX 32
 #define RDR_NUL_TYPE 0
 #define RDR_DIR_TYPE 1
@@ -11,8 +11,12 @@
 #define FMD_DIR_TYPE 1
 #define FMD_FIL_TYPE 2
 #define FMD_DEL_TYPE 5
+//普通文件的数据从第二块开始,按页对齐以便直接映射
+#define FMD_FIL_DATOFF FSYS_ALCBLKSZ
 #define FSMM_BLK 0x400000
 #define FSYS_ALCBLKSZ 0x1000
+//位图块中每位对应一个逻辑储存块
+#define FSYS_BMPBITS (FSYS_ALCBLKSZ*8)
 
 typedef struct s_RFSDEVEXT
 {
@@ -22,6 +26,7 @@ typedef struct s_RFSDEVEXT
     uint_t rde_stus;
     void* rde_mstart;
     size_t rde_msize;
+    uint_t rde_blkhint;
     void* rde_ext;
 }rfsdevext_t;
 
@@ -31,9 +36,23 @@ typedef struct s_RFSDIR
     uint_t rdr_stus;
     uint_t rdr_type;
     uint_t rdr_blknr;
+    uint_t rdr_hnext;
     char_t rdr_name[DR_NM_MAX];
 }rfsdir_t;
 
+//目录的散列索引放在目录文件管理头所在块的0x400处,在fimgrhd_t之后,目录项从第二块开始
+//链表里存的是目录项序号加1,0表示链表结束
+#define RFSDIR_IDXOFF 0x400
+#define RFSDIR_HASH_MAX 256
+//目录一次增长的块数,避免目录区段被文件块打碎
+#define RFSDIR_GROW_BLKS 16
+typedef struct s_RFSDIRIDX
+{
+    uint_t rdi_entnr;
+    uint_t rdi_freehd;
+    uint_t rdi_hash[RFSDIR_HASH_MAX];
+}rfsdiridx_t;
+
 typedef struct s_FILBLKS
 {
     uint_t fb_blkstart;
@@ -77,7 +96,12 @@ typedef struct s_fimgrhd
     filblks_t fmd_fleblk[FBLKS_MAX];
     uint_t fmd_linkpblk;
     uint_t fmd_linknblk;
+    refcount_t fmd_mapcnt; //映射着文件数据页的地址区数,不为0时不能删除文件
 }fimgrhd_t;
 
+//目录索引不能压住文件管理头,也不能越过目录项开始的第二块
+_Static_assert(RFSDIR_IDXOFF >= sizeof(fimgrhd_t), "RFSDIR_IDXOFF overlaps fimgrhd_t");
+_Static_assert(RFSDIR_IDXOFF + sizeof(rfsdiridx_t) <= FMD_FIL_DATOFF, "rfsdiridx_t crosses FMD_FIL_DATOFF");
+
 
 #endif
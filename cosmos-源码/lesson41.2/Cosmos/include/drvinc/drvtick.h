@@ -5,6 +5,8 @@
 **********************************************************/
 #ifndef _DRVTICK_H
 #define _DRVTICK_H
+void systick_set_oneshot(uint_t count);
+void systick_set_periodic();
 void systick_set_driver(driver_t* drvp);
 void systick_set_device(device_t* devp,driver_t* drvp);
 drvstus_t systick_entry(driver_t* drvp,uint_t val,void* p);
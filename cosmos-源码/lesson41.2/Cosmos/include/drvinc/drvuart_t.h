@@ -20,6 +20,7 @@ typedef struct KBOARD
 #define DEV_KEYBOARD_SUBDEV_NR 0
 #define DEV_KEYBOARD_NAME "key_board"
 #define KBBUF_NULL 0xffff
+#define UART_IOCTRCD_LOCKSTAT 1 //在控制台上打印自旋锁统计
 
 #define KEY_SHIFT_L_DOWN 0x2a
 #define KEY_SHIFT_L_UP 0xaa
@@ -11,6 +11,11 @@ void hal_sti_cpuflag(cpuflg_t* cpuflg);
 void hal_cli_cpuflag(cpuflg_t* cpuflg);
 void hal_cpuflag_sti(cpuflg_t* cpuflg);
 void hal_cpuflag_cli(cpuflg_t* cpuflg);
+void spinlock_stat_init(spinlock_t *lock);
+void spinlock_stat_acquired(spinlock_t *lock, bool_t contended);
+void spinlock_stat_release(spinlock_t *lock);
+void spinlock_acquire(spinlock_t *lock);
+void spinlock_release(spinlock_t *lock);
 void hal_spinlock_init(spinlock_t *lock);
 void hal_spinlock_lock(spinlock_t *lock);
 void hal_spinlock_unlock(spinlock_t *lock);
@@ -23,6 +28,8 @@ void knl_spinlock_lock(spinlock_t *lock);
 void knl_spinlock_unlock(spinlock_t *lock);
 void knl_spinlock_cli(spinlock_t *lock, cpuflg_t *cpuflg);
 void knl_spinunlock_sti(spinlock_t *lock, cpuflg_t *cpuflg);
+void hal_spinlock_stat_name(spinlock_t *lock, char_t *name);
+void hal_spinlock_stat_dump();
 void hal_memset(void *setp, u8_t setval, size_t n);
 void hal_memcpy(void *src, void *dst, size_t n);
 void hal_sysdie(char_t *errmsg);
@@ -76,6 +76,10 @@ HAL_DEFGLOB_VARIABLE(machbstart_t,kmachbsp);
 HAL_DEFGLOB_VARIABLE(dftgraph_t,kdftgh);
 HAL_DEFGLOB_VARIABLE(memmgrob_t,memmgrob);
 HAL_DEFGLOB_VARIABLE(intfltdsc_t,machintflt)[IDTMAX];
+HAL_DEFGLOB_VARIABLE(spinnode_t,osspinnode)[CPUCORE_MAX][SPINNODE_MAX];
+HAL_DEFGLOB_VARIABLE(uint_t,osspinnest)[CPUCORE_MAX];
+HAL_DEFGLOB_VARIABLE(spinlock_t*,osspinstat)[SPINSTAT_MAX];
+HAL_DEFGLOB_VARIABLE(uint_t,osspinstatnr);
 #endif
 void die(u32_t dt);
 #endif // HALGLOBAL_H
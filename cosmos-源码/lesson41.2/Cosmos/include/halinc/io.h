@@ -41,6 +41,8 @@
 #define PTIPROTM 0x43
 
 #define TIMEMODE 0x34      //;00-11-010-0
+#define TIMEONESHOT 0x30   //;00-11-000-0
+#define TIMEONESHOT_MAX 0xffffUL
 #define TIMEJISU 1194000UL //1193182UL
 #define HZ 1000UL          //0x3e8
 
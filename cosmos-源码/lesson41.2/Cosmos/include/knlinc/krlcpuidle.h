@@ -10,4 +10,5 @@ void krlcpuidle_start();
 thread_t* new_cpuidle_thread();
 void new_cpuidle();
 void krlcpuidle_main();
+void krlcpuidle_tickless();
 #endif // KRLCPUIDLE_H
@@ -66,6 +66,7 @@
 #define DIDFIL_FLN 2
 
 #define FSDEV_IOCTRCD_DELFILE 5
+#define FSDEV_IOCTRCD_FILEPAGES 6 //返回文件数据所在的内存页
 #define FSDEV_OPENFLG_NEWFILE 1
 #define FSDEV_OPENFLG_OPEFILE 2
 
@@ -113,7 +114,7 @@ typedef struct s_DEVICE
     devid_t      dev_id;
     uint_t      dev_intlnenr;
     list_h_t    dev_intserlst;
-    list_h_t    dev_rqlist;
+    list_h_t    dev_rqlist[IOIF_CODE_MAX]; //每个功能码一个请求队列
     uint_t      dev_rqlnr;
     sem_t       dev_waitints;
     struct s_DRIVER* dev_drv;
@@ -15,6 +15,7 @@ KRL_DEFGLOB_VARIABLE(mmadrsdsc_t, initmmadrsdsc);
 KRL_DEFGLOB_VARIABLE(kmempool_t,oskmempool);
 KRL_DEFGLOB_VARIABLE(schedclass_t,osschedcls);
 KRL_DEFGLOB_VARIABLE(ktime_t,osktime);
+KRL_DEFGLOB_VARIABLE(futexbkt_t,osfutextab)[FUTEX_HASH_MAX];
 KRL_DEFGLOB_VARIABLE(syscall_t,osservicetab)[INR_MAX];
 KRL_DEFGLOB_VARIABLE(devtable_t,osdevtable);
 // KRL_DEFGLOB_VARIABLE(iocheblkdsc_t,osiocheblk);
@@ -33,5 +33,7 @@
 #include "krlsvewrite.h"
 #include "krlsveioctrl.h"
 #include "krlsvelseek.h"
+#include "krlsveioring.h"
+#include "krlsvefutex.h"
 #include "krlstr.h"
 #endif // KRLHEADS_H
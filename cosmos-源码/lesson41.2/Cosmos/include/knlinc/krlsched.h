@@ -15,6 +15,7 @@ void krlsched_up(kwlst_t* wlst);
 void krlsched_set_schedflgs();
 void krlsched_chkneed_pmptsched();
 thread_t* krlsched_select_thread();
+bool_t krlsched_chk_idle();
 void krlschedul();
 void krlsched_exit();
 void krlschdclass_add_thread(thread_t* thdp);
@@ -21,7 +21,12 @@
 #define INR_FS_LSEEK 0xdUL
 #define INR_TIME 0xeUL
 #define INR_TD_TICK 0xfUL
-#define INR_MAX 0x10UL
+#define INR_IO_SETUP 0x10UL
+#define INR_IO_ENTER 0x11UL
+#define INR_FUTEX_WAIT 0x12UL
+#define INR_FUTEX_WAKE 0x13UL
+#define INR_MM_MAP 0x14UL
+#define INR_MAX 0x15UL
 
 #define SYSSTUSERR (-1)
 #define SYSSTUSOK (0)
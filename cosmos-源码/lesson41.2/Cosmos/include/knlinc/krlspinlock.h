@@ -10,4 +10,6 @@ void krlspinlock_lock(spinlock_t* lock);
 void krlspinlock_unlock(spinlock_t* lock);
 void krlspinlock_cli(spinlock_t* lock,cpuflg_t* cpuflg);
 void krlspinunlock_sti(spinlock_t* lock,cpuflg_t* cpuflg);
+void krlspinlock_stat_name(spinlock_t* lock,char_t* name);
+void krlspinlock_stat_dump();
 #endif
\ No newline at end of file
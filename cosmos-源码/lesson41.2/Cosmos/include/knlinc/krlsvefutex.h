@@ -0,0 +1,14 @@
+/**********************************************************
+        内核服务头文件krlsvefutex.h
+***********************************************************
+                彭东
+**********************************************************/
+#ifndef _KRLSVEFUTEX_H
+#define _KRLSVEFUTEX_H
+void futexbkt_t_init(futexbkt_t* initp);
+void init_krlfutex();
+sysstus_t krlsvetabl_futex_wait(uint_t inr,stkparame_t* stkparv);
+sysstus_t krlsvetabl_futex_wake(uint_t inr,stkparame_t* stkparv);
+sysstus_t krlsve_futex_wait(u32_t* uadr,u32_t val);
+sysstus_t krlsve_futex_wake(u32_t* uadr,uint_t nr);
+#endif // KRLSVEFUTEX_H
@@ -0,0 +1,28 @@
+/**********************************************************
+        内核服务头文件krlsvefutex_t.h
+***********************************************************
+                彭东
+**********************************************************/
+#ifndef _KRLSVEFUTEX_T_H
+#define _KRLSVEFUTEX_T_H
+
+#define FUTEX_HASH_MAX 64 //必须是2的幂
+#define FUTEX_HASH(mmdsc, uadr) (((((uint_t)(uadr)) >> 2) ^ (((uint_t)(mmdsc)) >> 6)) & (FUTEX_HASH_MAX - 1))
+
+//按用户地址散列的等待桶
+typedef struct s_FUTEXBKT
+{
+    spinlock_t  fb_lock;
+    list_h_t    fb_list;
+}futexbkt_t;
+
+//等待者,放在等待线程的内核栈上,由唤醒者从桶里摘下
+typedef struct s_FUTEXWT
+{
+    list_h_t    fw_list;
+    void*       fw_mmdsc;
+    u32_t*      fw_uadr;
+    kwlst_t     fw_wlst;
+}futexwt_t;
+
+#endif // KRLSVEFUTEX_T_H
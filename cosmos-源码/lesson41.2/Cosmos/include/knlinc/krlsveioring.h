@@ -0,0 +1,13 @@
+/**********************************************************
+        内核服务头文件krlsveioring.h
+***********************************************************
+                彭东
+**********************************************************/
+#ifndef _KRLSVEIORING_H
+#define _KRLSVEIORING_H
+sysstus_t krlsvetabl_ioring_setup(uint_t inr,stkparame_t* stkparv);
+sysstus_t krlsvetabl_ioring_enter(uint_t inr,stkparame_t* stkparv);
+sysstus_t krlsve_ioring_setup(ioring_t* ring);
+sysstus_t krlsve_ioring_enter(uint_t tosubmit);
+sysstus_t krlsve_ioring_exec(iosqe_t* sqe);
+#endif // KRLSVEIORING_H
@@ -0,0 +1,49 @@
+/**********************************************************
+        内核服务头文件krlsveioring_t.h
+***********************************************************
+                彭东
+**********************************************************/
+#ifndef _KRLSVEIORING_T_H
+#define _KRLSVEIORING_T_H
+
+#define IORING_ENTRY_MAX 32 //必须是2的幂
+#define IORING_ENTRY_MASK (IORING_ENTRY_MAX - 1)
+
+#define IORING_OP_NOP 0
+#define IORING_OP_READ 1
+#define IORING_OP_WRITE 2
+#define IORING_OP_IOCTRL 3
+#define IORING_OP_LSEEK 4
+
+//提交/完成环只是把多个同步I/O系统调用合成一次,不是异步I/O
+//提交项,sqe_len对IOCTRL是控制码,对LSEEK是偏移
+typedef struct s_IOSQE
+{
+    uint_t  sqe_opcode;
+    hand_t  sqe_hand;
+    buf_t   sqe_buf;
+    size_t  sqe_len;
+    uint_t  sqe_flgs;
+    uint_t  sqe_udata;
+}iosqe_t;
+
+//完成项,cqe_udata原样带回提交项的sqe_udata
+typedef struct s_IOCQE
+{
+    uint_t      cqe_udata;
+    sysstus_t   cqe_rets;
+}iocqe_t;
+
+//提交环和完成环放在应用程序的内存里,头尾只增不减,用时与上IORING_ENTRY_MASK
+//应用程序写sq和ior_sqtail、读cq和移动ior_cqhead,内核移动ior_sqhead、写cq和ior_cqtail
+typedef struct s_IORING
+{
+    uint_t  ior_sqhead;
+    uint_t  ior_sqtail;
+    uint_t  ior_cqhead;
+    uint_t  ior_cqtail;
+    iosqe_t ior_sq[IORING_ENTRY_MAX];
+    iocqe_t ior_cq[IORING_ENTRY_MAX];
+}ioring_t;
+
+#endif // KRLSVEIORING_T_H
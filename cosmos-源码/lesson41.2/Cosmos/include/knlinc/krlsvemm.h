@@ -2,8 +2,11 @@
 #define _KRLSVEMM_H
 sysstus_t krlsvetabl_mallocblk(uint_t inr,stkparame_t* stkparv);
 sysstus_t krlsvetabl_mfreeblk(uint_t inr,stkparame_t* stkparv);
+sysstus_t krlsvetabl_mmap(uint_t inr,stkparame_t* stkparv);
 void* krlsve_mallocblk(size_t blksz);
 sysstus_t krlsve_mfreeblk(void* fradr,size_t blksz);
 void* krlsve_core_mallocblk(size_t blksz);
 sysstus_t krlsve_core_mfreeblk(void* fradr,size_t blksz);
+void* krlsve_mmap(hand_t fhand,size_t len,uint_t flgs);
+void* krlsve_core_mmap(hand_t fhand,size_t len,uint_t flgs);
 #endif // KRLSVEMM_H
@@ -87,6 +87,7 @@ typedef struct s_THREAD
     void*       td_resdsc;
     void*       td_privtep;
     void*       td_extdatap;
+    void*       td_ioring;
     char_t*     td_appfilenm;
     uint_t      td_appfilenmlen;
     context_t   td_context;
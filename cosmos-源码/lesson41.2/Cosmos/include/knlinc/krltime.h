@@ -11,8 +11,25 @@ void krlupdate_times_from_cmos();
 void krlupdate_times(uint_t year,uint_t mon,uint_t day,uint_t date,uint_t hour,uint_t min,uint_t sec);
 sysstus_t krlsvetabl_time(uint_t inr,stkparame_t* stkparv);
 sysstus_t krlsve_time(time_t* time);
+void krltime_calibrate_tsc();
+void krltime_tick();
+u64_t krltime_retn_usecs();
+uint_t krltime_to_secs(uint_t year,uint_t mon,uint_t day,uint_t hour,uint_t min,uint_t sec);
+void krltime_from_secs(uint_t secs,time_t* time);
 KLINE u32_t bcd_to_bin(u32_t val)
 {
 	return (val & 0xf) + ((val >> 4) * 10);
 }
+KLINE uint_t ktime_mon_days(uint_t year,uint_t mon)
+{
+	if (mon == 2)
+	{
+		return KTIME_LEAP(year) ? 29 : 28;
+	}
+	if (mon == 4 || mon == 6 || mon == 9 || mon == 11)
+	{
+		return 30;
+	}
+	return 31;
+}
 #endif // KRLTIME_H
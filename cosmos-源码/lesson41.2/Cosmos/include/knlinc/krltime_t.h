@@ -9,6 +9,13 @@
 typedef struct s_KTIME
 {
     spinlock_t  kt_lock;
+    uint_t      kt_seq;         //写时加1,奇数表示正在更新,读者据此重试而不用加锁
+    uint_t      kt_tickless;    //空转时8254被设成了单次计数
+    uint_t      kt_ticks;       //没有TSC时数时钟中断,每HZ次读一次CMOS
+    u64_t       kt_tschz;       //TSC每秒的计数,为0表示TSC不可用
+    u64_t       kt_boottsc;     //校准完TSC时的TSC值
+    u64_t       kt_basetsc;     //最近一次从CMOS同步时的TSC值
+    uint_t      kt_basesecs;    //最近一次从CMOS同步时的时间,自2000年1月1日起的秒数
     uint_t      kt_year;
     uint_t      kt_mon;
     uint_t      kt_day;
@@ -33,6 +40,17 @@ typedef struct s_TIME
     
 }time_t;
 
+#define KTIME_RESYNC_SECS 600     //每10分钟从CMOS重新同步一次
+#define KTIME_CALIB_HZ 100        //用8254通道2定时1/100秒来校准TSC
+#define KTIME_PIT_HZ 1193182UL
+#define KTIME_LEAP(y) (((y) & 3) == 0) //年份只有两位,2000到2099年
+
+#define PIT_CH2_GATE_PORT 0x61
+#define PIT_CH2_GATE 0x01
+#define PIT_CH2_SPKR 0x02
+#define PIT_CH2_OUT 0x20
+#define PIT_CH2_MODE0 0xb0        //;10-11-000-0
+
 #define CMOS_PROT_ADR 0x70
 #define CMOS_PROT_DATE 0x71
 #define CMOS_SEC_ADR 0x00
@@ -41,6 +59,8 @@ typedef struct s_TIME
 #define CMOS_DAY_ADR 0x07
 #define CMOS_MON_ADR 0x08
 #define CMOS_YEAR_ADR 0x09
+#define CMOS_STATA_ADR 0x0a
+#define CMOS_STATA_UIP 0x80       //CMOS正在更新,这时读出的时间可能不一致
 #define CMOS_READ(val,adr) ({out_u8(CMOS_PROT_ADR,adr);val=in_u8(CMOS_PROT_DATE);}) 
 
 #endif // KRLTIME_T_H
@@ -32,5 +32,7 @@
 #include "krlsvewrite_t.h"
 #include "krlsveioctrl_t.h"
 #include "krlsvelseek_t.h"
+#include "krlsveioring_t.h"
+#include "krlsvefutex_t.h"
 #include "krlstr_t.h"
 #endif // KRLTYPES_H
@@ -57,6 +57,8 @@ bool_t vma_del_usermsa(mmadrsdsc_t *mm, kvmemcbox_t *kmbox, msadsc_t *msa, adr_t
 msadsc_t *vma_new_usermsa(mmadrsdsc_t *mm, kvmemcbox_t *kmbox);
 adr_t vma_map_msa_fault(mmadrsdsc_t *mm, kvmemcbox_t *kmbox, adr_t vadrs, u64_t flags);
 adr_t vma_map_phyadrs(mmadrsdsc_t *mm, kmvarsdsc_t *kmvd, adr_t vadrs, u64_t flags);
+bool_t vma_map_filepages(mmadrsdsc_t *mm, adr_t vadrs, adr_t *pages, uint_t pgnr, refcount_t *filenode);
+adr_t vma_map_cow_fault(mmadrsdsc_t *mm, kvmemcbox_t *kmbox, adr_t vadrs);
 void vma_full_textbin(mmadrsdsc_t* mm, kmvarsdsc_t* kmvd, adr_t vadr);
 sint_t vma_map_fairvadrs_core(mmadrsdsc_t *mm, adr_t vadrs);
 sint_t vma_map_fairvadrs(mmadrsdsc_t *mm, adr_t vadrs);
@@ -63,6 +63,7 @@ typedef struct KVMEMCBOXMGR
 #define KMV_BSS_TYPE 4
 #define KMV_HEAP_TYPE 8
 #define KMV_STACK_TYPE 16
+#define KMV_FILE_TYPE 32
 #define KMV_BIN_TYPE 64
 
 #define THREAD_HEAPADR_START 0x100000000
@@ -10,4 +10,6 @@
 #include "lapiioctrl.h"
 #include "lapilseek.h"
 #include "lapitime.h"
+#include "lapiioring.h"
+#include "lapifutex.h"
 #endif
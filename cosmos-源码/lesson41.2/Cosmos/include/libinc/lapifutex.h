@@ -0,0 +1,5 @@
+#ifndef LAPIFUTEX_H
+#define LAPIFUTEX_H
+sysstus_t api_futex_wait(u32_t* uadr,u32_t val);
+sysstus_t api_futex_wake(u32_t* uadr,uint_t nr);
+#endif // LAPIFUTEX_H
@@ -0,0 +1,5 @@
+#ifndef LAPIIORING_H
+#define LAPIIORING_H
+sysstus_t api_ioring_setup(ioring_t* ring);
+sysstus_t api_ioring_enter(uint_t tosubmit);
+#endif // LAPIIORING_H
@@ -7,5 +7,6 @@
 #define _LAPIMM_H
 void* api_mallocblk(size_t blksz);
 sysstus_t api_mfreeblk(void* fradr,size_t blksz);
+void* api_mmap(hand_t fhand,size_t len,uint_t flgs);
 void test_api();
 #endif // LAPIMM_H
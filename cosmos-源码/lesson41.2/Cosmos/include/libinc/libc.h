@@ -14,6 +14,8 @@
 #include "libioctrl.h"
 #include "liblseek.h"
 #include "libtime.h"
+#include "libioring.h"
+#include "libfutex.h"
 #include "printf.h"
 
 #endif // LIBC_H
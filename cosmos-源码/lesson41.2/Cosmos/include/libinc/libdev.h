@@ -17,6 +17,7 @@
 #define NANDFLASH_DEVICE 13
 #define CAMERA_DEVICE 14
 #define UART_DEVICE 15
+#define UART_IOCTRCD_LOCKSTAT 1
 #define TIMER_DEVICE 16
 #define USB_DEVICE 17
 #define WATCHDOG_DEVICE 18
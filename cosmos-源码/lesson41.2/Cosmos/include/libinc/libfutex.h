@@ -0,0 +1,11 @@
+#ifndef LIBFUTEX_H
+#define LIBFUTEX_H
+//0:没锁 1:锁了没人等 2:锁了而且可能有人在等
+typedef struct s_UMUTEX
+{
+    u32_t um_val;
+}umutex_t;
+void umutex_init(umutex_t* mtx);
+void umutex_lock(umutex_t* mtx);
+void umutex_unlock(umutex_t* mtx);
+#endif // LIBFUTEX_H
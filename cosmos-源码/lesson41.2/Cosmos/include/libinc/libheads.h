@@ -10,5 +10,7 @@
 #include "lapilseek.h"
 #include "lapiioctrl.h"
 #include "lapitime.h"
+#include "lapiioring.h"
+#include "lapifutex.h"
 
 #endif // LIBHEADS_H
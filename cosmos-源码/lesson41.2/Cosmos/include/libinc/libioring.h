@@ -0,0 +1,8 @@
+#ifndef LIBIORING_H
+#define LIBIORING_H
+sysstus_t ioring_setup(ioring_t* ring);
+iosqe_t* ioring_get_sqe(ioring_t* ring);
+sysstus_t ioring_submit(ioring_t* ring);
+iocqe_t* ioring_peek_cqe(ioring_t* ring);
+void ioring_cqe_seen(ioring_t* ring);
+#endif // LIBIORING_H
@@ -2,5 +2,6 @@
 #define LIBMM_H
 void* mallocblk(size_t blksz);
 sysstus_t mfreeblk(void* fradr,size_t blksz);
+void* mmap(hand_t fhand,size_t len,uint_t flgs);
 #endif
 
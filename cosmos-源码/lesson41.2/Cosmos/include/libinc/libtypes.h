@@ -59,6 +59,45 @@ typedef struct s_TIME
 #define INR_FS_LSEEK 0xdUL
 #define INR_TIME 0xeUL
 #define INR_TD_TICK 0xfUL
+#define INR_IO_SETUP 0x10UL
+#define INR_IO_ENTER 0x11UL
+#define INR_FUTEX_WAIT 0x12UL
+#define INR_FUTEX_WAKE 0x13UL
+#define INR_MM_MAP 0x14UL
+
+#define IORING_ENTRY_MAX 32
+#define IORING_ENTRY_MASK (IORING_ENTRY_MAX - 1)
+#define IORING_OP_NOP 0
+#define IORING_OP_READ 1
+#define IORING_OP_WRITE 2
+#define IORING_OP_IOCTRL 3
+#define IORING_OP_LSEEK 4
+
+typedef struct s_IOSQE
+{
+    uint_t  sqe_opcode;
+    hand_t  sqe_hand;
+    buf_t   sqe_buf;
+    size_t  sqe_len;
+    uint_t  sqe_flgs;
+    uint_t  sqe_udata;
+}iosqe_t;
+
+typedef struct s_IOCQE
+{
+    uint_t      cqe_udata;
+    sysstus_t   cqe_rets;   //与同步调用的返回值相同,读请求为读到的字节数
+}iocqe_t;
+
+typedef struct s_IORING
+{
+    uint_t  ior_sqhead;
+    uint_t  ior_sqtail;
+    uint_t  ior_cqhead;
+    uint_t  ior_cqtail;
+    iosqe_t ior_sq[IORING_ENTRY_MAX];
+    iocqe_t ior_cq[IORING_ENTRY_MAX];
+}ioring_t;
 
 
 #endif // LIBTYPES_H
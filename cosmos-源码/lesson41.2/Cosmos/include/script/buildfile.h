@@ -12,16 +12,17 @@
                         krlsem.o krlspinlock.o krlwaitlist.o krlsched.o krlthread.o\
                         krlcpuidle.o krldevice.o krlintupt.o krlobjnode.o krlservice.o\
                         krltime.o krlsveopen.o krlsveclose.o krlsveread.o krlsvewrite.o\
-                        krlsvethread.o krlsvemm.o krlsvelseek.o krlsveioctrl.o krlstr.o
+                        krlsvethread.o krlsvemm.o krlsvelseek.o krlsveioctrl.o krlstr.o\
+                        krlsveioring.o krlsvefutex.o
 #define BUILD_MEMY_OBJS
 #define BUILD_FSYS_OBJS
 #define BUILD_DRIV_OBJS drvtick.o drvrfs.o drvuart.o
 #define BUILD_LIBS_OBJS lapimm.o lapithread.o lapiopen.o lapiclose.o\
                         lapiread.o lapiwrite.o lapiioctrl.o lapilseek.o\
-                        lapitime.o\
+                        lapitime.o lapiioring.o lapifutex.o\
                         libmm.o libthread.o libopen.o libclose.o\
                         libread.o libwrite.o libioctrl.o liblseek.o\
-                        libtime.o printf.o start.o
+                        libtime.o libioring.o libfutex.o printf.o start.o
 #define BUILD_APPS_OBJS oneuser.o helloworld.o love.o
 
 #define BUILD_LINK_OBJS BUILD_HALY_OBJS\
@@ -135,6 +135,33 @@ void krlcpuidle_main()
         //kprint("空转进程运行:%x\n", i);
         // die(0x400);
         krlschedul();
+        krlcpuidle_tickless();
     }
     return;
 }
+
+//没有线程可运行时停掉周期时钟中断,让CPU停在hlt上,直到单次计数到期或别的中断到来
+//没有TSC时墙上时间靠krltime_tick数kt_ticks,停掉时钟中断会丢时间,只能保留周期时钟
+void krlcpuidle_tickless()
+{
+    cpuflg_t cpuflg;
+    hal_cli_cpuflag(&cpuflg);
+    if (krlsched_chk_idle() == FALSE)
+    {
+        hal_sti_cpuflag(&cpuflg);
+        return;
+    }
+    if (osktime.kt_tschz == 0)
+    {
+        STI_HALT();
+        CLI();
+        hal_sti_cpuflag(&cpuflg);
+        return;
+    }
+    systick_set_oneshot(TIMEONESHOT_MAX);
+    STI_HALT();
+    CLI();
+    systick_set_periodic();
+    hal_sti_cpuflag(&cpuflg);
+    return;
+}
@@ -19,6 +19,7 @@ void devtable_t_init(devtable_t *initp)
 {
     list_init(&initp->devt_list);
     krlspinlock_init(&initp->devt_lock);
+    krlspinlock_stat_name(&initp->devt_lock, "devt_lock");
     list_init(&initp->devt_devlist);
     list_init(&initp->devt_drvlist);
     initp->devt_devnr = 0;
@@ -44,6 +45,7 @@ void device_t_init(device_t *initp)
     list_init(&initp->dev_indrvlst);
     list_init(&initp->dev_intbllst);
     krlspinlock_init(&initp->dev_lock);
+    krlspinlock_stat_name(&initp->dev_lock, "dev_lock");
     initp->dev_count = 0;
     krlsem_t_init(&initp->dev_sem);
     initp->dev_stus = 0;
@@ -51,7 +53,10 @@ void device_t_init(device_t *initp)
     devid_t_init(&initp->dev_id, 0, 0, 0);
     initp->dev_intlnenr = 0;
     list_init(&initp->dev_intserlst);
-    list_init(&initp->dev_rqlist);
+    for (uint_t rq = 0; rq < IOIF_CODE_MAX; rq++)
+    {
+        list_init(&initp->dev_rqlist[rq]);
+    }
     initp->dev_rqlnr = 0;
     krlsem_t_init(&initp->dev_waitints);
     initp->dev_drv = NULL;
@@ -356,8 +361,12 @@ drvstus_t krldev_add_request(device_t *devp, objnode_t *request)
 {
     cpuflg_t cpufg;
     objnode_t *np = (objnode_t *)request;
+    if (np->on_opercode < 0 || np->on_opercode >= IOIF_CODE_MAX)
+    {
+        return DFCERRSTUS;
+    }
     krlspinlock_cli(&devp->dev_lock, &cpufg);
-    list_add_tail(&np->on_list, &devp->dev_rqlist);
+    list_add_tail(&np->on_list, &devp->dev_rqlist[np->on_opercode]);
     devp->dev_rqlnr++;
     krlspinunlock_sti(&devp->dev_lock, &cpufg);
     return DFCOKSTUS;
@@ -389,22 +398,16 @@ drvstus_t krldev_retn_request(device_t *devp, uint_t iocode, objnode_t **retreq)
         return DFCERRSTUS;
     }
     cpuflg_t cpufg;
-    objnode_t *np;
-    list_h_t *list;
     drvstus_t rets = DFCERRSTUS;
     krlspinlock_cli(&devp->dev_lock, &cpufg);
-    list_for_each(list, &devp->dev_rqlist)
+    if (list_is_empty(&devp->dev_rqlist[iocode]) == TRUE)
     {
-        np = list_entry(list, objnode_t, on_list);
-        if (np->on_opercode == (sint_t)iocode)
-        {
-            *retreq = np;
-            rets = DFCOKSTUS;
-            goto return_step;
-        }
+        *retreq = NULL;
+        rets = DFCERRSTUS;
+        goto return_step;
     }
-    rets = DFCERRSTUS;
-    *retreq = NULL;
+    *retreq = list_first_oneobj(&devp->dev_rqlist[iocode], objnode_t, on_list);
+    rets = DFCOKSTUS;
 return_step:
     krlspinunlock_sti(&devp->dev_lock, &cpufg);
     return rets;
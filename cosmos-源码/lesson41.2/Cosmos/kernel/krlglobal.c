@@ -12,6 +12,7 @@ KRL_DEFGLOB_VARIABLE(mmadrsdsc_t, initmmadrsdsc);
 KRL_DEFGLOB_VARIABLE(kmempool_t, oskmempool);
 KRL_DEFGLOB_VARIABLE(schedclass_t, osschedcls);
 KRL_DEFGLOB_VARIABLE(ktime_t, osktime);
+KRL_DEFGLOB_VARIABLE(futexbkt_t, osfutextab)[FUTEX_HASH_MAX];
 KRL_DEFGLOB_VARIABLE(syscall_t, osservicetab)
 [INR_MAX] = {
     NULL, krlsvetabl_mallocblk,
@@ -23,7 +24,10 @@ KRL_DEFGLOB_VARIABLE(syscall_t, osservicetab)
     krlsvetabl_open, krlsvetabl_close,
     krlsvetabl_read, krlsvetabl_write,
     krlsvetabl_ioctrl, krlsvetabl_lseek,
-    krlsvetabl_time,krlsvetabl_tick};
+    krlsvetabl_time,krlsvetabl_tick,
+    krlsvetabl_ioring_setup, krlsvetabl_ioring_enter,
+    krlsvetabl_futex_wait, krlsvetabl_futex_wake,
+    krlsvetabl_mmap};
 KRL_DEFGLOB_VARIABLE(devtable_t, osdevtable);
 // KRL_DEFGLOB_VARIABLE(iocheblkdsc_t,osiocheblk);
 KRL_DEFGLOB_VARIABLE(drventyexit_t, osdrvetytabl)
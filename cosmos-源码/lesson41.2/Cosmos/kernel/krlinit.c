@@ -8,6 +8,8 @@
 void init_krl()
 {
     init_krlmm();
+    init_ktime();
+    init_krlfutex();
 	init_krldevice();
     init_krldriver();
 	init_krlsched();
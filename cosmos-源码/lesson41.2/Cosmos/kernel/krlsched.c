@@ -17,6 +17,7 @@ void thrdlst_t_init(thrdlst_t *initp)
 void schdata_t_init(schdata_t *initp)
 {
     krlspinlock_init(&initp->sda_lock);
+    krlspinlock_stat_name(&initp->sda_lock, "sda_lock");
     initp->sda_cpuid = hal_retn_cpuid();
     initp->sda_schdflgs = NOTS_SCHED_FLGS;
     initp->sda_premptidx = 0;
@@ -254,6 +255,38 @@ return_step:
     return retthd;
 }
 
+//只看不改:当前CPU上没有可运行的线程就返回TRUE
+bool_t krlsched_chk_idle()
+{
+    bool_t rets = TRUE;
+    thread_t *tdtmp = NULL;
+    list_h_t *pos = NULL;
+    cpuflg_t cufg;
+    uint_t cpuid = hal_retn_cpuid();
+    schdata_t *schdap = &osschedcls.scls_schda[cpuid];
+
+    krlspinlock_cli(&schdap->sda_lock, &cufg);
+    for (uint_t pity = 0; pity < PRITY_MAX && rets == TRUE; pity++)
+    {
+        if (schdap->sda_thdlst[pity].tdl_curruntd != NULL)
+        {
+            rets = FALSE;
+            break;
+        }
+        list_for_each(pos, &(schdap->sda_thdlst[pity].tdl_lsth))
+        {
+            tdtmp = list_entry(pos, thread_t, td_list);
+            if (tdtmp->td_stus == TDSTUS_RUN || tdtmp->td_stus == TDSTUS_NEW)
+            {
+                rets = FALSE;
+                break;
+            }
+        }
+    }
+    krlspinunlock_sti(&schdap->sda_lock, &cufg);
+    return rets;
+}
+
 void krlschedul()
 {
 
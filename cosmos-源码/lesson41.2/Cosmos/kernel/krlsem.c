@@ -28,15 +28,14 @@ void krlsem_set_sem(sem_t* setsem,uint_t flg,sint_t conut)
 void krlsem_down(sem_t* sem)
 {
     cpuflg_t cpufg;
-start_step:    
     krlspinlock_cli(&sem->sem_lock,&cpufg);
     if(sem->sem_count<1)
     {
-    
+        //krlsem_up会把这个单位直接交给等得最久的线程,醒来后不用再抢
         krlwlst_wait(&sem->sem_waitlst);
         krlspinunlock_sti(&sem->sem_lock,&cpufg);
         krlschedul();
-        goto start_step; 
+        return;
     }
     sem->sem_count--;
     krlspinunlock_sti(&sem->sem_lock,&cpufg);
@@ -48,13 +47,19 @@ void krlsem_up(sem_t* sem)
     cpuflg_t cpufg;
 
     krlspinlock_cli(&sem->sem_lock,&cpufg);
+    //有线程在等就只唤醒排在最前面的一个,计数不加
+    if(krlwlst_up(&sem->sem_waitlst)==TRUE)
+    {
+        krlspinunlock_sti(&sem->sem_lock,&cpufg);
+        krlsched_set_schedflgs();
+        return;
+    }
     sem->sem_count++;
     if(sem->sem_count<1)
     {
         krlspinunlock_sti(&sem->sem_lock,&cpufg);
         hal_sysdie("sem up err");
     }
-    krlwlst_allup(&sem->sem_waitlst);
     krlspinunlock_sti(&sem->sem_lock,&cpufg);
     krlsched_set_schedflgs();
     return;
@@ -44,4 +44,20 @@ void krlspinunlock_sti(spinlock_t* lock,cpuflg_t* cpuflg)
     knl_spinunlock_sti(lock,cpuflg);
 #endif
     return;
+}
+
+void krlspinlock_stat_name(spinlock_t* lock,char_t* name)
+{
+#if((defined CFG_X86_PLATFORM))       
+    hal_spinlock_stat_name(lock,name);
+#endif
+    return;
+}
+
+void krlspinlock_stat_dump()
+{
+#if((defined CFG_X86_PLATFORM))       
+    hal_spinlock_stat_dump();
+#endif
+    return;
 }
\ No newline at end of file
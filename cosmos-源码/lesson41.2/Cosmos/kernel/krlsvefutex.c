@@ -0,0 +1,108 @@
+/**********************************************************
+        内核服务文件krlsvefutex.c
+***********************************************************
+                彭东 
+**********************************************************/
+#include "cosmostypes.h"
+#include "cosmosmctrl.h"
+
+void futexbkt_t_init(futexbkt_t *initp)
+{
+    krlspinlock_init(&initp->fb_lock);
+    list_init(&initp->fb_list);
+    return;
+}
+
+void init_krlfutex()
+{
+    for (uint_t i = 0; i < FUTEX_HASH_MAX; i++)
+    {
+        futexbkt_t_init(&osfutextab[i]);
+    }
+    return;
+}
+
+sysstus_t krlsvetabl_futex_wait(uint_t inr, stkparame_t *stkparv)
+{
+    if (inr != INR_FUTEX_WAIT)
+    {
+        return SYSSTUSERR;
+    }
+    return krlsve_futex_wait((u32_t *)stkparv->parmv1, (u32_t)stkparv->parmv2);
+}
+
+sysstus_t krlsvetabl_futex_wake(uint_t inr, stkparame_t *stkparv)
+{
+    if (inr != INR_FUTEX_WAKE)
+    {
+        return SYSSTUSERR;
+    }
+    return krlsve_futex_wake((u32_t *)stkparv->parmv1, (uint_t)stkparv->parmv2);
+}
+
+//*uadr还等于val才睡下,否则说明锁已经变了,直接返回让应用程序重试
+//比较和入桶都在桶锁里做,不会漏掉另一个线程的唤醒
+sysstus_t krlsve_futex_wait(u32_t *uadr, u32_t val)
+{
+    thread_t *currtd = krlsched_retn_currthread();
+    futexbkt_t *bktp;
+    futexwt_t fwt;
+    cpuflg_t cpufg;
+    if (uadr == NULL || ((uint_t)uadr & 3) != 0)
+    {
+        return SYSSTUSERR;
+    }
+    bktp = &osfutextab[FUTEX_HASH(currtd->td_mmdsc, uadr)];
+    list_init(&fwt.fw_list);
+    fwt.fw_mmdsc = (void *)currtd->td_mmdsc;
+    fwt.fw_uadr = uadr;
+    kwlst_t_init(&fwt.fw_wlst);
+
+    krlspinlock_cli(&bktp->fb_lock, &cpufg);
+    if (*(volatile u32_t *)uadr != val)
+    {
+        krlspinunlock_sti(&bktp->fb_lock, &cpufg);
+        return SYSSTUSERR;
+    }
+    list_add_tail(&fwt.fw_list, &bktp->fb_list);
+    krlwlst_wait(&fwt.fw_wlst);
+    krlspinunlock_sti(&bktp->fb_lock, &cpufg);
+    krlschedul();
+    return SYSSTUSOK;
+}
+
+//按等待的先后唤醒最多nr个等在uadr上的线程,返回唤醒的个数
+sysstus_t krlsve_futex_wake(u32_t *uadr, uint_t nr)
+{
+    thread_t *currtd = krlsched_retn_currthread();
+    futexbkt_t *bktp;
+    futexwt_t *fwtp;
+    list_h_t *pos, *next;
+    cpuflg_t cpufg;
+    uint_t woken = 0;
+    if (uadr == NULL || ((uint_t)uadr & 3) != 0)
+    {
+        return SYSSTUSERR;
+    }
+    bktp = &osfutextab[FUTEX_HASH(currtd->td_mmdsc, uadr)];
+
+    krlspinlock_cli(&bktp->fb_lock, &cpufg);
+    for (pos = bktp->fb_list.next; pos != &bktp->fb_list && woken < nr; pos = next)
+    {
+        next = pos->next;
+        fwtp = list_entry(pos, futexwt_t, fw_list);
+        if (fwtp->fw_uadr != uadr || fwtp->fw_mmdsc != (void *)currtd->td_mmdsc)
+        {
+            continue;
+        }
+        list_del(&fwtp->fw_list);
+        krlwlst_up(&fwtp->fw_wlst);
+        woken++;
+    }
+    krlspinunlock_sti(&bktp->fb_lock, &cpufg);
+    if (woken > 0)
+    {
+        krlsched_set_schedflgs();
+    }
+    return (sysstus_t)woken;
+}
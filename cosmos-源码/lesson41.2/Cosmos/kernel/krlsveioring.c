@@ -0,0 +1,93 @@
+/**********************************************************
+        内核服务文件krlsveioring.c
+***********************************************************
+                彭东 
+**********************************************************/
+#include "cosmostypes.h"
+#include "cosmosmctrl.h"
+sysstus_t krlsvetabl_ioring_setup(uint_t inr, stkparame_t *stkparv)
+{
+    if (inr != INR_IO_SETUP)
+    {
+        return SYSSTUSERR;
+    }
+    return krlsve_ioring_setup((ioring_t *)stkparv->parmv1);
+}
+
+sysstus_t krlsvetabl_ioring_enter(uint_t inr, stkparame_t *stkparv)
+{
+    if (inr != INR_IO_ENTER)
+    {
+        return SYSSTUSERR;
+    }
+    return krlsve_ioring_enter((uint_t)stkparv->parmv1);
+}
+
+//登记当前线程的提交/完成环,ring为NULL时注销
+sysstus_t krlsve_ioring_setup(ioring_t *ring)
+{
+    thread_t *currtd = krlsched_retn_currthread();
+    if (ring != NULL)
+    {
+        ring->ior_sqhead = 0;
+        ring->ior_sqtail = 0;
+        ring->ior_cqhead = 0;
+        ring->ior_cqtail = 0;
+    }
+    currtd->td_ioring = (void *)ring;
+    return SYSSTUSOK;
+}
+
+//一次系统调用处理最多tosubmit个提交项,返回处理了多少个
+//完成环满了就停下,剩下的留给下一次
+//提交项逐个走krlsve_read/write等同步路径,返回时都已完成,省的只是每个请求一次的系统调用;
+//驱动都在分发函数里同步完成I/O,没有请求队列可供成批取走和成批完成
+//(那还需要内核缓冲区和按文件偏移的读写,驱动工作线程访问不了提交者的用户空间)
+sysstus_t krlsve_ioring_enter(uint_t tosubmit)
+{
+    thread_t *currtd = krlsched_retn_currthread();
+    ioring_t *ring = (ioring_t *)currtd->td_ioring;
+    iosqe_t *sqe;
+    iocqe_t *cqe;
+    uint_t done = 0;
+    if (ring == NULL)
+    {
+        return SYSSTUSERR;
+    }
+    while (done < tosubmit && ring->ior_sqhead != ring->ior_sqtail)
+    {
+        if (ring->ior_cqtail - ring->ior_cqhead >= IORING_ENTRY_MAX)
+        {
+            break;
+        }
+        sqe = &ring->ior_sq[ring->ior_sqhead & IORING_ENTRY_MASK];
+        cqe = &ring->ior_cq[ring->ior_cqtail & IORING_ENTRY_MASK];
+        cqe->cqe_udata = sqe->sqe_udata;
+        cqe->cqe_rets = krlsve_ioring_exec(sqe);
+        __asm__ __volatile__("" : : : "memory");
+        ring->ior_cqtail++;
+        ring->ior_sqhead++;
+        done++;
+    }
+    return (sysstus_t)done;
+}
+
+sysstus_t krlsve_ioring_exec(iosqe_t *sqe)
+{
+    switch (sqe->sqe_opcode)
+    {
+    case IORING_OP_NOP:
+        return SYSSTUSOK;
+    case IORING_OP_READ:
+        return krlsve_read(sqe->sqe_hand, sqe->sqe_buf, sqe->sqe_len, sqe->sqe_flgs);
+    case IORING_OP_WRITE:
+        return krlsve_write(sqe->sqe_hand, sqe->sqe_buf, sqe->sqe_len, sqe->sqe_flgs);
+    case IORING_OP_IOCTRL:
+        return krlsve_ioctrl(sqe->sqe_hand, sqe->sqe_buf, (uint_t)sqe->sqe_len, sqe->sqe_flgs);
+    case IORING_OP_LSEEK:
+        return krlsve_lseek(sqe->sqe_hand, (uint_t)sqe->sqe_len, sqe->sqe_flgs);
+    default:
+        break;
+    }
+    return SYSSTUSERR;
+}
@@ -17,10 +17,32 @@ sysstus_t krlsvetabl_lseek(uint_t inr, stkparame_t *stkparv)
 
 sysstus_t krlsve_lseek(hand_t fhand, uint_t lofset, uint_t flgs)
 {
-    return SYSSTUSERR;
+    if (fhand <= NO_HAND || fhand >= TD_HAND_MAX)
+    {
+        return SYSSTUSERR;
+    }
+    return krlsve_core_lseek(fhand, lofset, flgs);
 }
 
 sysstus_t krlsve_core_lseek(hand_t fhand, uint_t lofset, uint_t flgs)
 {
-    return SYSSTUSERR;
+    thread_t *currtd = krlsched_retn_currthread();
+    objnode_t *onp = krlthd_retn_objnode(currtd, fhand);
+    if (onp == NULL || onp->on_objadr == NULL)
+    {
+        return SYSSTUSERR;
+    }
+    if (onp->on_objtype != OBJN_TY_FIL)
+    {
+        return SYSSTUSERR;
+    }
+    //on_len传递新的文件偏移,由文件系统驱动检查并设置on_currops
+    onp->on_opercode = IOIF_CODE_LSEEK;
+    onp->on_len = lofset;
+    onp->on_acsflgs = flgs;
+    if (krldev_io(onp) == DFCERRSTUS)
+    {
+        return SYSSTUSERR;
+    }
+    return SYSSTUSOK;
 }
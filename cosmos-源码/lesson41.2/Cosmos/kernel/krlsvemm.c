@@ -25,6 +25,16 @@ sysstus_t krlsvetabl_mfreeblk(uint_t inr, stkparame_t *stkparv)
     return krlsve_mfreeblk((void *)stkparv->parmv1, (size_t)stkparv->parmv2);
 }
 
+sysstus_t krlsvetabl_mmap(uint_t inr, stkparame_t *stkparv)
+{
+    if (inr != INR_MM_MAP)
+    {
+        return SYSSTUSERR;
+    }
+    return (sysstus_t)krlsve_mmap((hand_t)stkparv->parmv1, (size_t)stkparv->parmv2,
+                                  (uint_t)stkparv->parmv3);
+}
+
 void *krlsve_mallocblk(size_t blksz)
 {
    
@@ -56,4 +66,61 @@ sysstus_t krlsve_core_mfreeblk(void *fradr, size_t blksz)
     // kprint("krlsve_core_mfreeblk:%x :%x\n", (uint_t)fradr, blksz);
 
     return SYSSTUSOK;
-}
\ No newline at end of file
+}
+
+void *krlsve_mmap(hand_t fhand, size_t len, uint_t flgs)
+{
+    if (fhand <= NO_HAND || fhand >= TD_HAND_MAX || len < 1)
+    {
+        return NULL;
+    }
+    return krlsve_core_mmap(fhand, len, flgs);
+}
+
+void *krlsve_core_mmap(hand_t fhand, size_t len, uint_t flgs)
+{
+    mmadrsdsc_t *mm = krl_curr_mmadrsdsc();
+    thread_t *currtd = krlsched_retn_currthread();
+    objnode_t *onp = krlthd_retn_objnode(currtd, fhand);
+    uint_t pgnr = VADSZ_ALIGN(len) >> PAGE_SZRBIT;
+    adr_t retvadr = NULL;
+    adr_t *pages = NULL;
+    if (onp == NULL || onp->on_objtype != OBJN_TY_FIL)
+    {
+        return NULL;
+    }
+    pages = (adr_t *)krlnew(pgnr * sizeof(adr_t));
+    if (pages == NULL)
+    {
+        return NULL;
+    }
+    //向文件系统要文件数据所在的内存页,映射它们而不是复制
+    onp->on_opercode = IOIF_CODE_IOCTRL;
+    onp->on_ioctrd = FSDEV_IOCTRCD_FILEPAGES;
+    onp->on_buf = (buf_t)pages;
+    onp->on_len = pgnr;
+    onp->on_bufsz = pgnr * sizeof(adr_t);
+    onp->on_acsflgs = flgs;
+    if (krldev_io(onp) == DFCERRSTUS)
+    {
+        goto out;
+    }
+    //文件系统给的映射计数由映射区持有,映射区释放时减1
+    retvadr = vma_new_vadrs(mm, NULL, len, 0, KMV_FILE_TYPE);
+    if (retvadr == NULL)
+    {
+        refcount_dec((refcount_t *)onp->on_extp);
+        goto out;
+    }
+    if (vma_map_filepages(mm, retvadr, pages, onp->on_len, (refcount_t *)onp->on_extp) == FALSE)
+    {
+        vma_del_vadrs(mm, retvadr, len);
+        retvadr = NULL;
+    }
+out:
+    if (krldelete((adr_t)pages, pgnr * sizeof(adr_t)) == FALSE)
+    {
+        hal_sysdie("mmap del pages err");
+    }
+    return (void *)retvadr;
+}
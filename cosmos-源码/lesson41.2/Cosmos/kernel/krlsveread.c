@@ -38,7 +38,7 @@ sysstus_t krlsve_core_read(hand_t fhand, buf_t buf, size_t len, uint_t flgs)
         onp->on_opercode = IOIF_CODE_READ;
         onp->on_buf = buf;
         onp->on_len = len;
-        onp->on_bufsz = 0x1000;
+        onp->on_bufsz = len;
         onp->on_acsflgs = flgs;
         return krlsve_read_device(onp);
     }
@@ -55,5 +55,6 @@ sysstus_t krlsve_read_device(objnode_t *ondep)
     {
         return SYSSTUSERR;
     }
-    return SYSSTUSOK;
+    //驱动把on_len改成实际读到的字节数,读到文件末尾时为0
+    return (sysstus_t)ondep->on_len;
 }
@@ -40,7 +40,7 @@ sysstus_t krlsve_core_write(hand_t fhand, buf_t buf, size_t len, uint_t flgs)
         onp->on_opercode = IOIF_CODE_WRITE;
         onp->on_buf = buf;
         onp->on_len = len;
-        onp->on_bufsz = 0x1000;
+        onp->on_bufsz = len;
         onp->on_acsflgs = flgs;
 
         return krlsve_write_device(onp);
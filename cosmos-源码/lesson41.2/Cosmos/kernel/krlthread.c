@@ -49,6 +49,7 @@ void thread_t_init(thread_t *initp)
     initp->td_resdsc = NULL;
     initp->td_privtep = NULL;
     initp->td_extdatap = NULL;
+    initp->td_ioring = NULL;
     initp->td_appfilenm = NULL;
     initp->td_appfilenmlen = 0;
     context_t_init(&initp->td_context);
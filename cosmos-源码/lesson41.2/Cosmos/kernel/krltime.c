@@ -9,6 +9,13 @@
 void ktime_t_init(ktime_t *initp)
 {
     krlspinlock_init(&initp->kt_lock);
+    initp->kt_seq = 0;
+    initp->kt_tickless = 0;
+    initp->kt_ticks = 0;
+    initp->kt_tschz = 0;
+    initp->kt_boottsc = 0;
+    initp->kt_basetsc = 0;
+    initp->kt_basesecs = 0;
     initp->kt_year = 0;
     initp->kt_mon = 0;
     initp->kt_day = 0;
@@ -23,16 +30,101 @@ void ktime_t_init(ktime_t *initp)
 void init_ktime()
 {
     ktime_t_init(&osktime);
+    krltime_calibrate_tsc();
+    krlupdate_times_from_cmos();
+    kprint("时间初始化成功 TSC:%dHz\n", osktime.kt_tschz);
     return;
 }
 
+//用8254的通道2定时1/KTIME_CALIB_HZ秒,数这段时间里TSC走了多少
+void krltime_calibrate_tsc()
+{
+    ktime_t *initp = &osktime;
+    uint_t count = KTIME_PIT_HZ / KTIME_CALIB_HZ, loops = 0;
+    u8_t gate = in_u8(PIT_CH2_GATE_PORT), stus;
+    u64_t stsc, etsc;
+    cpuflg_t cpufg;
+
+    hal_cli_cpuflag(&cpufg);
+    //打开通道2的门控,关掉扬声器
+    out_u8(PIT_CH2_GATE_PORT, (u8_t)((gate & ~PIT_CH2_SPKR) | PIT_CH2_GATE));
+    out_u8(PTIPROTM, PIT_CH2_MODE0);
+    out_u8(PTIPROT3, (u8_t)(count & 0xff));
+    out_u8(PTIPROT3, (u8_t)((count >> 8) & 0xff));
+    stsc = x86_rdtsc();
+    do
+    {
+        stus = in_u8(PIT_CH2_GATE_PORT);
+    } while ((stus & PIT_CH2_OUT) == 0 && ++loops < 0x10000000);
+    etsc = x86_rdtsc();
+    out_u8(PIT_CH2_GATE_PORT, gate);
+    hal_sti_cpuflag(&cpufg);
+
+    if ((stus & PIT_CH2_OUT) == 0 || etsc <= stsc)
+    {
+        //通道2没有计完,TSC不能用,只好继续读CMOS
+        initp->kt_tschz = 0;
+        return;
+    }
+    initp->kt_tschz = (etsc - stsc) * KTIME_CALIB_HZ;
+    initp->kt_boottsc = etsc;
+    return;
+}
+
+uint_t krltime_to_secs(uint_t year, uint_t mon, uint_t day, uint_t hour, uint_t min, uint_t sec)
+{
+    uint_t days = 0;
+    for (uint_t y = 0; y < year; y++)
+    {
+        days += KTIME_LEAP(y) ? 366 : 365;
+    }
+    for (uint_t m = 1; m < mon; m++)
+    {
+        days += ktime_mon_days(year, m);
+    }
+    if (day > 0)
+    {
+        days += day - 1;
+    }
+    return ((days * 24 + hour) * 60 + min) * 60 + sec;
+}
+
+void krltime_from_secs(uint_t secs, time_t *time)
+{
+    uint_t days = secs / 86400, rem = secs % 86400, y = 0, m = 1;
+    time->hour = rem / 3600;
+    time->min = (rem % 3600) / 60;
+    time->sec = rem % 60;
+    while (days >= (uint_t)(KTIME_LEAP(y) ? 366 : 365))
+    {
+        days -= KTIME_LEAP(y) ? 366 : 365;
+        y++;
+    }
+    while (days >= ktime_mon_days(y, m))
+    {
+        days -= ktime_mon_days(y, m);
+        m++;
+    }
+    time->year = y;
+    time->mon = m;
+    time->day = days + 1;
+    return;
+}
 
 void krlupdate_times_from_cmos()
 {
     ktime_t *initp = &osktime;
     u8_t tmptm;
+    uint_t loops = 0;
     cpuflg_t cpufg;
     krlspinlock_cli(&initp->kt_lock, &cpufg);
+    //等CMOS更新完,以免读到一半新一半旧的时间
+    do
+    {
+        CMOS_READ(tmptm, CMOS_STATA_ADR);
+    } while ((tmptm & CMOS_STATA_UIP) != 0 && ++loops < 0x100000);
+    initp->kt_seq++;
+    __asm__ __volatile__("" : : : "memory");
 	CMOS_READ(tmptm,CMOS_SEC_ADR);
     initp->kt_sec = bcd_to_bin(tmptm);
     CMOS_READ(tmptm,CMOS_MIN_ADR);
@@ -45,19 +137,58 @@ void krlupdate_times_from_cmos()
     initp->kt_mon = bcd_to_bin(tmptm);
     CMOS_READ(tmptm,CMOS_YEAR_ADR);
     initp->kt_year = bcd_to_bin(tmptm);
+    initp->kt_basesecs = krltime_to_secs(initp->kt_year, initp->kt_mon, initp->kt_day,
+                                         initp->kt_hour, initp->kt_min, initp->kt_sec);
+    initp->kt_basetsc = x86_rdtsc();
+    __asm__ __volatile__("" : : : "memory");
+    initp->kt_seq++;
     // kprint("osktime y:%d,m:%x,d:%d,h:%d,m:%d,s:%d\n", initp->kt_year, initp->kt_mon,initp->kt_day,
     //                                                     initp->kt_hour, initp->kt_min, initp->kt_sec);
     krlspinunlock_sti(&initp->kt_lock, &cpufg);
     return;
 }
 
+//时钟中断里调用,有TSC时只在隔了KTIME_RESYNC_SECS秒后才读CMOS
+void krltime_tick()
+{
+    ktime_t *initp = &osktime;
+    if (initp->kt_tschz != 0)
+    {
+        if (x86_rdtsc() - initp->kt_basetsc >= initp->kt_tschz * KTIME_RESYNC_SECS)
+        {
+            krlupdate_times_from_cmos();
+        }
+        return;
+    }
+    if (++initp->kt_ticks >= HZ)
+    {
+        initp->kt_ticks = 0;
+        krlupdate_times_from_cmos();
+    }
+    return;
+}
 
+//开机(校准TSC)以来的微秒数,没有TSC时返回0
+u64_t krltime_retn_usecs()
+{
+    ktime_t *initp = &osktime;
+    u64_t delta;
+    if (initp->kt_tschz == 0)
+    {
+        return 0;
+    }
+    delta = x86_rdtsc() - initp->kt_boottsc;
+    return (delta / initp->kt_tschz) * 1000000 +
+           ((delta % initp->kt_tschz) * 1000000) / initp->kt_tschz;
+}
 
 void krlupdate_times(uint_t year, uint_t mon, uint_t day, uint_t date, uint_t hour, uint_t min, uint_t sec)
 {
     ktime_t *initp = &osktime;
     cpuflg_t cpufg;
     krlspinlock_cli(&initp->kt_lock, &cpufg);
+    initp->kt_seq++;
+    __asm__ __volatile__("" : : : "memory");
     initp->kt_year = year;
     initp->kt_mon = mon;
     initp->kt_day = day;
@@ -65,6 +196,10 @@ void krlupdate_times(uint_t year, uint_t mon, uint_t day, uint_t date, uint_t ho
     initp->kt_hour = hour;
     initp->kt_min = min;
     initp->kt_sec = sec;
+    initp->kt_basesecs = krltime_to_secs(year, mon, day, hour, min, sec);
+    initp->kt_basetsc = x86_rdtsc();
+    __asm__ __volatile__("" : : : "memory");
+    initp->kt_seq++;
     krlspinunlock_sti(&initp->kt_lock, &cpufg);
     return;
 }
@@ -78,6 +213,7 @@ sysstus_t krlsvetabl_time(uint_t inr, stkparame_t *stkparv)
     return krlsve_time((time_t *)stkparv->parmv1);
 }
 
+//不加锁也不读CMOS:按顺序计数读出上次同步的时间和TSC,再加上TSC走过的秒数
 sysstus_t krlsve_time(time_t *time)
 {
     if (time == NULL)
@@ -86,16 +222,25 @@ sysstus_t krlsve_time(time_t *time)
     }
 
     ktime_t *initp = &osktime;
-    cpuflg_t cpufg;
-    krlspinlock_cli(&initp->kt_lock, &cpufg);
-    time->year = initp->kt_year;
-    time->mon = initp->kt_mon;
-    time->day = initp->kt_day;
-    time->date = initp->kt_date;
-    time->hour = initp->kt_hour;
-    time->min = initp->kt_min;
-    time->sec = initp->kt_sec;
-    krlspinunlock_sti(&initp->kt_lock, &cpufg);
+    uint_t seq, secs, date;
+    u64_t basetsc, tschz;
+    do
+    {
+        seq = *(volatile uint_t *)&initp->kt_seq;
+        __asm__ __volatile__("" : : : "memory");
+        secs = initp->kt_basesecs;
+        date = initp->kt_date;
+        basetsc = initp->kt_basetsc;
+        tschz = initp->kt_tschz;
+        __asm__ __volatile__("" : : : "memory");
+    } while ((seq & 1) != 0 || seq != *(volatile uint_t *)&initp->kt_seq);
+
+    if (tschz != 0)
+    {
+        secs += (uint_t)((x86_rdtsc() - basetsc) / tschz);
+    }
+    krltime_from_secs(secs, time);
+    time->date = date;
 
     return SYSSTUSOK;
 }
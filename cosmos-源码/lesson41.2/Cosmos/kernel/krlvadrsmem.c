@@ -484,7 +484,8 @@ adr_t vma_new_vadrs_core(mmadrsdsc_t *mm, adr_t start, size_t vassize, u64_t vas
 		goto out;
 	}
 
-	if (((NULL == start) || (start == currkmvd->kva_end)) && (vaslimits == currkmvd->kva_limits) && (vastype == currkmvd->kva_maptype))
+	//文件映射区各自有自己的kvmemcbox,不能与相邻的区合并
+	if (((NULL == start) || (start == currkmvd->kva_end)) && (vaslimits == currkmvd->kva_limits) && (vastype == currkmvd->kva_maptype) && (KMV_FILE_TYPE != vastype))
 	{
 		retadrs = currkmvd->kva_end;
 		currkmvd->kva_end += vassize;
@@ -607,7 +608,8 @@ bool_t vma_del_unmapping_phyadrs(mmadrsdsc_t *mm, kmvarsdsc_t *kmvd, adr_t start
 		phyadrs = hal_mmu_untransform(mmu, vadrs);
 		if (NULL != phyadrs && NULL != kmbox)
 		{
-			if (vma_del_usermsa(mm, kmbox, NULL, phyadrs) == FALSE)
+			//文件映射区里未写过的页属于文件系统,不在kmbox中
+			if (vma_del_usermsa(mm, kmbox, NULL, phyadrs) == FALSE && NULL == kmbox->kmb_filenode)
 			{
 				rets = FALSE;
 			}
@@ -1175,6 +1177,74 @@ adr_t vma_map_phyadrs(mmadrsdsc_t *mm, kmvarsdsc_t *kmvd, adr_t vadrs, u64_t fla
 	return vma_map_msa_fault(mm, kmbox, vadrs, flags);
 }
 
+//filenode是文件的映射计数,成功与否都由本函数接管,挂到kmbox上后在kmbox释放时减1
+bool_t vma_map_filepages(mmadrsdsc_t *mm, adr_t vadrs, adr_t *pages, uint_t pgnr, refcount_t *filenode)
+{
+	bool_t rets = FALSE;
+	virmemadrs_t *vma = &mm->msd_virmemadrs;
+	kmvarsdsc_t *kmvd = NULL;
+	kvmemcbox_t *kmbox = NULL;
+	cpuflg_t cpuflg;
+	krlspinlock_cli(&vma->vs_lock, &cpuflg);
+	kmvd = vma_map_find_kmvarsdsc(vma, vadrs);
+	if (NULL == kmvd || KMV_FILE_TYPE != kmvd->kva_maptype ||
+		(vadrs + (pgnr << PAGE_SZRBIT)) > kmvd->kva_end)
+	{
+		refcount_dec(filenode);
+		rets = FALSE;
+		goto out;
+	}
+	kmbox = vma_map_retn_kvmemcbox(kmvd);
+	if (NULL == kmbox)
+	{
+		refcount_dec(filenode);
+		rets = FALSE;
+		goto out;
+	}
+	kmbox->kmb_filenode = (void *)filenode;
+	//文件页只读映射,谁写谁在缺页时得到一份自己的副本
+	for (uint_t i = 0; i < pgnr; i++)
+	{
+		if (hal_mmu_transform(&mm->msd_mmu, vadrs + (i << PAGE_SZRBIT),
+							  viradr_to_phyadr(pages[i]), (0 | PML4E_US | PML4E_P)) == FALSE)
+		{
+			rets = FALSE;
+			goto out;
+		}
+	}
+	rets = TRUE;
+out:
+	krlspinunlock_sti(&vma->vs_lock, &cpuflg);
+	return rets;
+}
+
+adr_t vma_map_cow_fault(mmadrsdsc_t *mm, kvmemcbox_t *kmbox, adr_t vadrs)
+{
+	msadsc_t *usermsa;
+	adr_t oldphy = NULL, newphy = NULL;
+	vadrs &= (~0xfffUL);
+	oldphy = hal_mmu_untransform(&mm->msd_mmu, vadrs);
+	if (NULL == oldphy)
+	{
+		//文件之外的部分,和普通内存一样分配
+		return vma_map_msa_fault(mm, kmbox, vadrs, (0 | PML4E_US | PML4E_RW | PML4E_P));
+	}
+	usermsa = vma_new_usermsa(mm, kmbox);
+	if (NULL == usermsa)
+	{
+		hal_mmu_transform(&mm->msd_mmu, vadrs, oldphy, (0 | PML4E_US | PML4E_P));
+		return NULL;
+	}
+	newphy = msadsc_ret_addr(usermsa);
+	krlmemcopy((void *)phyadr_to_viradr(oldphy), (void *)phyadr_to_viradr(newphy), VMAP_MIN_SIZE);
+	if (hal_mmu_transform(&mm->msd_mmu, vadrs, newphy, (0 | PML4E_US | PML4E_RW | PML4E_P)) == TRUE)
+	{
+		return newphy;
+	}
+	vma_del_usermsa(mm, kmbox, usermsa, newphy);
+	return NULL;
+}
+
 //这样的骚操作只是暂时为之
 void vma_full_textbin(mmadrsdsc_t* mm, kmvarsdsc_t* kmvd, adr_t vadr)
 {
@@ -1226,7 +1296,14 @@ sint_t vma_map_fairvadrs_core(mmadrsdsc_t *mm, adr_t vadrs)
 		rets = -ENOOBJ;
 		goto out;
 	}
-	phyadrs = vma_map_phyadrs(mm, kmvd, vadrs, (0 | PML4E_US | PML4E_RW | PML4E_P));
+	if (NULL != kmbox->kmb_filenode)
+	{
+		phyadrs = vma_map_cow_fault(mm, kmbox, vadrs);
+	}
+	else
+	{
+		phyadrs = vma_map_phyadrs(mm, kmvd, vadrs, (0 | PML4E_US | PML4E_RW | PML4E_P));
+	}
 	if (NULL == phyadrs)
 	{
 		kprint("vma_map_phyadrs null %x\n", vadrs);
@@ -1500,6 +1577,12 @@ bool_t knl_put_kvmemcbox(kvmemcbox_t* kmbox)
 		rets = TRUE;
 		goto out;
 	}
+	//文件映射区不再引用文件了
+	if(NULL != kmbox->kmb_filenode)
+	{
+		refcount_dec((refcount_t *)kmbox->kmb_filenode);
+		kmbox->kmb_filenode = NULL;
+	}
 	
 	if(kmbmgr->kbm_cachenr >= kmbmgr->kbm_cachemax)
 	{
@@ -18,15 +18,15 @@ void krlwlst_wait(kwlst_t *wlst)
     krlsched_wait(wlst);
     return;
 }
-void krlwlst_up(kwlst_t *wlst)
+bool_t krlwlst_up(kwlst_t *wlst)
 {
     if (list_is_empty_careful(&wlst->wl_list) == TRUE)
     {
-        return;
+        return FALSE;
     }
     krlsched_up(wlst);
 
-    return;
+    return TRUE;
 }
 
 void krlwlst_allup(kwlst_t *wlst)
@@ -43,7 +43,8 @@ void krlwlst_add_thread(kwlst_t *wlst, thread_t *tdp)
     cpuflg_t cufg;
     krlspinlock_cli(&wlst->wl_lock, &cufg);
 
-    list_add(&tdp->td_list, &wlst->wl_list);
+    //排到队尾,krlwlst_del_thread从队头取,先等先醒
+    list_add_tail(&tdp->td_list, &wlst->wl_list);
     wlst->wl_tdnr++;
     krlspinunlock_sti(&wlst->wl_lock, &cufg);
     return;
@@ -0,0 +1,22 @@
+/**********************************************************
+        线程同步API文件lapifutex.c
+***********************************************************
+                彭东
+**********************************************************/
+#include "libtypes.h"
+#include "libheads.h"
+
+
+sysstus_t api_futex_wait(u32_t* uadr,u32_t val)
+{
+    sysstus_t rets;
+    API_ENTRY_PARE2(INR_FUTEX_WAIT,rets,uadr,(uint_t)val);
+    return rets;
+}
+
+sysstus_t api_futex_wake(u32_t* uadr,uint_t nr)
+{
+    sysstus_t rets;
+    API_ENTRY_PARE2(INR_FUTEX_WAKE,rets,uadr,nr);
+    return rets;
+}
@@ -0,0 +1,22 @@
+/**********************************************************
+        文件管理API文件lapiioring.c
+***********************************************************
+                彭东
+**********************************************************/
+#include "libtypes.h"
+#include "libheads.h"
+
+
+sysstus_t api_ioring_setup(ioring_t* ring)
+{
+    sysstus_t rets;
+    API_ENTRY_PARE1(INR_IO_SETUP,rets,ring);
+    return rets;
+}
+
+sysstus_t api_ioring_enter(uint_t tosubmit)
+{
+    sysstus_t rets;
+    API_ENTRY_PARE1(INR_IO_ENTER,rets,tosubmit);
+    return rets;
+}
@@ -18,4 +18,11 @@ sysstus_t api_mfreeblk(void* fradr,size_t blksz)
     sysstus_t retstus;
     API_ENTRY_PARE2(INR_MM_FREE,retstus,fradr,blksz);
     return retstus;
+}
+
+void* api_mmap(hand_t fhand,size_t len,uint_t flgs)
+{
+    void* retadr;
+    API_ENTRY_PARE3(INR_MM_MAP,retadr,fhand,len,flgs);
+    return retadr;
 }
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "libc.h"
+
+static u32_t umutex_cmpxchg(u32_t *p, u32_t old, u32_t new)
+{
+    u32_t prev;
+    __asm__ __volatile__("lock; cmpxchgl %2,%1"
+                         : "=a"(prev), "+m"(*p)
+                         : "r"(new), "0"(old)
+                         : "memory");
+    return prev;
+}
+
+static u32_t umutex_xchg(u32_t *p, u32_t val)
+{
+    __asm__ __volatile__("xchgl %0,%1"
+                         : "+r"(val), "+m"(*p)
+                         :
+                         : "memory");
+    return val;
+}
+
+void umutex_init(umutex_t *mtx)
+{
+    mtx->um_val = 0;
+    return;
+}
+
+//没人争的时候一条cmpxchg就拿到锁,不进内核
+void umutex_lock(umutex_t *mtx)
+{
+    u32_t c = umutex_cmpxchg(&mtx->um_val, 0, 1);
+    if (c == 0)
+    {
+        return;
+    }
+    if (c != 2)
+    {
+        c = umutex_xchg(&mtx->um_val, 2);
+    }
+    while (c != 0)
+    {
+        api_futex_wait(&mtx->um_val, 2);
+        c = umutex_xchg(&mtx->um_val, 2);
+    }
+    return;
+}
+
+//只有可能有人在等(值为2)时才进内核唤醒一个
+void umutex_unlock(umutex_t *mtx)
+{
+    if (umutex_xchg(&mtx->um_val, 0) == 2)
+    {
+        api_futex_wake(&mtx->um_val, 1);
+    }
+    return;
+}
@@ -0,0 +1,44 @@
+#include "libc.h"
+
+sysstus_t ioring_setup(ioring_t *ring)
+{
+    return api_ioring_setup(ring);
+}
+
+//取一个空闲的提交项,填好后由ioring_submit一次交给内核
+iosqe_t *ioring_get_sqe(ioring_t *ring)
+{
+    iosqe_t *sqe;
+    if (ring->ior_sqtail - ring->ior_sqhead >= IORING_ENTRY_MAX)
+    {
+        return NULL;
+    }
+    sqe = &ring->ior_sq[ring->ior_sqtail & IORING_ENTRY_MASK];
+    ring->ior_sqtail++;
+    return sqe;
+}
+
+sysstus_t ioring_submit(ioring_t *ring)
+{
+    uint_t pending = ring->ior_sqtail - ring->ior_sqhead;
+    if (pending == 0)
+    {
+        return 0;
+    }
+    return api_ioring_enter(pending);
+}
+
+iocqe_t *ioring_peek_cqe(ioring_t *ring)
+{
+    if (ring->ior_cqhead == ring->ior_cqtail)
+    {
+        return NULL;
+    }
+    return &ring->ior_cq[ring->ior_cqhead & IORING_ENTRY_MASK];
+}
+
+void ioring_cqe_seen(ioring_t *ring)
+{
+    ring->ior_cqhead++;
+    return;
+}
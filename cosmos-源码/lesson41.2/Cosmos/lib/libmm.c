@@ -12,3 +12,10 @@ sysstus_t mfreeblk(void* fradr,size_t blksz)
     return retstus;
 }
 
+//映射文件,写入映射区不会改变文件;用mfreeblk解除映射
+void* mmap(hand_t fhand,size_t len,uint_t flgs)
+{
+    void* retadr=api_mmap(fhand,len,flgs);
+    return retadr;
+}
+
@@ -1,4 +1,5 @@
 #include "libc.h"
+//成功返回读到的字节数,读到文件末尾返回0,出错返回SYSSTUSERR
 sysstus_t read(hand_t fhand,buf_t buf,size_t len,uint_t flgs)
 {
     sysstus_t rets=api_read(fhand,buf,len,flgs);
@@ -225,8 +225,8 @@ idt_descr:
 .align 2
 .word 0
 gdt_descr:
-	.word 256*8-1		# so does gdt (not that that's any
-	.long _gdt		# magic number, but it works for me :^)
+	.word 1028*8-1		# gdt has room for 512 tasks, see
+	.long _gdt		# NR_TASKS in linux/sched.h
 
 	.align 3
 _idt:	.fill 256,8,0		# idt is uninitialized
@@ -235,4 +235,4 @@ _gdt:	.quad 0x0000000000000000	/* NULL descriptor */
 	.quad 0x00c09a0000000fff	/* 16Mb */
 	.quad 0x00c0920000000fff	/* 16Mb */
 	.quad 0x0000000000000000	/* TEMPORARY - don't use */
-	.fill 252,8,0			/* space for LDT's and TSS's etc */
+	.fill 1024,8,0			/* space for LDT's and TSS's etc */
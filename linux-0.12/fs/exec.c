@@ -15,6 +15,10 @@
  *
  * Once more I can proudly say that linux stood up to being changed: it
  * was less than 2 hours work to get demand-loading completely implemented.
+ *
+ * The pages the last run of a binary used are still read in up front, in
+ * one go (prefault_wset() in mm/memory.c): a short-lived command would
+ * otherwise spend most of its life waiting for one page at a time.
  */
 
 #include <signal.h>
@@ -31,6 +35,8 @@
 
 extern int sys_exit(int exit_code);
 extern int sys_close(int fd);
+extern void save_wset(void);
+extern void prefault_wset(unsigned long entry);
 
 /*
  * MAX_ARG_PAGES defines the number of pages allocated for arguments
@@ -56,7 +62,7 @@ int sys_uselib(const char * library)
 	current->library = NULL;
 	base = get_base(current->ldt[2]);
 	base += LIBRARY_OFFSET;
-	free_page_tables(base,LIBRARY_SIZE);
+	free_page_tables(PG_DIR(current),base,LIBRARY_SIZE);
 	current->library = inode;
 	return 0;
 }
@@ -211,6 +217,7 @@ int do_execve(unsigned long * eip,long tmp,char * filename,
 	struct buffer_head * bh;
 	struct exec ex;
 	unsigned long page[MAX_ARG_PAGES];
+	unsigned long * dir = NULL;
 	int i,argc,envc;
 	int e_uid, e_gid;
 	int retval;
@@ -340,8 +347,15 @@ restart_interp:
 			goto exec_error2;
 		}
 	}
+/* a vfork()ed child needs a page directory of its own */
+	if ((current->flags & PF_VFORK) &&
+	    !(dir = (unsigned long *) get_free_page())) {
+		retval = -ENOMEM;
+		goto exec_error2;
+	}
 /* OK, This is the point of no return */
 /* note that current->library stays unchanged by an exec */
+	save_wset();
 	if (current->executable)
 		iput(current->executable);
 	current->executable = inode;
@@ -356,8 +370,16 @@ restart_interp:
 		if ((current->close_on_exec>>i)&1)
 			sys_close(i);
 	current->close_on_exec = 0;
-	free_page_tables(get_base(current->ldt[1]),get_limit(0x0f));
-	free_page_tables(get_base(current->ldt[2]),get_limit(0x17));
+	if (current->flags & PF_VFORK) {
+		for (i=0 ; i<(USER_BASE>>22) ; i++)
+			dir[i] = pg_dir[i];
+		vfork_release(dir);
+	} else {
+		free_page_tables(PG_DIR(current),get_base(current->ldt[1]),
+			get_limit(0x0f));
+		free_page_tables(PG_DIR(current),get_base(current->ldt[2]),
+			get_limit(0x17));
+	}
 	if (last_task_used_math == current)
 		last_task_used_math = NULL;
 	current->used_math = 0;
@@ -370,6 +392,7 @@ restart_interp:
 	current->start_stack = p & 0xfffff000;
 	current->suid = current->euid = e_uid;
 	current->sgid = current->egid = e_gid;
+	prefault_wset(ex.a_entry);
 	eip[0] = ex.a_entry;		/* eip, magic happens :-) */
 	eip[3] = p;			/* stack pointer */
 	return 0;
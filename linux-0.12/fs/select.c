@@ -19,6 +19,7 @@
 #include <const.h>
 #include <errno.h>
 #include <sys/time.h>
+#include <sys/epoll.h>
 #include <signal.h>
 
 /*
@@ -48,7 +49,7 @@ static void add_wait(struct task_struct ** wait_address, select_table * p)
 {
 	int i;
 
-	if (!wait_address)
+	if (!wait_address || !p)
 		return;
 	for (i = 0 ; i < p->nr ; i++)
 		if (p->entry[i].wait_address == wait_address)
@@ -67,14 +68,14 @@ static void free_wait(select_table * p)
 	for (i = 0; i < p->nr ; i++) {
 		tpp = p->entry[i].wait_address;
 		while (*tpp && *tpp != current) {
-			(*tpp)->state = 0;
+			wake_up_process(*tpp);
 			current->state = TASK_UNINTERRUPTIBLE;
 			schedule();
 		}
 		if (!*tpp)
 			printk("free_wait: NULL");
 		if (*tpp = p->entry[i].old_task)
-			(**tpp).state = 0;
+			wake_up_process(*tpp);
 	}
 	p->nr = 0;
 }
@@ -98,7 +99,8 @@ static struct tty_struct * get_tty(struct m_inode * inode)
 
 /*
  * The check_XX functions check out a file. We know it's either
- * a pipe, a character device or a fifo (fifo's not implemented)
+ * a pipe, a character device or a fifo (fifo's not implemented).
+ * With a NULL wait table they only test, epoll uses them like that.
  */
 static int check_in(select_table * wait, struct m_inode * inode)
 {
@@ -276,3 +278,253 @@ int sys_select( unsigned long *buffer )
 		return -EINTR;
 	return i;
 }
+
+/*
+ * epoll. Every process can have one interest set (current->epoll, a
+ * page allocated on the first EPOLL_CTL_ADD). Each watched descriptor
+ * hooks the wait queues select() would sleep on into ep_hash, and stays
+ * hooked until it is removed or closed. wake_up() on such a queue calls
+ * ep_notify(), which puts the entry on its set's ready list, so
+ * epoll_wait() only looks at descriptors that have seen a wakeup instead
+ * of re-checking all of them.
+ *
+ * The lists are touched from interrupts (tty input), so everything is
+ * done with interrupts disabled.
+ */
+#define EP_HASH_SIZE 64
+#define ep_hashfn(addr) ((((unsigned long) (addr)) >> 2) % EP_HASH_SIZE)
+
+struct ep_hook {
+	struct ep_hook * next;
+	struct task_struct ** wait_address;
+	struct ep_entry * entry;
+};
+
+struct ep_entry {
+	struct epoll_set * set;
+	struct file * file;		/* NULL if the slot is free */
+	unsigned long events;
+	unsigned long data;
+	int ready;
+	struct ep_entry * next_ready;
+	struct ep_hook hook[2];		/* input, output */
+};
+
+struct epoll_set {
+	struct task_struct * wait;
+	struct ep_entry * ready_head, * ready_tail;
+	struct ep_entry entry[NR_OPEN];	/* indexed by fd */
+};
+
+static struct ep_hook * ep_hash[EP_HASH_SIZE];
+
+static void ep_hook(struct ep_hook * h, struct task_struct ** wait_address,
+	struct ep_entry * e)
+{
+	struct ep_hook ** head;
+
+	h->wait_address = wait_address;
+	h->entry = e;
+	if (!wait_address)
+		return;
+	head = ep_hash + ep_hashfn(wait_address);
+	h->next = *head;
+	*head = h;
+}
+
+static void ep_unhook(struct ep_hook * h)
+{
+	struct ep_hook ** hp;
+
+	if (!h->wait_address)
+		return;
+	for (hp = ep_hash + ep_hashfn(h->wait_address) ; *hp ; hp = &(*hp)->next)
+		if (*hp == h) {
+			*hp = h->next;
+			break;
+		}
+	h->wait_address = NULL;
+}
+
+static void ep_append(struct ep_entry * e)
+{
+	struct epoll_set * set = e->set;
+
+	if (e->ready)
+		return;
+	e->ready = 1;
+	e->next_ready = NULL;
+	if (set->ready_tail)
+		set->ready_tail->next_ready = e;
+	else
+		set->ready_head = e;
+	set->ready_tail = e;
+}
+
+static void ep_unlink(struct ep_entry * e)
+{
+	struct epoll_set * set = e->set;
+	struct ep_entry ** ep, * prev = NULL;
+
+	if (!e->ready)
+		return;
+	for (ep = &set->ready_head ; *ep ; prev = *ep, ep = &(*ep)->next_ready)
+		if (*ep == e) {
+			*ep = e->next_ready;
+			if (set->ready_tail == e)
+				set->ready_tail = prev;
+			break;
+		}
+	e->ready = 0;
+}
+
+void ep_notify(struct task_struct ** wait_address)
+{
+	struct ep_hook * h;
+	unsigned long flags;
+
+	if (!ep_hash[ep_hashfn(wait_address)])
+		return;
+	save_flags(flags);
+	cli();
+	for (h = ep_hash[ep_hashfn(wait_address)] ; h ; h = h->next)
+		if (h->wait_address == wait_address && !h->entry->ready) {
+			ep_append(h->entry);
+			wake_up(&h->entry->set->wait);
+		}
+	restore_flags(flags);
+}
+
+static void ep_remove(struct ep_entry * e)
+{
+	cli();
+	ep_unhook(e->hook);
+	ep_unhook(e->hook+1);
+	ep_unlink(e);
+	e->file = NULL;
+	sti();
+}
+
+/* called by sys_close() before the descriptor goes away */
+void ep_close(int fd)
+{
+	if (current->epoll && current->epoll->entry[fd].file)
+		ep_remove(current->epoll->entry + fd);
+}
+
+static unsigned long ep_poll(struct ep_entry * e)
+{
+	struct m_inode * inode = e->file->f_inode;
+	unsigned long revents = 0;
+
+	if ((e->events & EPOLLIN) && check_in(NULL,inode))
+		revents |= EPOLLIN;
+	if ((e->events & EPOLLOUT) && check_out(NULL,inode))
+		revents |= EPOLLOUT;
+	if (check_ex(NULL,inode))
+		revents |= EPOLLHUP;
+	return revents;
+}
+
+int sys_epoll_ctl(int op, int fd, struct epoll_event * event)
+{
+	struct epoll_set * set;
+	struct ep_entry * e;
+	struct file * file;
+	struct tty_struct * tty;
+	struct task_struct ** in, ** out;
+
+	if (fd < 0 || fd >= NR_OPEN || !(file = current->filp[fd]) ||
+	    !file->f_inode)
+		return -EBADF;
+	if (tty = get_tty(file->f_inode)) {
+		in = &tty->secondary->proc_list;
+		out = &tty->write_q->proc_list;
+	} else if (file->f_inode->i_pipe) {
+		in = &PIPE_READ_WAIT(*file->f_inode);
+		out = &PIPE_WRITE_WAIT(*file->f_inode);
+	} else
+		return -EPERM;
+	if (!(set = current->epoll)) {
+		if (op != EPOLL_CTL_ADD)
+			return -ENOENT;
+		if (!(set = (struct epoll_set *) get_free_page()))
+			return -ENOMEM;
+		current->epoll = set;
+	}
+	e = set->entry + fd;
+	switch (op) {
+		case EPOLL_CTL_ADD:
+			if (e->file)
+				return -EEXIST;
+			e->set = set;
+			e->file = file;
+			break;
+		case EPOLL_CTL_MOD:
+			if (!e->file)
+				return -ENOENT;
+			break;
+		case EPOLL_CTL_DEL:
+			if (!e->file)
+				return -ENOENT;
+			ep_remove(e);
+			return 0;
+		default:
+			return -EINVAL;
+	}
+	e->events = get_fs_long(&event->events);
+	e->data = get_fs_long(&event->data);
+	cli();
+	ep_unhook(e->hook);
+	ep_unhook(e->hook+1);
+	ep_hook(e->hook, (e->events & EPOLLIN) ? in : NULL, e);
+	ep_hook(e->hook+1, (e->events & EPOLLOUT) ? out : NULL, e);
+	ep_append(e);		/* it may well be ready already */
+	sti();
+	return 0;
+}
+
+/*
+ * Only entries on the ready list are checked. One that turns out not to
+ * be ready any more is dropped until the next wakeup, one that is ready
+ * goes back on the tail, as the condition may still hold next time.
+ * timeout is in milliseconds, negative means wait forever.
+ */
+int sys_epoll_wait(struct epoll_event * events, int maxevents, long timeout)
+{
+	struct epoll_set * set = current->epoll;
+	struct ep_entry * e;
+	unsigned long revents;
+	int n, count = 0;
+
+	if (!set || maxevents <= 0)
+		return -EINVAL;
+	verify_area(events, maxevents * sizeof(struct epoll_event));
+	if (timeout > 0)
+		current->timeout = jiffies + (timeout*HZ+999)/1000;
+	cli();
+	while (1) {
+		for (n = 0, e = set->ready_head ; e ; e = e->next_ready)
+			n++;
+		while (n-- > 0 && count < maxevents) {
+			e = set->ready_head;
+			ep_unlink(e);
+			if (!(revents = ep_poll(e)))
+				continue;
+			put_fs_long(revents, &events[count].events);
+			put_fs_long(e->data, &events[count].data);
+			count++;
+			ep_append(e);
+		}
+		if (count || !timeout || (current->signal & ~current->blocked))
+			break;
+		if (timeout > 0 && !current->timeout)
+			break;
+		interruptible_sleep_on(&set->wait);
+	}
+	sti();
+	current->timeout = 0;
+	if (!count && (current->signal & ~current->blocked))
+		return -EINTR;
+	return count;
+}
@@ -117,6 +117,7 @@ struct m_inode {
 	unsigned char i_mount;
 	unsigned char i_seek;
 	unsigned char i_update;
+	unsigned long i_wset;		/* exec working set, see mm/memory.c */
 };
 
 struct file {
@@ -198,6 +199,8 @@ extern struct buffer_head * bread(int dev,int block);
 extern void bread_page(unsigned long addr,int dev,int b[4]);
 extern struct buffer_head * breada(int dev,int block,...);
 extern int new_block(int dev);
+extern void ep_notify(struct task_struct ** wait_address);
+extern void ep_close(int fd);
 extern int free_block(int dev, int block);
 extern struct m_inode * new_inode(int dev);
 extern void free_inode(struct m_inode * inode);
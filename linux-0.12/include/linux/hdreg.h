@@ -40,6 +40,20 @@
 #define WIN_SEEK 		0x70
 #define WIN_DIAGNOSE		0x90
 #define WIN_SPECIFY		0x91
+#define WIN_READDMA		0xc8
+#define WIN_WRITEDMA		0xca
+
+/* PCI bus-master IDE regs, offsets from BAR4 (primary channel) */
+#define BM_COMMAND	0	/* start/stop and direction */
+#define BM_STATUS	2
+#define BM_PRDT		4	/* address of the PRD table */
+
+#define BM_START	0x01	/* in BM_COMMAND */
+#define BM_READ		0x08	/* in BM_COMMAND: memory is written */
+#define BM_ERR		0x02	/* in BM_STATUS */
+#define BM_INTR		0x04	/* in BM_STATUS */
+
+#define PRD_EOT		0x80000000	/* last entry of the PRD table */
 
 /* Bits for HD_ERROR */
 #define MARK_ERR	0x01	/* Bad address mark ? */
@@ -24,7 +24,7 @@ extern inline volatile void oom(void)
 }
 
 #define invalidate() \
-__asm__("movl %%eax,%%cr3"::"a" (0))
+__asm__("movl %%cr3,%%eax\n\tmovl %%eax,%%cr3":::"ax")
 
 /* these are not to be changed without changing head.s etc */
 #define LOW_MEM 0x100000
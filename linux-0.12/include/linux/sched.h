@@ -3,8 +3,16 @@
 
 #define HZ 100
 
-#define NR_TASKS	64
-#define TASK_SIZE	0x04000000
+/*
+ * Every task has its own page directory, so they all see the same
+ * linear layout: the kernel's identity mapping below USER_BASE and
+ * TASK_SIZE bytes of user space above it. NR_TASKS is only the upper
+ * bound set by the size of the gdt (a TSS and an LDT per task), the
+ * number of usable slots (nr_tasks) is decided at boot.
+ */
+#define NR_TASKS	512
+#define USER_BASE	0x40000000
+#define TASK_SIZE	0xC0000000
 #define LIBRARY_SIZE	0x00400000
 
 #if (TASK_SIZE & 0x3fffff)
@@ -19,8 +27,16 @@
 #error "LIBRARY_SIZE too damn big!"
 #endif
 
-#if (((TASK_SIZE>>16)*NR_TASKS) != 0x10000)
-#error "TASK_SIZE*NR_TASKS must be 4GB"
+#if (USER_BASE & 0x3fffff) || (USER_BASE < 0x01000000)
+#error "USER_BASE must be a multiple of 4M above the 16Mb kernel mapping"
+#endif
+
+#if ((USER_BASE + TASK_SIZE) > 0x100000000)
+#error "USER_BASE+TASK_SIZE must fit in 4GB"
+#endif
+
+#if ((4+2*NR_TASKS) > 1028)
+#error "NR_TASKS too big for the gdt in head.s"
 #endif
 
 #define LIBRARY_OFFSET (TASK_SIZE - LIBRARY_SIZE)
@@ -29,7 +45,7 @@
 #define CT_TO_USECS(x)	(((x) % HZ) * 1000000/HZ)
 
 #define FIRST_TASK task[0]
-#define LAST_TASK task[NR_TASKS-1]
+#define LAST_TASK task[nr_tasks-1]
 
 #include <linux/head.h>
 #include <linux/fs.h>
@@ -53,8 +69,10 @@
 #define NULL ((void *) 0)
 #endif
 
-extern int copy_page_tables(unsigned long from, unsigned long to, long size);
-extern int free_page_tables(unsigned long from, unsigned long size);
+extern int copy_page_tables(unsigned long * to_dir, unsigned long from,
+	unsigned long to, long size);
+extern int free_page_tables(unsigned long * dir, unsigned long from,
+	unsigned long size);
 
 extern void sched_init(void);
 extern void schedule(void);
@@ -121,6 +139,7 @@ struct task_struct {
 	 * p->p_pptr->pid)
 	 */
 	struct task_struct	*p_pptr, *p_cptr, *p_ysptr, *p_osptr;
+	struct task_struct	*vfork_wait;	/* parent waits for vfork child */
 	unsigned short uid,euid,suid;
 	unsigned short gid,egid,sgid;
 	unsigned long timeout,alarm;
@@ -128,6 +147,10 @@ struct task_struct {
 	struct rlimit rlim[RLIM_NLIMITS]; 
 	unsigned int flags;	/* per process flags, defined below */
 	unsigned short used_math;
+/* run queue links, see kernel/sched.c */
+	struct task_struct *run_next, *run_prev;
+	struct prio_array *array;	/* NULL if not on a run queue */
+	unsigned long rq_epoch;		/* last counter recharge seen */
 /* file system info */
 	int tty;		/* -1 if no tty, so it must be signed */
 	unsigned short umask;
@@ -137,6 +160,7 @@ struct task_struct {
 	struct m_inode * library;
 	unsigned long close_on_exec;
 	struct file * filp[NR_OPEN];
+	struct epoll_set * epoll;	/* see fs/select.c */
 /* ldt for this task 0 - zero 1 - cs 2 - ds&ss */
 	struct desc_struct ldt[3];
 /* tss for this task */
@@ -148,6 +172,7 @@ struct task_struct {
  */
 #define PF_ALIGNWARN	0x00000001	/* Print alignment warning msgs */
 					/* Not implemented yet, only for 486*/
+#define PF_VFORK	0x00000002	/* Borrowing the parent's memory */
 
 /*
  *  INIT_TASK is used to set up the first task table, touch at
@@ -159,7 +184,7 @@ struct task_struct {
 /* ec,brk... */	0,0,0,0,0,0, \
 /* pid etc.. */	0,0,0,0, \
 /* suppl grps*/ {NOGROUP,}, \
-/* proc links*/ &init_task.task,0,0,0, \
+/* proc links*/ &init_task.task,0,0,0,0, \
 /* uid etc */	0,0,0,0,0,0, \
 /* timeout */	0,0,0,0,0,0,0, \
 /* rlimits */   { {0x7fffffff, 0x7fffffff}, {0x7fffffff, 0x7fffffff},  \
@@ -167,8 +192,10 @@ struct task_struct {
 		  {0x7fffffff, 0x7fffffff}, {0x7fffffff, 0x7fffffff}}, \
 /* flags */	0, \
 /* math */	0, \
+/* runqueue */	NULL,NULL,NULL,0, \
 /* fs info */	-1,0022,NULL,NULL,NULL,NULL,0, \
 /* filp */	{NULL,}, \
+/* epoll */	NULL, \
 	{ \
 		{0,0}, \
 /* ldt */	{0x9f,0xc0fa00}, \
@@ -183,6 +210,7 @@ struct task_struct {
 }
 
 extern struct task_struct *task[NR_TASKS];
+extern int nr_tasks;
 extern struct task_struct *last_task_used_math;
 extern struct task_struct *current;
 extern unsigned long volatile jiffies;
@@ -195,7 +223,10 @@ extern void add_timer(long jiffies, void (*fn)(void));
 extern void sleep_on(struct task_struct ** p);
 extern void interruptible_sleep_on(struct task_struct ** p);
 extern void wake_up(struct task_struct ** p);
+extern void wake_up_process(struct task_struct * p);
+extern void signal_wake_up(struct task_struct * p);
 extern int in_group_p(gid_t grp);
+extern void vfork_release(unsigned long * dir);
 
 /*
  * Entry into gdt where to find first TSS. 0-nul, 1-cs, 2-ds, 3-syscall
@@ -205,6 +236,8 @@ extern int in_group_p(gid_t grp);
 #define FIRST_LDT_ENTRY (FIRST_TSS_ENTRY+1)
 #define _TSS(n) ((((unsigned long) n)<<4)+(FIRST_TSS_ENTRY<<3))
 #define _LDT(n) ((((unsigned long) n)<<4)+(FIRST_LDT_ENTRY<<3))
+#define PG_DIR(p) ((unsigned long *) (p)->tss.cr3)
+#define TASK_NR(p) (((p)->tss.ldt-(FIRST_LDT_ENTRY<<3))>>4)
 #define ltr(n) __asm__("ltr %%ax"::"a" (_TSS(n)))
 #define lldt(n) __asm__("lldt %%ax"::"a" (_LDT(n)))
 #define str(n) \
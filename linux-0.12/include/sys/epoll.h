@@ -0,0 +1,26 @@
+#ifndef _SYS_EPOLL_H
+#define _SYS_EPOLL_H
+
+/*
+ * Each process has one interest set. Descriptors are added to it with
+ * epoll_ctl() and stay there until removed or closed; epoll_wait()
+ * returns the ones that are ready (level triggered).
+ */
+
+#define EPOLLIN		0x001
+#define EPOLLOUT	0x004
+#define EPOLLHUP	0x010
+
+#define EPOLL_CTL_ADD	1
+#define EPOLL_CTL_DEL	2
+#define EPOLL_CTL_MOD	3
+
+struct epoll_event {
+	unsigned long events;
+	unsigned long data;
+};
+
+int epoll_ctl(int op, int fd, struct epoll_event * event);
+int epoll_wait(struct epoll_event * events, int maxevents, long timeout);
+
+#endif /* _SYS_EPOLL_H */
@@ -146,6 +146,9 @@
 #define __NR_lstat	84
 #define __NR_readlink	85
 #define __NR_uselib	86
+#define __NR_epoll_ctl	87
+#define __NR_epoll_wait	88
+#define __NR_vfork	89
 
 #define _syscall0(type,name) \
 type name(void) \
@@ -225,6 +228,7 @@ volatile void exit(int status);
 volatile void _exit(int status);
 int fcntl(int fildes, int cmd, ...);
 int fork(void);
+int vfork(void);
 int getpid(void);
 int getuid(void);
 int geteuid(void);
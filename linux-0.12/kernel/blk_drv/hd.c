@@ -36,6 +36,7 @@ inb_p(0x71); \
 
 static void recal_intr(void);
 static void bad_rw_intr(void);
+static void dma_intr(void);
 
 static int recalibrate = 0;
 static int reset = 0;
@@ -61,6 +62,16 @@ static struct hd_struct {
 
 static int hd_sizes[5*MAX_HD] = {0, };
 
+/*
+ * PCI bus-master IDE. bm_base is 0 if there is none (or after it has
+ * failed once), and the data then goes through the data port (PIO).
+ * Define HD_NO_DMA to always use PIO, e.g. to compare the two.
+ * A request is at most a page, which never crosses a 64kB boundary,
+ * so one PRD entry (address, byte count | EOT) is enough.
+ */
+static unsigned short bm_base = 0;
+static unsigned long prd_table[2] __attribute__ ((aligned (8)));
+
 #define port_read(port,buf,nr) \
 __asm__("cld;rep;insw"::"d" (port),"D" (buf),"c" (nr):"cx","di")
 
@@ -315,10 +326,53 @@ static void recal_intr(void)
 	do_hd_request();
 }
 
+static int dma_stop(void)
+{
+	int status;
+
+	outb(inb(bm_base+BM_COMMAND) & ~BM_START,bm_base+BM_COMMAND);
+	status = inb(bm_base+BM_STATUS);
+	outb(status | BM_INTR | BM_ERR,bm_base+BM_STATUS);
+	return status;
+}
+
+static void dma_intr(void)
+{
+	if ((dma_stop() & BM_ERR) | win_result()) {
+		printk("HD: DMA failed, using PIO\n\r");
+		bm_base = 0;
+		bad_rw_intr();
+		do_hd_request();
+		return;
+	}
+	end_request(1);
+	do_hd_request();
+}
+
+/*
+ * Set up the bus master for the current request; the drive is then given
+ * the DMA command, and the bus master is started.
+ */
+static int dma_setup(void)
+{
+	int dir = (CURRENT->cmd == READ) ? BM_READ : 0;
+
+	if (!bm_base || ((long) CURRENT->buffer & 1))
+		return 0;
+	prd_table[0] = (unsigned long) CURRENT->buffer;
+	prd_table[1] = (CURRENT->nr_sectors << 9) | PRD_EOT;
+	outb(dir,bm_base+BM_COMMAND);
+	outl((unsigned long) prd_table,bm_base+BM_PRDT);
+	outb(inb(bm_base+BM_STATUS) | BM_INTR | BM_ERR,bm_base+BM_STATUS);
+	return 1;
+}
+
 void hd_times_out(void)
 {
 	if (!CURRENT)
 		return;
+	if (bm_base)
+		dma_stop();
 	printk("HD timeout");
 	if (++CURRENT->errors >= MAX_ERRORS)
 		end_request(0);
@@ -360,7 +414,12 @@ void do_hd_request(void)
 			WIN_RESTORE,&recal_intr);
 		return;
 	}	
-	if (CURRENT->cmd == WRITE) {
+	if ((CURRENT->cmd == READ || CURRENT->cmd == WRITE) && dma_setup()) {
+		hd_out(dev,nsect,sec,head,cyl,
+			(CURRENT->cmd == READ) ? WIN_READDMA : WIN_WRITEDMA,
+			&dma_intr);
+		outb(inb(bm_base+BM_COMMAND) | BM_START,bm_base+BM_COMMAND);
+	} else if (CURRENT->cmd == WRITE) {
 		hd_out(dev,nsect,sec,head,cyl,WIN_WRITE,&write_intr);
 		for(i=0 ; i<10000 && !(r=inb_p(HD_STATUS)&DRQ_STAT) ; i++)
 			/* nothing */ ;
@@ -375,8 +434,48 @@ void do_hd_request(void)
 		panic("unknown hd-command");
 }
 
+#define PCI_CONF(bus,dev,fn,reg) \
+	(0x80000000 | ((bus)<<16) | ((dev)<<11) | ((fn)<<8) | (reg))
+
+static unsigned long pci_read(int dev, int fn, int reg)
+{
+	outl(PCI_CONF(0,dev,fn,reg),0xcf8);
+	return inl(0xcfc);
+}
+
+/*
+ * Look on PCI bus 0 for an IDE controller that can be a bus master
+ * (class 1, subclass 1, bit 7 of prog-if), like the PIIX of qemu/bochs.
+ */
+static void bm_probe(void)
+{
+	int dev,fn;
+	unsigned long class,bar4;
+
+	for (dev = 0 ; dev < 32 ; dev++)
+		for (fn = 0 ; fn < 8 ; fn++) {
+			if ((pci_read(dev,fn,0) & 0xffff) == 0xffff)
+				continue;
+			class = pci_read(dev,fn,8);
+			if ((class >> 16) != 0x0101 || !(class & 0x8000))
+				continue;
+			bar4 = pci_read(dev,fn,0x20);
+			if (!(bar4 & 1))
+				continue;
+			/* I/O space and bus master enable */
+			outl(PCI_CONF(0,dev,fn,4),0xcf8);
+			outl((inl(0xcfc) & 0xffff) | 5,0xcfc);
+			bm_base = bar4 & 0xfffc;
+			printk("HD: bus master IDE at port %x\n\r",bm_base);
+			return;
+		}
+}
+
 void hd_init(void)
 {
+#ifndef HD_NO_DMA
+	bm_probe();
+#endif
 	blk_dev[MAJOR_NR].request_fn = DEVICE_REQUEST;
 	set_intr_gate(0x2E,&hd_interrupt);
 	outb_p(inb_p(0x21)&0xfb,0x21);
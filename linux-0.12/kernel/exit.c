@@ -17,6 +17,7 @@
 
 int sys_pause(void);
 int sys_close(int fd);
+void save_wset(void);
 
 void release(struct task_struct * p)
 {
@@ -28,7 +29,7 @@ void release(struct task_struct * p)
 		printk("task releasing itself\n\r");
 		return;
 	}
-	for (i=1 ; i<NR_TASKS ; i++)
+	for (i=1 ; i<nr_tasks ; i++)
 		if (task[i]==p) {
 			task[i]=NULL;
 			/* Update links */
@@ -38,6 +39,7 @@ void release(struct task_struct * p)
 				p->p_ysptr->p_osptr = p->p_osptr;
 			else
 				p->p_pptr->p_cptr = p->p_osptr;
+			free_page(p->tss.cr3);
 			free_page((long)p);
 			schedule();
 			return;
@@ -56,7 +58,7 @@ int bad_task_ptr(struct task_struct *p)
 
 	if (!p)
 		return 0;
-	for (i=0 ; i<NR_TASKS ; i++)
+	for (i=0 ; i<nr_tasks ; i++)
 		if (task[i] == p)
 			return 0;
 	return 1;
@@ -75,7 +77,7 @@ void audit_ptree()
 {
 	int	i;
 
-	for (i=1 ; i<NR_TASKS ; i++) {
+	for (i=1 ; i<nr_tasks ; i++) {
 		if (!task[i])
 			continue;
 		if (bad_task_ptr(task[i]->p_pptr))
@@ -142,7 +144,7 @@ static inline int send_sig(long sig,struct task_struct * p,int priv)
 		return -EPERM;
 	if ((sig == SIGKILL) || (sig == SIGCONT)) {
 		if (p->state == TASK_STOPPED)
-			p->state = TASK_RUNNING;
+			wake_up_process(p);
 		p->exit_code = 0;
 		p->signal &= ~( (1<<(SIGSTOP-1)) | (1<<(SIGTSTP-1)) |
 				(1<<(SIGTTIN-1)) | (1<<(SIGTTOU-1)) );
@@ -155,6 +157,7 @@ static inline int send_sig(long sig,struct task_struct * p,int priv)
 		p->signal &= ~(1<<(SIGCONT-1));
 	/* Actually deliver the signal */
 	p->signal |= (1<<(sig-1));
+	signal_wake_up(p);
 	return 0;
 }
 
@@ -204,7 +207,7 @@ int kill_proc(int pid, int sig, int priv)
  */
 int sys_kill(int pid,int sig)
 {
-	struct task_struct **p = NR_TASKS + task;
+	struct task_struct **p = nr_tasks + task;
 	int err, retval = 0;
 
 	if (!pid)
@@ -264,11 +267,22 @@ volatile void do_exit(long code)
 	struct task_struct *p;
 	int i;
 
-	free_page_tables(get_base(current->ldt[1]),get_limit(0x0f));
-	free_page_tables(get_base(current->ldt[2]),get_limit(0x17));
+	save_wset();
+	if (current->flags & PF_VFORK)
+		vfork_release(pg_dir);	/* the memory is the parent's */
+	else {
+		free_page_tables(PG_DIR(current),get_base(current->ldt[1]),
+			get_limit(0x0f));
+		free_page_tables(PG_DIR(current),get_base(current->ldt[2]),
+			get_limit(0x17));
+	}
 	for (i=0 ; i<NR_OPEN ; i++)
 		if (current->filp[i])
 			sys_close(i);
+	if (current->epoll) {
+		free_page((long) current->epoll);
+		current->epoll = NULL;
+	}
 	iput(current->pwd);
 	current->pwd = NULL;
 	iput(current->root);
@@ -297,6 +311,7 @@ volatile void do_exit(long code)
 	}
 	/* Let father know we died */
 	current->p_pptr->signal |= (1<<(SIGCHLD-1));
+	signal_wake_up(current->p_pptr);
 	
 	/*
 	 * This loop does two things:
@@ -309,8 +324,10 @@ volatile void do_exit(long code)
 	if (p = current->p_cptr) {
 		while (1) {
 			p->p_pptr = task[1];
-			if (p->state == TASK_ZOMBIE)
+			if (p->state == TASK_ZOMBIE) {
 				task[1]->signal |= (1<<(SIGCHLD-1));
+				signal_wake_up(task[1]);
+			}
 			/*
 			 * process group orphan check
 			 * Case ii: Our child is in a different pgrp 
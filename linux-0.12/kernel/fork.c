@@ -36,10 +36,17 @@ void verify_area(void * addr,int size)
 	}
 }
 
+/*
+ * The child gets a page directory of its own. It shares the kernel's
+ * page tables below USER_BASE and gets a copy-on-write copy of the
+ * parent's user space at the same linear addresses.
+ */
 int copy_mem(int nr,struct task_struct * p)
 {
 	unsigned long old_data_base,new_data_base,data_limit;
 	unsigned long old_code_base,new_code_base,code_limit;
+	unsigned long * dir;
+	int i;
 
 	code_limit=get_limit(0x0f);
 	data_limit=get_limit(0x17);
@@ -49,23 +56,45 @@ int copy_mem(int nr,struct task_struct * p)
 		panic("We don't support separate I&D");
 	if (data_limit < code_limit)
 		panic("Bad data_limit");
-	new_data_base = new_code_base = nr * TASK_SIZE;
+	new_data_base = new_code_base = USER_BASE;
 	p->start_code = new_code_base;
 	set_base(p->ldt[1],new_code_base);
 	set_base(p->ldt[2],new_data_base);
-	if (copy_page_tables(old_data_base,new_data_base,data_limit)) {
-		free_page_tables(new_data_base,data_limit);
+	if (!(dir = (unsigned long *) get_free_page()))
+		return -ENOMEM;
+	for (i=0 ; i<(USER_BASE>>22) ; i++)
+		dir[i] = pg_dir[i];
+	p->tss.cr3 = (long) dir;
+	if (copy_page_tables(dir,old_data_base,new_data_base,data_limit)) {
+		free_page_tables(dir,new_data_base,data_limit);
+		free_page((long) dir);
 		return -ENOMEM;
 	}
 	return 0;
 }
 
+/*
+ * A vfork()ed child runs in its parent's address space until it exec's
+ * or exits. Then it moves to the page directory 'dir' and lets the
+ * parent go on.
+ */
+void vfork_release(unsigned long * dir)
+{
+	current->tss.cr3 = (long) dir;
+	__asm__("movl %0,%%cr3"::"r" (dir));
+	current->flags &= ~PF_VFORK;
+	wake_up(&current->p_pptr->vfork_wait);
+}
+
 /*
  *  Ok, this is the main fork-routine. It copies the system process
  * information (task[nr]) and sets up the necessary registers. It
- * also copies the data segment in it's entirety.
+ * also copies the data segment in it's entirety - lazily, see
+ * copy_page_tables(). For vfork() nothing is copied at all: the child
+ * borrows the parent's page directory and the parent sleeps until the
+ * child gives it back.
  */
-int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
+int copy_process(int vfork,int nr,long ebp,long edi,long esi,long gs,long none,
 		long ebx,long ecx,long edx, long orig_eax, 
 		long fs,long es,long ds,
 		long eip,long cs,long eflags,long esp,long ss)
@@ -80,6 +109,10 @@ int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
 	task[nr] = p;
 	*p = *current;	/* NOTE! this doesn't copy the supervisor stack */
 	p->state = TASK_UNINTERRUPTIBLE;
+	p->array = NULL;	/* not on the parent's run queue */
+	p->epoll = NULL;
+	p->vfork_wait = NULL;
+	p->flags &= ~PF_VFORK;
 	p->pid = last_pid;
 	p->counter = p->priority;
 	p->signal = 0;
@@ -111,7 +144,9 @@ int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
 	p->tss.trace_bitmap = 0x80000000;
 	if (last_task_used_math == current)
 		__asm__("clts ; fnsave %0 ; frstor %0"::"m" (p->tss.i387));
-	if (copy_mem(nr,p)) {
+	if (vfork)
+		p->flags |= PF_VFORK;
+	else if (copy_mem(nr,p)) {
 		task[nr] = NULL;
 		free_page((long) p);
 		return -EAGAIN;
@@ -136,7 +171,15 @@ int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
 	if (p->p_osptr)
 		p->p_osptr->p_ysptr = p;
 	current->p_cptr = p;
-	p->state = TASK_RUNNING;	/* do this last, just in case */
+	wake_up_process(p);	/* do this last, just in case */
+	if (vfork) {
+		nr = p->pid;
+		cli();
+		while (p->flags & PF_VFORK)
+			sleep_on(&current->vfork_wait);
+		sti();
+		return nr;
+	}
 	return last_pid;
 }
 
@@ -146,11 +189,11 @@ int find_empty_process(void)
 
 	repeat:
 		if ((++last_pid)<0) last_pid=1;
-		for(i=0 ; i<NR_TASKS ; i++)
+		for(i=0 ; i<nr_tasks ; i++)
 			if (task[i] && ((task[i]->pid == last_pid) ||
 				        (task[i]->pgrp == last_pid)))
 				goto repeat;
-	for(i=1 ; i<NR_TASKS ; i++)
+	for(i=1 ; i<nr_tasks ; i++)
 		if (!task[i])
 			return i;
 	return -EAGAIN;
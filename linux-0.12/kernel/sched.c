@@ -47,7 +47,7 @@ void show_state(void)
 	int i;
 
 	printk("\rTask-info:\n\r");
-	for (i=0;i<NR_TASKS;i++)
+	for (i=0;i<nr_tasks;i++)
 		if (task[i])
 			show_task(i,task[i]);
 }
@@ -78,6 +78,7 @@ struct task_struct *current = &(init_task.task);
 struct task_struct *last_task_used_math = NULL;
 
 struct task_struct * task[NR_TASKS] = {&(init_task.task), };
+int nr_tasks = 1;
 
 long user_stack [ PAGE_SIZE>>2 ] ;
 
@@ -107,58 +108,213 @@ void math_state_restore()
 }
 
 /*
- *  'schedule()' is the scheduler function. This is GOOD CODE! There
- * probably won't be any reason to change this, as it should work well
- * in all circumstances (ie gives IO-bound processes good response etc).
- * The one thing you might take a look at is the signal-handler code here.
+ * The run queues. Only runnable tasks are kept here, in one list per
+ * priority, so picking the next task doesn't depend on how many tasks
+ * are sleeping. A task whose counter runs out is recharged and moved to
+ * the expired array; when the active array runs dry the two are swapped,
+ * which is the old "recalculate every counter" step. Sleeping tasks get
+ * the recharges they missed (sched_epoch) when they are woken up.
  *
- *   NOTE!!  Task 0 is the 'idle' task, which gets called when no other
- * tasks can run. It can not be killed, and it cannot sleep. The 'state'
- * information in task[0] is never used.
+ * The running task stays on its queue. schedule() takes it off when it
+ * has gone to sleep, wake_up_process() puts tasks back. Task 0 is never
+ * queued: it is what runs when both arrays are empty.
  */
-void schedule(void)
+#define NR_PRIO		32
+
+struct prio_array {
+	unsigned long bitmap;
+	struct task_struct * queue[NR_PRIO];
+};
+
+static struct prio_array prio_arrays[2];
+static struct prio_array * active = prio_arrays;
+static struct prio_array * expired = prio_arrays + 1;
+static unsigned long sched_epoch = 0;
+
+/* earliest timeout or alarm that might be armed */
+static unsigned long next_deadline = 0xffffffff;
+
+#define task_prio(p) ((p)->priority < NR_PRIO ? (p)->priority : NR_PRIO-1)
+
+static void enqueue_task(struct task_struct * p, struct prio_array * array,
+	int head)
 {
-	int i,next,c;
-	struct task_struct ** p;
+	int prio = task_prio(p);
+	struct task_struct ** q = array->queue + prio;
+
+	if (!*q) {
+		p->run_next = p->run_prev = p;
+		*q = p;
+		array->bitmap |= 1 << prio;
+	} else {
+		p->run_next = *q;
+		p->run_prev = (*q)->run_prev;
+		(*q)->run_prev->run_next = p;
+		(*q)->run_prev = p;
+		if (head)
+			*q = p;
+	}
+	p->array = array;
+}
+
+static void dequeue_task(struct task_struct * p)
+{
+	struct prio_array * array = p->array;
+	int prio = task_prio(p);
+
+	if (p->run_next == p) {
+		array->queue[prio] = NULL;
+		array->bitmap &= ~(1 << prio);
+	} else {
+		p->run_prev->run_next = p->run_next;
+		p->run_next->run_prev = p->run_prev;
+		if (array->queue[prio] == p)
+			array->queue[prio] = p->run_next;
+	}
+	p->array = NULL;
+}
+
+static inline void expire_task(struct task_struct * p)
+{
+	p->counter = (p->counter >> 1) + p->priority;
+	p->rq_epoch = sched_epoch + 1;
+	enqueue_task(p, expired, 0);
+}
+
+/*
+ * Put a woken task on the run queue. It first gets the counter recharges
+ * that happened while it slept, so sleepers still end up with a bigger
+ * counter (up to 2*priority) and go to the head of their queue.
+ */
+static void activate_task(struct task_struct * p)
+{
+	long c;
+
+	while ((long) (sched_epoch - p->rq_epoch) > 0) {
+		p->rq_epoch++;
+		c = (p->counter >> 1) + p->priority;
+		if (c == p->counter) {
+			p->rq_epoch = sched_epoch;
+			break;
+		}
+		p->counter = c;
+	}
+	if (p->counter)
+		enqueue_task(p, active, 1);
+	else
+		expire_task(p);
+}
+
+void wake_up_process(struct task_struct * p)
+{
+	unsigned long flags;
 
-/* check alarm, wake up any interruptible tasks that have got a signal */
+	save_flags(flags);
+	cli();
+	p->state = TASK_RUNNING;
+	if (!p->array && p != &(init_task.task))
+		activate_task(p);
+	restore_flags(flags);
+}
 
+/*
+ * Called after posting a signal to p: an interruptible sleeper with an
+ * unblocked signal pending has to run to see it.
+ */
+void signal_wake_up(struct task_struct * p)
+{
+	if (p->state == TASK_INTERRUPTIBLE &&
+	    (p->signal & ~(_BLOCKABLE & p->blocked)))
+		wake_up_process(p);
+}
+
+/*
+ * Expire timeouts and alarms. Only called once jiffies has passed
+ * next_deadline, so the task table isn't walked on every schedule().
+ */
+static void check_deadlines(void)
+{
+	struct task_struct ** p;
+
+	next_deadline = 0xffffffff;
 	for(p = &LAST_TASK ; p > &FIRST_TASK ; --p)
 		if (*p) {
 			if ((*p)->timeout && (*p)->timeout < jiffies) {
 				(*p)->timeout = 0;
 				if ((*p)->state == TASK_INTERRUPTIBLE)
-					(*p)->state = TASK_RUNNING;
+					wake_up_process(*p);
 			}
 			if ((*p)->alarm && (*p)->alarm < jiffies) {
 				(*p)->signal |= (1<<(SIGALRM-1));
 				(*p)->alarm = 0;
+				signal_wake_up(*p);
 			}
-			if (((*p)->signal & ~(_BLOCKABLE & (*p)->blocked)) &&
-			(*p)->state==TASK_INTERRUPTIBLE)
-				(*p)->state=TASK_RUNNING;
+			if ((*p)->timeout && (*p)->timeout < next_deadline)
+				next_deadline = (*p)->timeout;
+			if ((*p)->alarm && (*p)->alarm < next_deadline)
+				next_deadline = (*p)->alarm;
 		}
+}
 
-/* this is the scheduler proper: */
+/*
+ *  'schedule()' is the scheduler function. It picks the first task of the
+ * highest non-empty priority queue. Tasks run until their counter is used
+ * up, then wait on the expired array until every runnable task has had
+ * its turn, so IO-bound processes (which get their counters recharged
+ * while asleep) still get good response.
+ *
+ *   NOTE!!  Task 0 is the 'idle' task, which gets called when no other
+ * tasks can run. It can not be killed, and it cannot sleep. The 'state'
+ * information in task[0] is never used.
+ */
+void schedule(void)
+{
+	struct task_struct * prev = current, * next;
+	struct prio_array * array;
+	unsigned long flags;
+	int prio;
 
-	while (1) {
-		c = -1;
-		next = 0;
-		i = NR_TASKS;
-		p = &task[NR_TASKS];
-		while (--i) {
-			if (!*--p)
-				continue;
-			if ((*p)->state == TASK_RUNNING && (*p)->counter > c)
-				c = (*p)->counter, next = i;
+	save_flags(flags);
+	cli();
+
+/* timeouts and alarms are only ever armed by the running task */
+
+	if (prev->timeout && prev->timeout < next_deadline)
+		next_deadline = prev->timeout;
+	if (prev->alarm && prev->alarm < next_deadline)
+		next_deadline = prev->alarm;
+	if (next_deadline < jiffies)
+		check_deadlines();
+
+/* don't go to sleep with a signal pending */
+
+	if ((prev->signal & ~(_BLOCKABLE & prev->blocked)) &&
+	    prev->state == TASK_INTERRUPTIBLE)
+		prev->state = TASK_RUNNING;
+	if (prev->array) {
+		if (prev->state != TASK_RUNNING)
+			dequeue_task(prev);
+		else if (!prev->counter) {
+			dequeue_task(prev);
+			expire_task(prev);
 		}
-		if (c) break;
-		for(p = &LAST_TASK ; p > &FIRST_TASK ; --p)
-			if (*p)
-				(*p)->counter = ((*p)->counter >> 1) +
-						(*p)->priority;
 	}
-	switch_to(next);
+
+/* this is the scheduler proper: */
+
+	if (!active->bitmap && expired->bitmap) {
+		array = active;
+		active = expired;
+		expired = array;
+		sched_epoch++;
+	}
+	if (active->bitmap) {
+		__asm__("bsrl %1,%0":"=r" (prio):"rm" (active->bitmap));
+		next = active->queue[prio];
+	} else
+		next = &(init_task.task);
+	switch_to(TASK_NR(next));
+	restore_flags(flags);
 }
 
 int sys_pause(void)
@@ -181,14 +337,14 @@ static inline void __sleep_on(struct task_struct **p, int state)
 	current->state = state;
 repeat:	schedule();
 	if (*p && *p != current) {
-		(**p).state = 0;
+		wake_up_process(*p);
 		current->state = TASK_UNINTERRUPTIBLE;
 		goto repeat;
 	}
 	if (!*p)
 		printk("Warning: *P = NULL\n\r");
 	if (*p = tmp)
-		tmp->state=0;
+		wake_up_process(tmp);
 }
 
 void interruptible_sleep_on(struct task_struct **p)
@@ -203,12 +359,14 @@ void sleep_on(struct task_struct **p)
 
 void wake_up(struct task_struct **p)
 {
+	if (p)
+		ep_notify(p);
 	if (p && *p) {
 		if ((**p).state == TASK_STOPPED)
 			printk("wake_up: TASK_STOPPED");
 		if ((**p).state == TASK_ZOMBIE)
 			printk("wake_up: TASK_ZOMBIE");
-		(**p).state=0;
+		wake_up_process(*p);
 	}
 }
 
@@ -409,14 +567,33 @@ int sys_getegid(void)
 
 int sys_nice(long increment)
 {
-	if (current->priority-increment>0)
-		current->priority -= increment;
+	struct prio_array * array;
+	unsigned long flags;
+
+	if (current->priority-increment>0) {
+		save_flags(flags);
+		cli();
+		if (array = current->array) {
+			dequeue_task(current);
+			current->priority -= increment;
+			enqueue_task(current,array,1);
+		} else
+			current->priority -= increment;
+		restore_flags(flags);
+	}
 	return 0;
 }
 
+/*
+ * A task needs at least its task_struct, a page directory and a page
+ * table or two, so there is no point in having more slots than this
+ * allows for.
+ */
+#define TASK_MIN_PAGES 4
+
 void sched_init(void)
 {
-	int i;
+	int i,free;
 	struct desc_struct * p;
 
 	if (sizeof(struct sigaction) != 16)
@@ -431,6 +608,14 @@ void sched_init(void)
 		p->a=p->b=0;
 		p++;
 	}
+	for (i=free=0 ; i<PAGING_PAGES ; i++)
+		if (!mem_map[i])
+			free++;
+	nr_tasks = free / TASK_MIN_PAGES;
+	if (nr_tasks > NR_TASKS)
+		nr_tasks = NR_TASKS;
+	if (nr_tasks < 2)
+		panic("Not enough memory for any tasks");
 /* Clear NT, so that we won't have troubles with that later on */
 	__asm__("pushfl ; andl $0xffffbfff,(%esp) ; popfl");
 	ltr(0);
@@ -252,7 +252,7 @@ int sys_setpgid(int pid, int pgid)
 		pgid = current->pid;
 	if (pgid < 0)
 		return -EINVAL;
-	for (i=0 ; i<NR_TASKS ; i++)
+	for (i=0 ; i<nr_tasks ; i++)
 		if (task[i] && (task[i]->pid == pid) &&
 		    ((task[i]->p_pptr == current) || 
 		     (task[i] == current))) {
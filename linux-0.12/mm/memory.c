@@ -46,6 +46,16 @@ __asm__("cld ; rep ; movsl"::"S" (from),"D" (to),"c" (1024):"cx","di","si")
 
 unsigned char mem_map [ PAGING_PAGES ] = {0,};
 
+/*
+ * Every task has its own page directory (tss.cr3). The kernel runs in
+ * all of them through the identity mapped page tables below USER_BASE,
+ * and physical memory is identity mapped, so the directories can be
+ * used directly as pointers.
+ */
+#define dir_entry(dir,addr) ((dir) + (((addr)>>22) & 0x3ff))
+#define table_entry(table,addr) \
+((unsigned long *) (0xfffff000 & (table)) + (((addr)>>12) & 0x3ff))
+
 /*
  * Free a page of memory at physical address 'addr'. Used by
  * 'free_page_tables()'
@@ -62,36 +72,52 @@ void free_page(unsigned long addr)
 	panic("trying to free free page");
 }
 
+/*
+ * Free a page table and all the pages it maps.
+ */
+static void free_page_table(unsigned long table)
+{
+	unsigned long * pg_table = (unsigned long *) table;
+	unsigned long nr;
+
+	for (nr=0 ; nr<1024 ; nr++) {
+		if (*pg_table) {
+			if (1 & *pg_table)
+				free_page(0xfffff000 & *pg_table);
+			else
+				swap_free(*pg_table >> 1);
+			*pg_table = 0;
+		}
+		pg_table++;
+	}
+	free_page(table);
+}
+
 /*
  * This function frees a continuos block of page tables, as needed
  * by 'exit()'. As does copy_page_tables(), this handles only 4Mb blocks.
+ * 'dir' is the page directory of the task the block belongs to. Page
+ * tables still shared after a fork() just lose a reference.
  */
-int free_page_tables(unsigned long from,unsigned long size)
+int free_page_tables(unsigned long * dir,unsigned long from,
+	unsigned long size)
 {
-	unsigned long *pg_table;
-	unsigned long * dir, nr;
+	unsigned long pg_table;
 
 	if (from & 0x3fffff)
 		panic("free_page_tables called with wrong alignment");
-	if (!from)
+	if (from < USER_BASE)
 		panic("Trying to free up swapper memory space");
 	size = (size + 0x3fffff) >> 22;
-	dir = (unsigned long *) ((from>>20) & 0xffc); /* _pg_dir = 0 */
+	dir = dir_entry(dir,from);
 	for ( ; size-->0 ; dir++) {
 		if (!(1 & *dir))
 			continue;
-		pg_table = (unsigned long *) (0xfffff000 & *dir);
-		for (nr=0 ; nr<1024 ; nr++) {
-			if (*pg_table) {
-				if (1 & *pg_table)
-					free_page(0xfffff000 & *pg_table);
-				else
-					swap_free(*pg_table >> 1);
-				*pg_table = 0;
-			}
-			pg_table++;
-		}
-		free_page(0xfffff000 & *dir);
+		pg_table = 0xfffff000 & *dir;
+		if (mem_map[MAP_NR(pg_table)] > 1)
+			free_page(pg_table);
+		else
+			free_page_table(pg_table);
 		*dir = 0;
 	}
 	invalidate();
@@ -114,20 +140,68 @@ int free_page_tables(unsigned long from,unsigned long size)
  * doesn't take any more memory - we don't copy-on-write in the low
  * 1 Mb-range, so the pages can be shared with the kernel. Thus the
  * special case for nr=xxxx.
+ *
+ * NOTE 3!!! 'from' is in the current page directory, 'to' in 'to_dir'
+ * (the child's). Only directory entries that are present are copied,
+ * the rest of the (big) user space costs nothing.
+ *
+ * NOTE 4!!! The page tables themselves aren't copied either: parent and
+ * child share them, with the directory entries write-protected, and the
+ * first write fault copies the table (unshare_page_table()). A fork that
+ * is followed by exec() thus only touches the page directory.
  */
-int copy_page_tables(unsigned long from,unsigned long to,long size)
+
+/* page tables shared by more tasks than this are copied right away */
+#define MAX_TABLE_SHARE 250
+
+/*
+ * Copy 'nr' page table entries, write-protecting the pages so both
+ * tables share them copy-on-write. Swapped out pages can't be shared:
+ * the source gets the page read back in, the copy keeps the swap entry.
+ * The page read in stays write-protected, as the source table may be
+ * shared itself.
+ */
+static int copy_table_entries(unsigned long * from_page_table,
+	unsigned long * to_page_table, unsigned long nr)
 {
-	unsigned long * from_page_table;
-	unsigned long * to_page_table;
 	unsigned long this_page;
-	unsigned long * from_dir, * to_dir;
 	unsigned long new_page;
-	unsigned long nr;
+
+	for ( ; nr-- > 0 ; from_page_table++,to_page_table++) {
+		this_page = *from_page_table;
+		if (!this_page)
+			continue;
+		if (!(1 & this_page)) {
+			if (!(new_page = get_free_page()))
+				return -1;
+			read_swap_page(this_page>>1, (char *) new_page);
+			*to_page_table = this_page;
+			*from_page_table = new_page | (PAGE_DIRTY | 5);
+			continue;
+		}
+		this_page &= ~2;
+		*to_page_table = this_page;
+		if (this_page > LOW_MEM) {
+			*from_page_table = this_page;
+			this_page -= LOW_MEM;
+			this_page >>= 12;
+			mem_map[this_page]++;
+		}
+	}
+	return 0;
+}
+
+int copy_page_tables(unsigned long * to_dir,unsigned long from,
+	unsigned long to,long size)
+{
+	unsigned long * from_page_table;
+	unsigned long * to_page_table;
+	unsigned long * from_dir;
 
 	if ((from&0x3fffff) || (to&0x3fffff))
 		panic("copy_page_tables called with wrong alignment");
-	from_dir = (unsigned long *) ((from>>20) & 0xffc); /* _pg_dir = 0 */
-	to_dir = (unsigned long *) ((to>>20) & 0xffc);
+	from_dir = dir_entry(PG_DIR(current),from);
+	to_dir = dir_entry(to_dir,to);
 	size = ((unsigned) (size+0x3fffff)) >> 22;
 	for( ; size-->0 ; from_dir++,to_dir++) {
 		if (1 & *to_dir)
@@ -135,31 +209,19 @@ int copy_page_tables(unsigned long from,unsigned long to,long size)
 		if (!(1 & *from_dir))
 			continue;
 		from_page_table = (unsigned long *) (0xfffff000 & *from_dir);
+		if (from && mem_map[MAP_NR((unsigned long) from_page_table)] <
+		    MAX_TABLE_SHARE) {
+			*from_dir &= ~2;
+			*to_dir = *from_dir;
+			mem_map[MAP_NR((unsigned long) from_page_table)]++;
+			continue;
+		}
 		if (!(to_page_table = (unsigned long *) get_free_page()))
 			return -1;	/* Out of memory, see freeing */
 		*to_dir = ((unsigned long) to_page_table) | 7;
-		nr = (from==0)?0xA0:1024;
-		for ( ; nr-- > 0 ; from_page_table++,to_page_table++) {
-			this_page = *from_page_table;
-			if (!this_page)
-				continue;
-			if (!(1 & this_page)) {
-				if (!(new_page = get_free_page()))
-					return -1;
-				read_swap_page(this_page>>1, (char *) new_page);
-				*to_page_table = this_page;
-				*from_page_table = new_page | (PAGE_DIRTY | 7);
-				continue;
-			}
-			this_page &= ~2;
-			*to_page_table = this_page;
-			if (this_page > LOW_MEM) {
-				*from_page_table = this_page;
-				this_page -= LOW_MEM;
-				this_page >>= 12;
-				mem_map[this_page]++;
-			}
-		}
+		if (copy_table_entries(from_page_table,to_page_table,
+		    (from==0)?0xA0:1024))
+			return -1;
 	}
 	invalidate();
 	return 0;
@@ -175,13 +237,11 @@ static unsigned long put_page(unsigned long page,unsigned long address)
 {
 	unsigned long tmp, *page_table;
 
-/* NOTE !!! This uses the fact that _pg_dir=0 */
-
 	if (page < LOW_MEM || page >= HIGH_MEMORY)
 		printk("Trying to put page %p at %p\n",page,address);
 	if (mem_map[(page-LOW_MEM)>>12] != 1)
 		printk("mem_map disagrees with %p at %p\n",page,address);
-	page_table = (unsigned long *) ((address>>20) & 0xffc);
+	page_table = dir_entry(PG_DIR(current),address);
 	if ((*page_table)&1)
 		page_table = (unsigned long *) (0xfffff000 & *page_table);
 	else {
@@ -205,13 +265,11 @@ unsigned long put_dirty_page(unsigned long page, unsigned long address)
 {
 	unsigned long tmp, *page_table;
 
-/* NOTE !!! This uses the fact that _pg_dir=0 */
-
 	if (page < LOW_MEM || page >= HIGH_MEMORY)
 		printk("Trying to put page %p at %p\n",page,address);
 	if (mem_map[(page-LOW_MEM)>>12] != 1)
 		printk("mem_map disagrees with %p at %p\n",page,address);
-	page_table = (unsigned long *) ((address>>20) & 0xffc);
+	page_table = dir_entry(PG_DIR(current),address);
 	if ((*page_table)&1)
 		page_table = (unsigned long *) (0xfffff000 & *page_table);
 	else {
@@ -244,16 +302,45 @@ void un_wp_page(unsigned long * table_entry)
 	invalidate();
 }	
 
+/*
+ * Give the current task its own copy of the page table behind the
+ * write-protected directory entry 'dir', which fork() left shared.
+ * If nobody else uses the table any more it is simply made writable.
+ */
+static void unshare_page_table(unsigned long * dir)
+{
+	unsigned long old_table,new_table;
+
+	old_table = 0xfffff000 & *dir;
+	if (mem_map[MAP_NR(old_table)] > 1) {
+		if (!(new_table = get_free_page()))
+			oom();
+		if (copy_table_entries((unsigned long *) old_table,
+		    (unsigned long *) new_table,1024))
+			oom();
+		if (mem_map[MAP_NR(old_table)] > 1)
+			free_page(old_table);
+		else
+			free_page_table(old_table);
+		*dir = new_table | 7;
+	} else
+		*dir |= 2;
+	invalidate();
+}
+
 /*
  * This routine handles present pages, when users try to write
  * to a shared page. It is done by copying the page to a new address
- * and decrementing the shared-page counter for the old page.
+ * and decrementing the shared-page counter for the old page. A
+ * write-protected page table is unshared first.
  *
  * If it's in code space we exit with a segment error.
  */
 void do_wp_page(unsigned long error_code,unsigned long address)
 {
-	if (address < TASK_SIZE)
+	unsigned long * dir, * page;
+
+	if (address < USER_BASE)
 		printk("\n\rBAD! KERNEL MEMORY WP-ERR!\n\r");
 	if (address - current->start_code > TASK_SIZE) {
 		printk("Bad things happen: page error in do_wp_page\n\r");
@@ -265,18 +352,31 @@ void do_wp_page(unsigned long error_code,unsigned long address)
 	if (CODE_SPACE(address))
 		do_exit(SIGSEGV);
 #endif
-	un_wp_page((unsigned long *)
-		(((address>>10) & 0xffc) + (0xfffff000 &
-		*((unsigned long *) ((address>>20) &0xffc)))));
-
+	dir = dir_entry(PG_DIR(current),address);
+	if (!(2 & *dir))
+		unshare_page_table(dir);
+	page = table_entry(*dir,address);
+	if ((3 & *page) == 1)  /* non-writeable, present */
+		un_wp_page(page);
 }
 
+/*
+ * The kernel writes to user space without any write protection (the
+ * 386 ignores it in supervisor mode), so shared page tables and pages
+ * have to be copied by hand first.
+ */
 void write_verify(unsigned long address)
 {
 	unsigned long page;
+	unsigned long * dir;
 
-	if (!( (page = *((unsigned long *) ((address>>20) & 0xffc)) )&1))
+	dir = dir_entry(PG_DIR(current),address);
+	if (!( (page = *dir) )&1)
 		return;
+	if (!(2 & page)) {
+		unshare_page_table(dir);
+		page = *dir;
+	}
 	page &= 0xfffff000;
 	page += ((address>>10) & 0xffc);
 	if ((3 & *(unsigned long *) page) == 1)  /* non-writeable, present */
@@ -311,8 +411,8 @@ static int try_to_share(unsigned long address, struct task_struct * p)
 	unsigned long phys_addr;
 
 	from_page = to_page = ((address>>20) & 0xffc);
-	from_page += ((p->start_code>>20) & 0xffc);
-	to_page += ((current->start_code>>20) & 0xffc);
+	from_page += ((p->start_code>>20) & 0xffc) + p->tss.cr3;
+	to_page += ((current->start_code>>20) & 0xffc) + current->tss.cr3;
 /* is there a page-directory at from? */
 	from = *(unsigned long *) from_page;
 	if (!(from & 1))
@@ -378,21 +478,58 @@ static int share_page(struct m_inode * inode, unsigned long address)
 	return 0;
 }
 
-void do_no_page(unsigned long error_code,unsigned long address)
+/*
+ * Bring in the page at 'address', 'tmp' bytes into the image 'inode'
+ * starting at block 'block': share it with another task running the
+ * same binary, or read it from disk. Returns 0 if out of memory.
+ */
+static int file_page(struct m_inode * inode, int block,
+	unsigned long tmp, unsigned long address)
 {
 	int nr[4];
+	unsigned long page;
+	int i;
+
+	if (share_page(inode,tmp))
+		return 1;
+	if (!(page = get_free_page()))
+		return 0;
+/* remember that 1 block is used for header */
+	for (i=0 ; i<4 ; block++,i++)
+		nr[i] = bmap(inode,block);
+	bread_page(page,inode->i_dev,nr);
+	i = tmp + 4096 - current->end_data;
+	if (i>4095)
+		i = 0;
+	tmp = page + 4096;
+	while (i-- > 0) {
+		tmp--;
+		*(char *)tmp = 0;
+	}
+	if (put_page(page,address))
+		return 1;
+	free_page(page);
+	return 0;
+}
+
+void do_no_page(unsigned long error_code,unsigned long address)
+{
 	unsigned long tmp;
 	unsigned long page;
-	int block,i;
+	int block;
 	struct m_inode * inode;
 
-	if (address < TASK_SIZE)
+	if (address < USER_BASE)
 		printk("\n\rBAD!! KERNEL PAGE MISSING\n\r");
 	if (address - current->start_code > TASK_SIZE) {
 		printk("Bad things happen: nonexistent page error in do_no_page\n\r");
 		do_exit(SIGSEGV);
 	}
-	page = *(unsigned long *) ((address >> 20) & 0xffc);
+	page = *dir_entry(PG_DIR(current),address);
+	if ((page & 3) == 1) {	/* page table still shared after fork */
+		unshare_page_table(dir_entry(PG_DIR(current),address));
+		page = *dir_entry(PG_DIR(current),address);
+	}
 	if (page & 1) {
 		page &= 0xfffff000;
 		page += (address >> 10) & 0xffc;
@@ -418,26 +555,78 @@ void do_no_page(unsigned long error_code,unsigned long address)
 		get_empty_page(address);
 		return;
 	}
-	if (share_page(inode,tmp))
-		return;
-	if (!(page = get_free_page()))
+	if (!file_page(inode,block,tmp,address))
 		oom();
-/* remember that 1 block is used for header */
-	for (i=0 ; i<4 ; block++,i++)
-		nr[i] = bmap(inode,block);
-	bread_page(page,inode->i_dev,nr);
-	i = tmp + 4096 - current->end_data;
-	if (i>4095)
-		i = 0;
-	tmp = page + 4096;
-	while (i-- > 0) {
-		tmp--;
-		*(char *)tmp = 0;
-	}
-	if (put_page(page,address))
+}
+
+/*
+ * Exec working sets. Which of the first WSET_PAGES pages of the image a
+ * run actually touched (accessed bit set) is remembered in the in-core
+ * inode of the executable, and the next exec of it reads those pages in
+ * as one batch of requests instead of a fault and a disk round trip per
+ * page. A binary without a hint gets the pages around its entry point
+ * and the start of its data.
+ */
+#define WSET_PAGES 32
+#define WSET_BIT(nr) (((nr) < WSET_PAGES)?(1UL << (nr)):0)
+
+void save_wset(void)
+{
+	unsigned long address, page;
+	unsigned long wset = 0;
+	int i;
+
+	if (!current->executable || (current->flags & PF_VFORK))
 		return;
-	free_page(page);
-	oom();
+	for (i=0 ; i<WSET_PAGES && i*PAGE_SIZE < current->end_data ; i++) {
+		address = current->start_code + i*PAGE_SIZE;
+		page = *dir_entry(PG_DIR(current),address);
+		if (!(page & 1))
+			continue;
+		page = *table_entry(page,address);
+		if ((page & (PAGE_ACCESSED | PAGE_PRESENT)) ==
+		    (PAGE_ACCESSED | PAGE_PRESENT))
+			wset |= WSET_BIT(i);
+	}
+	if (wset)
+		current->executable->i_wset = wset;
+}
+
+void prefault_wset(unsigned long entry)
+{
+	struct m_inode * inode = current->executable;
+	struct buffer_head * bh;
+	unsigned long wset;
+	int i, j, block;
+
+	if (!(wset = inode->i_wset)) {
+		i = entry >> 12;
+		wset = WSET_BIT(i) | WSET_BIT(i+1);
+		if (i)
+			wset |= WSET_BIT(i-1);
+		wset |= WSET_BIT(current->end_code >> 12);
+	}
+/* queue all the blocks first, so they go to the drive in one batch */
+	for (i=0 ; i<WSET_PAGES && i*PAGE_SIZE < current->end_data ; i++) {
+		if (!(wset & WSET_BIT(i)))
+			continue;
+		for (j=0 ; j<4 ; j++) {
+			if (!(block = bmap(inode,1+i*4+j)))
+				continue;
+			if (!(bh = getblk(inode->i_dev,block)))
+				continue;
+			if (!bh->b_uptodate)
+				ll_rw_block(READA,bh);
+			bh->b_count--;
+		}
+	}
+	for (i=0 ; i<WSET_PAGES && i*PAGE_SIZE < current->end_data ; i++) {
+		if (!(wset & WSET_BIT(i)))
+			continue;
+		if (!file_page(inode,1+i*4,i*PAGE_SIZE,
+		    current->start_code + i*PAGE_SIZE))
+			break;
+	}
 }
 
 void mem_init(long start_mem, long end_mem)
@@ -456,9 +645,9 @@ void mem_init(long start_mem, long end_mem)
 
 void show_mem(void)
 {
-	int i,j,k,free=0,total=0;
+	int i,j,k,n,free=0,total=0;
 	int shared=0;
-	unsigned long * pg_tbl;
+	unsigned long * dir, * pg_tbl;
 
 	printk("Mem-info:\n\r");
 	for(i=0 ; i<PAGING_PAGES ; i++) {
@@ -472,31 +661,31 @@ void show_mem(void)
 	}
 	printk("%d free pages of %d\n\r",free,total);
 	printk("%d pages shared\n\r",shared);
-	k = 0;
-	for(i=4 ; i<1024 ;) {
-		if (1&pg_dir[i]) {
-			if (pg_dir[i]>HIGH_MEMORY) {
+	for(n=1 ; n<nr_tasks ; n++) {
+		if (!task[n])
+			continue;
+		dir = PG_DIR(task[n]);
+		k = 2;		/* task_struct and page directory */
+		for(i=USER_BASE>>22 ; i<1024 ; i++) {
+			if (!(1&dir[i]))
+				continue;
+			if (dir[i]>HIGH_MEMORY) {
 				printk("page directory[%d]: %08X\n\r",
-					i,pg_dir[i]);
+					i,dir[i]);
 				continue;
 			}
-			if (pg_dir[i]>LOW_MEM)
-				free++,k++;
-			pg_tbl=(unsigned long *) (0xfffff000 & pg_dir[i]);
+			k++;
+			pg_tbl=(unsigned long *) (0xfffff000 & dir[i]);
 			for(j=0 ; j<1024 ; j++)
 				if ((pg_tbl[j]&1) && pg_tbl[j]>LOW_MEM)
 					if (pg_tbl[j]>HIGH_MEMORY)
 						printk("page_dir[%d][%d]: %08X\n\r",
 							i,j, pg_tbl[j]);
 					else
-						k++,free++;
-		}
-		i++;
-		if (!(i&15) && k) {
-			k++,free++;	/* one page/process for task_struct */
-			printk("Process %d: %d pages\n\r",(i>>4)-1,k);
-			k = 0;
+						k++;
 		}
+		free += k;
+		printk("Process %d: %d pages\n\r",n,k);
 	}
 	printk("Memory found: %d (%d)\n\r",free-shared,total);
 }
@@ -37,11 +37,12 @@ int SWAP_DEV = 0;
 
 /*
  * We never page the pages in task[0] - kernel memory.
- * We page all other pages.
+ * We page all other pages, walking the user part of each task's
+ * page directory in turn.
  */
-#define FIRST_VM_PAGE (TASK_SIZE>>12)
-#define LAST_VM_PAGE (1024*1024)
-#define VM_PAGES (LAST_VM_PAGE - FIRST_VM_PAGE)
+#define FIRST_VM_DIR (USER_BASE>>22)
+#define LAST_VM_DIR ((USER_BASE+TASK_SIZE-1)>>22)
+#define VM_DIRS (LAST_VM_DIR - FIRST_VM_DIR + 1)
 
 static int get_swap_page(void)
 {
@@ -121,45 +122,36 @@ int try_to_swap_out(unsigned long * table_ptr)
 }
 
 /*
- * Ok, this has a rather intricate logic - the idea is to make good
- * and fast machine code. If we didn't worry about that, things would
- * be easier.
+ * swap_out() carries on where it left off last time: task swap_task,
+ * directory entry dir_entry, page page_entry. The page table is looked
+ * up again on every call, as the task may have exited meanwhile.
  */
 int swap_out(void)
 {
-	static int dir_entry = FIRST_VM_PAGE>>10;
+	static int swap_task = 1;
+	static int dir_entry = FIRST_VM_DIR;
 	static int page_entry = -1;
-	int counter = VM_PAGES;
-	int pg_table;
-
-	while (counter>0) {
-		pg_table = pg_dir[dir_entry];
-		if (pg_table & 1)
-			break;
-		counter -= 1024;
-		dir_entry++;
-		if (dir_entry >= 1024)
-			dir_entry = FIRST_VM_PAGE>>10;
-	}
-	pg_table &= 0xfffff000;
+	int counter = nr_tasks * VM_DIRS;
+	unsigned long pg_table;
+
 	while (counter-- > 0) {
-		page_entry++;
-		if (page_entry >= 1024) {
-			page_entry = 0;
-		repeat:
-			dir_entry++;
-			if (dir_entry >= 1024)
-				dir_entry = FIRST_VM_PAGE>>10;
-			pg_table = pg_dir[dir_entry];
-			if (!(pg_table&1))
-				if ((counter -= 1024) > 0)
-					goto repeat;
-				else
-					break;
+		if (swap_task < nr_tasks && task[swap_task])
+			pg_table = PG_DIR(task[swap_task])[dir_entry];
+		else
+			pg_table = 0;
+		if (pg_table & 1) {
 			pg_table &= 0xfffff000;
+			while (++page_entry < 1024)
+				if (try_to_swap_out(page_entry +
+				    (unsigned long *) pg_table))
+					return 1;
+		}
+		page_entry = -1;
+		if (++dir_entry > LAST_VM_DIR) {
+			dir_entry = FIRST_VM_DIR;
+			if (++swap_task >= nr_tasks)
+				swap_task = 1;
 		}
-		if (try_to_swap_out(page_entry + (unsigned long *) pg_table))
-			return 1;
 	}
 	printk("Out of swap-memory\n\r");
 	return 0;
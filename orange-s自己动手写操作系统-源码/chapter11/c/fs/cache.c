@@ -0,0 +1,317 @@
+/*************************************************************************//**
+ *****************************************************************************
+ * @file   fs/cache.c
+ * The file contains:
+ *   - cache_rw()
+ *   - do_sync()
+ *   - do_cache_stat()
+ *   - cache_flush()
+ *   - init_bcache()
+ *
+ * Sector cache of TASK FS. Sectors read or written by FS are kept in an
+ * LRU list, so that a sector which has been touched a moment ago (an
+ * inode, the imap, a directory) need not be fetched from TASK_HD again.
+ * Writes are delayed until the sector is evicted or sync() is called.
+ *
+ * @author Forrest Yu
+ * @date   2008
+ *****************************************************************************
+ *****************************************************************************/
+
+#include "type.h"
+#include "stdio.h"
+#include "const.h"
+#include "protect.h"
+#include "string.h"
+#include "fs.h"
+#include "proc.h"
+#include "tty.h"
+#include "console.h"
+#include "global.h"
+#include "keyboard.h"
+#include "proto.h"
+
+#define	BC_HASH_SIZE	128
+#define	BC_HASH(dev,sect)	(((dev) ^ (sect)) & (BC_HASH_SIZE - 1))
+
+PRIVATE struct bcache		bcache[NR_BCACHE];
+PRIVATE struct bcache		bc_lru;	/* list head, MRU at bc_lru.next */
+PRIVATE struct bcache *		bc_hash[BC_HASH_SIZE];
+PRIVATE struct cache_stat	bc_stat;
+
+PRIVATE struct bcache * bc_find(int dev, int sect);
+PRIVATE struct bcache * bc_get(int dev, int sect);
+PRIVATE void bc_unhash(struct bcache * b);
+PRIVATE void bc_touch(struct bcache * b);
+PRIVATE void bc_write(struct bcache * b);
+
+/*****************************************************************************
+ *                                init_bcache
+ *****************************************************************************/
+/**
+ * <Ring 1> Put all the cache slots, empty, in the LRU list.
+ *****************************************************************************/
+PUBLIC void init_bcache()
+{
+	int i;
+
+	bc_lru.next = bc_lru.prev = &bc_lru;
+	for (i = 0; i < BC_HASH_SIZE; i++)
+		bc_hash[i] = 0;
+
+	for (i = 0; i < NR_BCACHE; i++) {
+		struct bcache * b = &bcache[i];
+		b->dev = NO_DEV;
+		b->sect = 0;
+		b->dirty = 0;
+		b->data = bcache_buf + i * SECTOR_SIZE;
+		b->hnext = 0;
+		/* append to the tail */
+		b->prev = bc_lru.prev;
+		b->next = &bc_lru;
+		bc_lru.prev->next = b;
+		bc_lru.prev = b;
+	}
+
+	memset(&bc_stat, 0, sizeof(bc_stat));
+	bc_stat.nr_bufs = NR_BCACHE;
+}
+
+/*****************************************************************************
+ *                                cache_rw
+ *****************************************************************************/
+/**
+ * <Ring 1> R/W sectors through the cache. See rw_sector() for the params.
+ *
+ * Requests larger than BC_MAX_IO sectors (big chunks of file data) and
+ * requests for buffers not owned by TASK FS go to the driver directly,
+ * after the cached copies of the sectors have been written back (read) or
+ * dropped (write).
+ *
+ * @return Zero if success.
+ *****************************************************************************/
+PUBLIC int cache_rw(int io_type, int dev, u64 pos, int bytes, int proc_nr,
+		    void* buf)
+{
+	int sect = (int)(pos >> SECTOR_SIZE_SHIFT);
+	int nr_sects = bytes >> SECTOR_SIZE_SHIFT;
+	u8 * p = (u8*)buf;
+	struct bcache * b;
+	int i;
+
+	assert(pos % SECTOR_SIZE == 0 && bytes % SECTOR_SIZE == 0);
+
+	if (proc_nr != TASK_FS || nr_sects > BC_MAX_IO) {
+		cache_flush(dev, sect, nr_sects, io_type == DEV_WRITE);
+		return drv_rw_sector(io_type, dev, pos, bytes, proc_nr, buf);
+	}
+
+	if (io_type == DEV_WRITE) {
+		for (i = 0; i < nr_sects; i++, p += SECTOR_SIZE) {
+			if (!(b = bc_find(dev, sect + i)))
+				b = bc_get(dev, sect + i);
+			memcpy(b->data, p, SECTOR_SIZE);
+			b->dirty = 1;
+			bc_touch(b);
+		}
+		return 0;
+	}
+
+	assert(io_type == DEV_READ);
+
+	/* one message to the driver for the whole request if anything misses */
+	for (i = 0; i < nr_sects; i++)
+		if (!bc_find(dev, sect + i))
+			break;
+	if (i < nr_sects)
+		drv_rw_sector(DEV_READ, dev, pos, bytes, proc_nr, buf);
+
+	/**
+	 * The cached copies may be newer than the disk, so take them all
+	 * before any bc_get(), which could evict one of them.
+	 */
+	for (i = 0; i < nr_sects; i++, p += SECTOR_SIZE) {
+		if ((b = bc_find(dev, sect + i))) {
+			memcpy(p, b->data, SECTOR_SIZE);
+			bc_touch(b);
+			bc_stat.hits++;
+		}
+	}
+
+	/* buf is right now; cache the sectors that were missing */
+	p = (u8*)buf;
+	for (i = 0; i < nr_sects; i++, p += SECTOR_SIZE) {
+		if (!bc_find(dev, sect + i)) {
+			b = bc_get(dev, sect + i);
+			memcpy(b->data, p, SECTOR_SIZE);
+			bc_touch(b);
+			bc_stat.misses++;
+		}
+	}
+
+	return 0;
+}
+
+/*****************************************************************************
+ *                                do_sync
+ *****************************************************************************/
+/**
+ * Write all the dirty sectors in the cache back to the disk.
+ *
+ * @return Zero if success.
+ *****************************************************************************/
+PUBLIC int do_sync()
+{
+	struct bcache * b;
+
+	for (b = bcache; b < &bcache[NR_BCACHE]; b++)
+		if (b->dirty)
+			bc_write(b);
+
+	return 0;
+}
+
+/*****************************************************************************
+ *                                do_cache_stat
+ *****************************************************************************/
+/**
+ * Handle the message CACHE_STAT: copy the hit/miss counters to the caller.
+ *
+ * @return Zero if success.
+ *****************************************************************************/
+PUBLIC int do_cache_stat()
+{
+	phys_copy((void*)va2la(fs_msg.source, fs_msg.BUF), /* to   */
+		  (void*)va2la(TASK_FS, &bc_stat),	    /* from */
+		  sizeof(struct cache_stat));
+
+	return 0;
+}
+
+/*****************************************************************************
+ *                                bc_find
+ *****************************************************************************/
+/**
+ * Look a sector up in the cache.
+ *
+ * @return The slot holding the sector, or 0 if it's not cached.
+ *****************************************************************************/
+PRIVATE struct bcache * bc_find(int dev, int sect)
+{
+	struct bcache * b = bc_hash[BC_HASH(dev, sect)];
+
+	for (; b; b = b->hnext)
+		if (b->dev == dev && b->sect == sect)
+			return b;
+
+	return 0;
+}
+
+/*****************************************************************************
+ *                                bc_get
+ *****************************************************************************/
+/**
+ * Take the least recently used slot for a sector that is not cached. The
+ * old content of the slot is written back first if it's dirty. The caller
+ * is responsible for filling the data.
+ *
+ * @return The slot.
+ *****************************************************************************/
+PRIVATE struct bcache * bc_get(int dev, int sect)
+{
+	struct bcache * b = bc_lru.prev;
+
+	assert(b != &bc_lru);
+
+	if (b->dirty)
+		bc_write(b);
+	if (b->dev != NO_DEV)
+		bc_unhash(b);
+
+	b->dev = dev;
+	b->sect = sect;
+	b->hnext = bc_hash[BC_HASH(dev, sect)];
+	bc_hash[BC_HASH(dev, sect)] = b;
+
+	return b;
+}
+
+/*****************************************************************************
+ *                                bc_unhash
+ *****************************************************************************/
+/**
+ * Remove a slot from its hash chain and mark it empty.
+ *****************************************************************************/
+PRIVATE void bc_unhash(struct bcache * b)
+{
+	struct bcache ** pp = &bc_hash[BC_HASH(b->dev, b->sect)];
+
+	for (; *pp; pp = &(*pp)->hnext) {
+		if (*pp == b) {
+			*pp = b->hnext;
+			break;
+		}
+	}
+	b->hnext = 0;
+	b->dev = NO_DEV;
+}
+
+/*****************************************************************************
+ *                                bc_touch
+ *****************************************************************************/
+/**
+ * Move a slot to the head (most recently used end) of the LRU list.
+ *****************************************************************************/
+PRIVATE void bc_touch(struct bcache * b)
+{
+	b->prev->next = b->next;
+	b->next->prev = b->prev;
+
+	b->next = bc_lru.next;
+	b->prev = &bc_lru;
+	bc_lru.next->prev = b;
+	bc_lru.next = b;
+}
+
+/*****************************************************************************
+ *                                bc_write
+ *****************************************************************************/
+/**
+ * Write a dirty slot back to the disk.
+ *****************************************************************************/
+PRIVATE void bc_write(struct bcache * b)
+{
+	drv_rw_sector(DEV_WRITE, b->dev, (u64)b->sect * SECTOR_SIZE,
+		      SECTOR_SIZE, TASK_FS, b->data);
+	b->dirty = 0;
+	bc_stat.writebacks++;
+}
+
+/*****************************************************************************
+ *                                cache_flush
+ *****************************************************************************/
+/**
+ * Write back the cached copies of a range of sectors, or drop them if
+ * the range is about to be overwritten on the disk.
+ *
+ * @param dev       Device nr.
+ * @param sect      The first sector.
+ * @param nr_sects  How many sectors.
+ * @param drop      Nonzero to drop the copies instead of writing them.
+ *****************************************************************************/
+PUBLIC void cache_flush(int dev, int sect, int nr_sects, int drop)
+{
+	struct bcache * b;
+
+	for (b = bcache; b < &bcache[NR_BCACHE]; b++) {
+		if (b->dev != dev || b->sect < sect || b->sect >= sect + nr_sects)
+			continue;
+		if (drop) {
+			b->dirty = 0;
+			bc_unhash(b);
+		}
+		else if (b->dirty) {
+			bc_write(b);
+		}
+	}
+}
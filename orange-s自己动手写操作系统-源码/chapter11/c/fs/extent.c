@@ -0,0 +1,393 @@
+/*************************************************************************//**
+ *****************************************************************************
+ * @file   fs/extent.c
+ * The file contains:
+ *   - bmap()
+ *   - extend_file()
+ *   - free_extents()
+ *
+ * A regular file is a list of extents, i.e. runs of contiguous sectors.
+ * The first one is in the i-node (i_start_sect, i_nr_sects), the others,
+ * if any, are kept in sector i_ext_sect in the order of their position in
+ * the file.
+ *
+ * Sectors are not allocated when a file is created but when it's written,
+ * a whole write at a time, and next to the end of the file if possible.
+ * So a file written sequentially ends up in few long extents.
+ *
+ * @author Forrest Yu
+ * @date   2008
+ *****************************************************************************
+ *****************************************************************************/
+
+#include "type.h"
+#include "stdio.h"
+#include "const.h"
+#include "protect.h"
+#include "string.h"
+#include "fs.h"
+#include "proc.h"
+#include "tty.h"
+#include "console.h"
+#include "global.h"
+#include "keyboard.h"
+#include "proto.h"
+
+PRIVATE struct extent	ext_buf[NR_EXTENTS];
+
+PRIVATE void read_extents(struct inode * pin);
+PRIVATE void write_extents(struct inode * pin);
+PRIVATE int  file_sects(struct inode * pin);
+PRIVATE int  add_extent(struct inode * pin, int start, int nr_sects);
+PRIVATE int  smap_find(int dev, int goal, int nr_sects, int * got);
+PRIVATE void smap_set(int dev, int sect, int nr_sects, int set);
+
+/*****************************************************************************
+ *                                bmap
+ *****************************************************************************/
+/**
+ * Map a sector of a file to the disk. The extents are binary searched.
+ *
+ * @param[in]  pin    I-node of the file.
+ * @param[in]  fsect  Sector index in the file.
+ * @param[out] run    How many sectors from there on are contiguous.
+ *
+ * @return The sector nr. on the disk, or 0 if fsect is not allocated.
+ *****************************************************************************/
+PUBLIC int bmap(struct inode * pin, int fsect, int * run)
+{
+	if (fsect < pin->i_nr_sects) {
+		*run = pin->i_nr_sects - fsect;
+		return pin->i_start_sect + fsect;
+	}
+
+	if (!pin->i_nr_extents)
+		return 0;
+
+	read_extents(pin);
+
+	/* the last extent beginning at or before fsect */
+	int lo = 0;
+	int hi = pin->i_nr_extents - 1;
+	while (lo < hi) {
+		int mid = (lo + hi + 1) / 2;
+		if (ext_buf[mid].e_fsect <= fsect)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	struct extent * e = &ext_buf[lo];
+	if (fsect >= e->e_fsect + e->e_nr_sects)
+		return 0;
+
+	*run = e->e_fsect + e->e_nr_sects - fsect;
+	return e->e_start + (fsect - e->e_fsect);
+}
+
+/*****************************************************************************
+ *                                extend_file
+ *****************************************************************************/
+/**
+ * Make sure the first nr_sects sectors of a file are allocated. The file
+ * grows by multiples of EXT_GROW_SECTS.
+ *
+ * @param pin       I-node of the file.
+ * @param nr_sects  How many sectors are needed.
+ *
+ * @return How many sectors the file has now. Less than nr_sects if the
+ *         disk or the extent list is full.
+ *****************************************************************************/
+PUBLIC int extend_file(struct inode * pin, int nr_sects)
+{
+	int have = file_sects(pin);
+	int changed = 0;
+
+	while (have < nr_sects) {
+		int want = (nr_sects - have + EXT_GROW_SECTS - 1) /
+			EXT_GROW_SECTS * EXT_GROW_SECTS;
+
+		/* try to go on from where the last extent ends */
+		int goal = 0;
+		if (pin->i_nr_extents)
+			goal = ext_buf[pin->i_nr_extents - 1].e_start +
+				ext_buf[pin->i_nr_extents - 1].e_nr_sects;
+		else if (pin->i_nr_sects)
+			goal = pin->i_start_sect + pin->i_nr_sects;
+
+		int got;
+		int start = smap_find(pin->i_dev, goal, want, &got);
+		if (!start)
+			break;
+
+		smap_set(pin->i_dev, start, got, 1);
+		if (!add_extent(pin, start, got)) {
+			smap_set(pin->i_dev, start, got, 0);
+			break;
+		}
+
+		have += got;
+		changed = 1;
+	}
+
+	if (changed)
+		sync_inode(pin);
+
+	return have;
+}
+
+/*****************************************************************************
+ *                                free_extents
+ *****************************************************************************/
+/**
+ * Free all the sectors of a file, including the one of its extent list.
+ * The i-node is not synced.
+ *
+ * @param pin  I-node of the file.
+ *****************************************************************************/
+PUBLIC void free_extents(struct inode * pin)
+{
+	int i;
+
+	if (pin->i_nr_sects)
+		smap_set(pin->i_dev, pin->i_start_sect, pin->i_nr_sects, 0);
+
+	if (pin->i_nr_extents) {
+		read_extents(pin);
+		for (i = 0; i < pin->i_nr_extents; i++)
+			smap_set(pin->i_dev, ext_buf[i].e_start,
+				 ext_buf[i].e_nr_sects, 0);
+	}
+
+	if (pin->i_ext_sect)
+		smap_set(pin->i_dev, pin->i_ext_sect, 1, 0);
+
+	pin->i_start_sect = 0;
+	pin->i_nr_sects = 0;
+	pin->i_ext_sect = 0;
+	pin->i_nr_extents = 0;
+}
+
+/*****************************************************************************
+ *                                read_extents
+ *****************************************************************************/
+/**
+ * Read the extent list of a file into ext_buf[].
+ *
+ * @param pin  I-node of the file.
+ *****************************************************************************/
+PRIVATE void read_extents(struct inode * pin)
+{
+	assert(pin->i_ext_sect);
+	rw_sector(DEV_READ, pin->i_dev, (u64)pin->i_ext_sect * SECTOR_SIZE,
+		  SECTOR_SIZE, TASK_FS, ext_buf);
+}
+
+/*****************************************************************************
+ *                                write_extents
+ *****************************************************************************/
+/**
+ * Write ext_buf[] back as the extent list of a file.
+ *
+ * @param pin  I-node of the file.
+ *****************************************************************************/
+PRIVATE void write_extents(struct inode * pin)
+{
+	assert(pin->i_ext_sect);
+	rw_sector(DEV_WRITE, pin->i_dev, (u64)pin->i_ext_sect * SECTOR_SIZE,
+		  SECTOR_SIZE, TASK_FS, ext_buf);
+}
+
+/*****************************************************************************
+ *                                file_sects
+ *****************************************************************************/
+/**
+ * How many sectors are allocated to a file. The extent list, if any, is
+ * left in ext_buf[].
+ *
+ * @param pin  I-node of the file.
+ *
+ * @return The nr. of sectors.
+ *****************************************************************************/
+PRIVATE int file_sects(struct inode * pin)
+{
+	if (!pin->i_nr_extents)
+		return pin->i_nr_sects;
+
+	read_extents(pin);
+
+	struct extent * e = &ext_buf[pin->i_nr_extents - 1];
+	return e->e_fsect + e->e_nr_sects;
+}
+
+/*****************************************************************************
+ *                                add_extent
+ *****************************************************************************/
+/**
+ * Append a run of sectors, already marked in the sector-map, to a file.
+ * A run adjacent to the last extent just makes it longer. ext_buf[] must
+ * hold the extent list of the file, see file_sects().
+ *
+ * @param pin       I-node of the file.
+ * @param start     The 1st sector of the run.
+ * @param nr_sects  Length of the run.
+ *
+ * @return Zero if the extent list is full.
+ *****************************************************************************/
+PRIVATE int add_extent(struct inode * pin, int start, int nr_sects)
+{
+	int n = pin->i_nr_extents;
+
+	if (!n) {
+		if (!pin->i_nr_sects)
+			pin->i_start_sect = start;
+		if (pin->i_start_sect + pin->i_nr_sects == start) {
+			pin->i_nr_sects += nr_sects;
+			return 1;
+		}
+	}
+	else if (ext_buf[n - 1].e_start + ext_buf[n - 1].e_nr_sects == start) {
+		ext_buf[n - 1].e_nr_sects += nr_sects;
+		write_extents(pin);
+		return 1;
+	}
+
+	if (n == NR_EXTENTS)
+		return 0;
+
+	if (!pin->i_ext_sect) {
+		int got;
+		int sect = smap_find(pin->i_dev, 0, 1, &got);
+		if (!sect)
+			return 0;
+		smap_set(pin->i_dev, sect, 1, 1);
+		pin->i_ext_sect = sect;
+	}
+
+	ext_buf[n].e_fsect = n ? ext_buf[n - 1].e_fsect +
+				 ext_buf[n - 1].e_nr_sects :
+				 pin->i_nr_sects;
+	ext_buf[n].e_start = start;
+	ext_buf[n].e_nr_sects = nr_sects;
+	pin->i_nr_extents++;
+	write_extents(pin);
+
+	return 1;
+}
+
+/*****************************************************************************
+ *                                smap_find
+ *****************************************************************************/
+/**
+ * Look for free sectors in the sector-map. Free sectors at goal are taken
+ * first, however few. Otherwise the first run long enough is taken, or the
+ * longest one if there isn't any.
+ *
+ * Sector M <-> bit (M - sb->n_1st_sect + 1) in the sector-map.
+ *
+ * @param[in]  dev       The device.
+ * @param[in]  goal      The preferred sector, 0 if none.
+ * @param[in]  nr_sects  How many sectors are wanted.
+ * @param[out] got       How many are free from the returned sector on,
+ *                       no more than nr_sects.
+ *
+ * @return The 1st free sector found, or 0 if the disk is full.
+ *****************************************************************************/
+PRIVATE int smap_find(int dev, int goal, int nr_sects, int * got)
+{
+	struct super_block * sb = get_super_block(dev);
+	int smap_blk0_nr = 1 + 1 + sb->nr_imap_sects;
+	int nr_bits = sb->nr_sects - sb->n_1st_sect + 1;
+	int bit;
+	int len;
+
+	if (goal) {
+		len = 0;
+		for (bit = goal - sb->n_1st_sect + 1;
+		     bit < nr_bits && len < nr_sects;
+		     bit++, len++) {
+			if (len == 0 || bit % SECTOR_BITS == 0)
+				RD_SECT(dev, smap_blk0_nr + bit / SECTOR_BITS);
+			if ((fsbuf[(bit / 8) % SECTOR_SIZE] >> (bit % 8)) & 1)
+				break;
+		}
+		if (len) {
+			*got = len;
+			return goal;
+		}
+	}
+
+	int best = 0;
+	int best_len = 0;
+	int run = 0;
+	len = 0;
+	for (bit = 1; bit < nr_bits; bit++) {
+		if (bit == 1 || bit % SECTOR_BITS == 0)
+			RD_SECT(dev, smap_blk0_nr + bit / SECTOR_BITS);
+
+		u8 byte = fsbuf[(bit / 8) % SECTOR_SIZE];
+		if (bit % 8 == 0 && byte == 0xFF) { /* skip `11111111' bytes */
+			len = 0;
+			bit += 7;
+			continue;
+		}
+		if ((byte >> (bit % 8)) & 1) {
+			len = 0;
+			continue;
+		}
+
+		if (len++ == 0)
+			run = bit;
+		if (len > best_len) {
+			best = run;
+			best_len = len;
+		}
+		if (len == nr_sects)
+			break;
+	}
+
+	if (!best_len)
+		return 0;
+
+	*got = best_len;
+	return best - 1 + sb->n_1st_sect;
+}
+
+/*****************************************************************************
+ *                                smap_set
+ *****************************************************************************/
+/**
+ * Set or clear the bits of a run of sectors in the sector-map.
+ *
+ * @param dev       The device.
+ * @param sect      The 1st sector.
+ * @param nr_sects  How many sectors.
+ * @param set       1 to allocate, 0 to free.
+ *****************************************************************************/
+PRIVATE void smap_set(int dev, int sect, int nr_sects, int set)
+{
+	struct super_block * sb = get_super_block(dev);
+	int smap_blk0_nr = 1 + 1 + sb->nr_imap_sects;
+	int bit = sect - sb->n_1st_sect + 1;
+	int s = 0;	/* the sector-map sector in fsbuf */
+
+	for (; nr_sects > 0; nr_sects--, bit++) {
+		int cur = smap_blk0_nr + bit / SECTOR_BITS;
+		if (cur != s) {
+			if (s)
+				WR_SECT(dev, s);
+			s = cur;
+			RD_SECT(dev, s);
+		}
+
+		u8 * p = &fsbuf[(bit / 8) % SECTOR_SIZE];
+		assert(((*p >> (bit % 8)) & 1) == !set);
+		if (set)
+			*p |= 1 << (bit % 8);
+		else
+			*p &= ~(1 << (bit % 8));
+	}
+
+	if (s)
+		WR_SECT(dev, s);
+}
@@ -77,8 +77,6 @@ PUBLIC int do_unlink()
 		return -1;
 	}
 
-	struct super_block * sb = get_super_block(pin->i_dev);
-
 	/*************************/
 	/* free the bit in i-map */
 	/*************************/
@@ -94,67 +92,13 @@ PUBLIC int do_unlink()
 	/**************************/
 	/* free the bits in s-map */
 	/**************************/
-	/*
-	 *           bit_idx: bit idx in the entire i-map
-	 *     ... ____|____
-	 *                  \        .-- byte_cnt: how many bytes between
-	 *                   \      |              the first and last byte
-	 *        +-+-+-+-+-+-+-+-+ V +-+-+-+-+-+-+-+-+
-	 *    ... | | | | | |*|*|*|...|*|*|*|*| | | | |
-	 *        +-+-+-+-+-+-+-+-+   +-+-+-+-+-+-+-+-+
-	 *         0 1 2 3 4 5 6 7     0 1 2 3 4 5 6 7
-	 *  ...__/
-	 *      byte_idx: byte idx in the entire i-map
-	 */
-	bit_idx  = pin->i_start_sect - sb->n_1st_sect + 1;
-	byte_idx = bit_idx / 8;
-	int bits_left = pin->i_nr_sects;
-	int byte_cnt = (bits_left - (8 - (bit_idx % 8))) / 8;
-
-	/* current sector nr. */
-	int s = 2  /* 2: bootsect + superblk */
-		+ sb->nr_imap_sects + byte_idx / SECTOR_SIZE;
-
-	RD_SECT(pin->i_dev, s);
-
-	int i;
-	/* clear the first byte */
-	for (i = bit_idx % 8; (i < 8) && bits_left; i++,bits_left--) {
-		assert((fsbuf[byte_idx % SECTOR_SIZE] >> i & 1) == 1);
-		fsbuf[byte_idx % SECTOR_SIZE] &= ~(1 << i);
-	}
-
-	/* clear bytes from the second byte to the second to last */
-	int k;
-	i = (byte_idx % SECTOR_SIZE) + 1;	/* the second byte */
-	for (k = 0; k < byte_cnt; k++,i++,bits_left-=8) {
-		if (i == SECTOR_SIZE) {
-			i = 0;
-			WR_SECT(pin->i_dev, s);
-			RD_SECT(pin->i_dev, ++s);
-		}
-		assert(fsbuf[i] == 0xFF);
-		fsbuf[i] = 0;
-	}
-
-	/* clear the last byte */
-	if (i == SECTOR_SIZE) {
-		i = 0;
-		WR_SECT(pin->i_dev, s);
-		RD_SECT(pin->i_dev, ++s);
-	}
-	unsigned char mask = ~((unsigned char)(~0) << bits_left);
-	assert((fsbuf[i] & mask) == mask);
-	fsbuf[i] &= (~0) << bits_left;
-	WR_SECT(pin->i_dev, s);
+	free_extents(pin);
 
 	/***************************/
 	/* clear the i-node itself */
 	/***************************/
 	pin->i_mode = 0;
 	pin->i_size = 0;
-	pin->i_start_sect = 0;
-	pin->i_nr_sects = 0;
 	sync_inode(pin);
 	/* release slot in inode_table[] */
 	put_inode(pin);
@@ -171,6 +115,7 @@ PUBLIC int do_unlink()
 						     * is still there)
 						     */
 	int m = 0;
+	int i;
 	struct dir_entry * pde = 0;
 	int flg = 0;
 	int dir_size = 0;
@@ -32,22 +32,37 @@ PRIVATE int fs_exit();
  *                                task_fs
  *****************************************************************************/
 /**
- * <Ring 1> The main loop of TASK FS.
+ * <Ring 1> The main loop of TASK FS. Requests are fetched in batches, all
+ * that are pending at a time.
  * 
  *****************************************************************************/
 PUBLIC void task_fs()
 {
+	MESSAGE msgs[NR_MAILBOX];
+	int nr_msgs = 0;
+	int next = 0;
+
 	printl("{FS} Task FS begins.\n");
 
 	init_fs();
 
 	while (1) {
-		send_recv(RECEIVE, ANY, &fs_msg);
+		if (next == nr_msgs) {
+			nr_msgs = send_recv(RECV_BATCH, NR_MAILBOX, msgs);
+			next = 0;
+		}
+		fs_msg = msgs[next++];
 
 		int msgtype = fs_msg.type;
 		int src = fs_msg.source;
 		pcaller = &proc_table[src];
 
+		if (src == TASK_HD) { /* an asynchronous R/W has been done */
+			rdwt_resume(&fs_msg);
+			resume_stashed();
+			continue;
+		}
+
 		switch (msgtype) {
 		case OPEN:
 			fs_msg.FD = do_open();
@@ -77,6 +92,12 @@ PUBLIC void task_fs()
 		case STAT:
 			fs_msg.RETVAL = do_stat();
 			break;
+		case SYNC:
+			fs_msg.RETVAL = do_sync();
+			break;
+		case CACHE_STAT:
+			fs_msg.RETVAL = do_cache_stat();
+			break;
 		default:
 			dump_msg("FS::unknown message:", &fs_msg);
 			assert(0);
@@ -94,6 +115,8 @@ PUBLIC void task_fs()
 		msg_name[FORK]   = "FORK";
 		msg_name[EXIT]   = "EXIT";
 		msg_name[STAT]   = "STAT";
+		msg_name[SYNC]   = "SYNC";
+		msg_name[CACHE_STAT] = "CACHE_STAT";
 
 		switch (msgtype) {
 		case UNLINK:
@@ -108,6 +131,8 @@ PUBLIC void task_fs()
 		case EXIT:
 		case LSEEK:
 		case STAT:
+		case SYNC:
+		case CACHE_STAT:
 			break;
 		case RESUME_PROC:
 			break;
@@ -121,6 +146,8 @@ PUBLIC void task_fs()
 			fs_msg.type = SYSCALL_RET;
 			send_recv(SEND, src, &fs_msg);
 		}
+
+		resume_stashed();
 	}
 }
 
@@ -148,6 +175,9 @@ PRIVATE void init_fs()
 	for (; sb < &super_block[NR_SUPER_BLOCK]; sb++)
 		sb->sb_dev = NO_DEV;
 
+	/* sector cache */
+	init_bcache();
+
 	/* open the device: hard disk */
 	MESSAGE driver_msg;
 	driver_msg.type = DEV_OPEN;
@@ -362,7 +392,8 @@ PRIVATE void mkfs()
  *                                rw_sector
  *****************************************************************************/
 /**
- * <Ring 1> R/W a sector via messaging with the corresponding driver.
+ * <Ring 1> R/W sectors. Small requests are served by the sector cache
+ * (fs/cache.c) if possible, the driver is messaged only when needed.
  * 
  * @param io_type  DEV_READ or DEV_WRITE
  * @param dev      device nr
@@ -375,6 +406,27 @@ PRIVATE void mkfs()
  *****************************************************************************/
 PUBLIC int rw_sector(int io_type, int dev, u64 pos, int bytes, int proc_nr,
 		     void* buf)
+{
+	return cache_rw(io_type, dev, pos, bytes, proc_nr, buf);
+}
+
+/*****************************************************************************
+ *                                drv_rw_sector
+ *****************************************************************************/
+/**
+ * <Ring 1> R/W a sector via messaging with the corresponding driver.
+ * 
+ * @param io_type  DEV_READ or DEV_WRITE
+ * @param dev      device nr
+ * @param pos      Byte offset from/to where to r/w.
+ * @param bytes    r/w count in bytes.
+ * @param proc_nr  To whom the buffer belongs.
+ * @param buf      r/w buffer.
+ * 
+ * @return Zero if success.
+ *****************************************************************************/
+PUBLIC int drv_rw_sector(int io_type, int dev, u64 pos, int bytes,
+			 int proc_nr, void* buf)
 {
 	MESSAGE driver_msg;
 
@@ -384,12 +436,38 @@ PUBLIC int rw_sector(int io_type, int dev, u64 pos, int bytes, int proc_nr,
 	driver_msg.BUF		= buf;
 	driver_msg.CNT		= bytes;
 	driver_msg.PROC_NR	= proc_nr;
-	assert(dd_map[MAJOR(dev)].driver_nr != INVALID_DRIVER);
-	send_recv(BOTH, dd_map[MAJOR(dev)].driver_nr, &driver_msg);
+	driver_msg.GRANT	= 0;
+	drv_request(dev, &driver_msg);
 
 	return 0;
 }
 
+/*****************************************************************************
+ *                                drv_request
+ *****************************************************************************/
+/**
+ * <Ring 1> Send a R/W request to the driver of a device and wait for it
+ * to be done. Replies to asynchronous requests (see do_rdwt()) that arrive
+ * meanwhile are stashed, to be handled by the main loop.
+ * 
+ * @param dev  device nr
+ * @param m    The request, which is overwritten by the reply.
+ *****************************************************************************/
+PUBLIC void drv_request(int dev, MESSAGE * m)
+{
+	int driver = dd_map[MAJOR(dev)].driver_nr;
+
+	assert(driver != INVALID_DRIVER);
+	m->REQ_ID = 0;
+	send_recv(SEND, driver, m);
+	while (1) {
+		send_recv(RECEIVE, driver, m);
+		if (m->REQ_ID == 0)
+			break;
+		stash_reply(m);
+	}
+}
+
 
 /*****************************************************************************
  *                                read_super_block
@@ -403,16 +481,9 @@ PUBLIC int rw_sector(int io_type, int dev, u64 pos, int bytes, int proc_nr,
 PRIVATE void read_super_block(int dev)
 {
 	int i;
-	MESSAGE driver_msg;
 
-	driver_msg.type		= DEV_READ;
-	driver_msg.DEVICE	= MINOR(dev);
-	driver_msg.POSITION	= SECTOR_SIZE * 1;
-	driver_msg.BUF		= fsbuf;
-	driver_msg.CNT		= SECTOR_SIZE;
-	driver_msg.PROC_NR	= TASK_FS;
-	assert(dd_map[MAJOR(dev)].driver_nr != INVALID_DRIVER);
-	send_recv(BOTH, dd_map[MAJOR(dev)].driver_nr, &driver_msg);
+	/* through the cache: mkfs() may have just written it there */
+	RD_SECT(dev, 1);
 
 	/* find a free slot in super_block[] */
 	for (i = 0; i < NR_SUPER_BLOCK; i++)
@@ -506,6 +577,8 @@ PUBLIC struct inode * get_inode(int dev, int num)
 	q->i_size = pinode->i_size;
 	q->i_start_sect = pinode->i_start_sect;
 	q->i_nr_sects = pinode->i_nr_sects;
+	q->i_ext_sect = pinode->i_ext_sect;
+	q->i_nr_extents = pinode->i_nr_extents;
 	return q;
 }
 
@@ -548,6 +621,8 @@ PUBLIC void sync_inode(struct inode * p)
 	pinode->i_size = p->i_size;
 	pinode->i_start_sect = p->i_start_sect;
 	pinode->i_nr_sects = p->i_nr_sects;
+	pinode->i_ext_sect = p->i_ext_sect;
+	pinode->i_nr_extents = p->i_nr_extents;
 	WR_SECT(p->i_dev, blk_nr);
 }
 
@@ -26,8 +26,7 @@
 
 PRIVATE struct inode * create_file(char * path, int flags);
 PRIVATE int alloc_imap_bit(int dev);
-PRIVATE int alloc_smap_bit(int dev, int nr_sects_to_alloc);
-PRIVATE struct inode * new_inode(int dev, int inode_nr, int start_sect);
+PRIVATE struct inode * new_inode(int dev, int inode_nr);
 PRIVATE void new_dir_entry(struct inode * dir_inode, int inode_nr, char * filename);
 
 /*****************************************************************************
@@ -172,10 +171,8 @@ PRIVATE struct inode * create_file(char * path, int flags)
 		return 0;
 
 	int inode_nr = alloc_imap_bit(dir_inode->i_dev);
-	int free_sect_nr = alloc_smap_bit(dir_inode->i_dev,
-					  NR_DEFAULT_FILE_SECTS);
-	struct inode *newino = new_inode(dir_inode->i_dev, inode_nr,
-					 free_sect_nr);
+	/* sectors are allocated as the file is written, see extend_file() */
+	struct inode *newino = new_inode(dir_inode->i_dev, inode_nr);
 
 	new_dir_entry(dir_inode, newino->i_num, filename);
 
@@ -284,85 +281,27 @@ PRIVATE int alloc_imap_bit(int dev)
 	return 0;
 }
 
-/*****************************************************************************
- *                                alloc_smap_bit
- *****************************************************************************/
-/**
- * Allocate a bit in sector-map.
- * 
- * @param dev  In which device the sector-map is located.
- * @param nr_sects_to_alloc  How many sectors are allocated.
- * 
- * @return  The 1st sector nr allocated.
- *****************************************************************************/
-PRIVATE int alloc_smap_bit(int dev, int nr_sects_to_alloc)
-{
-	/* int nr_sects_to_alloc = NR_DEFAULT_FILE_SECTS; */
-
-	int i; /* sector index */
-	int j; /* byte index */
-	int k; /* bit index */
-
-	struct super_block * sb = get_super_block(dev);
-
-	int smap_blk0_nr = 1 + 1 + sb->nr_imap_sects;
-	int free_sect_nr = 0;
-
-	for (i = 0; i < sb->nr_smap_sects; i++) { /* smap_blk0_nr + i :
-						     current sect nr. */
-		RD_SECT(dev, smap_blk0_nr + i);
-
-		/* byte offset in current sect */
-		for (j = 0; j < SECTOR_SIZE && nr_sects_to_alloc > 0; j++) {
-			k = 0;
-			if (!free_sect_nr) {
-				/* loop until a free bit is found */
-				if (fsbuf[j] == 0xFF) continue;
-				for (; ((fsbuf[j] >> k) & 1) != 0; k++) {}
-				free_sect_nr = (i * SECTOR_SIZE + j) * 8 +
-					k - 1 + sb->n_1st_sect;
-			}
-
-			for (; k < 8; k++) { /* repeat till enough bits are set */
-				assert(((fsbuf[j] >> k) & 1) == 0);
-				fsbuf[j] |= (1 << k);
-				if (--nr_sects_to_alloc == 0)
-					break;
-			}
-		}
-
-		if (free_sect_nr) /* free bit found, write the bits to smap */
-			WR_SECT(dev, smap_blk0_nr + i);
-
-		if (nr_sects_to_alloc == 0)
-			break;
-	}
-
-	assert(nr_sects_to_alloc == 0);
-
-	return free_sect_nr;
-}
-
 /*****************************************************************************
  *                                new_inode
  *****************************************************************************/
 /**
- * Generate a new i-node and write it to disk.
+ * Generate a new i-node and write it to disk. The file has no sectors yet.
  * 
  * @param dev  Home device of the i-node.
  * @param inode_nr  I-node nr.
- * @param start_sect  Start sector of the file pointed by the new i-node.
  * 
  * @return  Ptr of the new i-node.
  *****************************************************************************/
-PRIVATE struct inode * new_inode(int dev, int inode_nr, int start_sect)
+PRIVATE struct inode * new_inode(int dev, int inode_nr)
 {
 	struct inode * new_inode = get_inode(dev, inode_nr);
 
 	new_inode->i_mode = I_REGULAR;
 	new_inode->i_size = 0;
-	new_inode->i_start_sect = start_sect;
-	new_inode->i_nr_sects = NR_DEFAULT_FILE_SECTS;
+	new_inode->i_start_sect = 0;
+	new_inode->i_nr_sects = 0;
+	new_inode->i_ext_sect = 0;
+	new_inode->i_nr_extents = 0;
 
 	new_inode->i_dev = dev;
 	new_inode->i_cnt = 1;
@@ -21,14 +21,31 @@
 #include "proto.h"
 
 
+PRIVATE struct fs_req	fs_req[NR_FS_REQ];
+PRIVATE MESSAGE		fs_done[NR_FS_REQ];	/* see stash_reply() */
+PRIVATE int		nr_fs_done;
+
+PRIVATE int  rdwt_run(struct fs_req * r);
+PRIVATE void rdwt_copy(struct fs_req * r);
+PRIVATE void rdwt_advance(struct fs_req * r);
+PRIVATE int  rdwt_finish(struct fs_req * r);
+PRIVATE void rdwt_submit(struct fs_req * r, int io_type, int direct);
+
 /*****************************************************************************
  *                                do_rdwt
  *****************************************************************************/
 /**
  * Read/Write file and return byte count read/written.
  *
- * Sector map is not needed to update, since the sectors for the file have been
- * allocated and the bits are set when the file was created.
+ * A WRITE beyond the sectors of the file makes it grow, see extend_file().
+ *
+ * Big chunks of a regular file are transferred asynchronously: the request
+ * is parked in fs_req[], FS goes on serving other procs, and the request is
+ * resumed by rdwt_resume() when TASK_HD replies. In that case fs_msg.type is
+ * set to SUSPEND_PROC so that the caller is not replied now.
+ *
+ * Chunks of whole sectors that bypass the cache are not staged at all:
+ * the caller's buffer is granted to the driver, which works on it.
  * 
  * @return How many bytes have been read/written.
  *****************************************************************************/
@@ -78,58 +95,302 @@ PUBLIC int do_rdwt()
 		int pos_end;
 		if (fs_msg.type == READ)
 			pos_end = min(pos + len, pin->i_size);
-		else		/* WRITE */
-			pos_end = min(pos + len, pin->i_nr_sects * SECTOR_SIZE);
+		else {		/* WRITE */
+			int nr_sects = extend_file(pin, (pos + len +
+							 SECTOR_SIZE - 1) >>
+						   SECTOR_SIZE_SHIFT);
+			pos_end = min(pos + len, nr_sects * SECTOR_SIZE);
+		}
+		if (pos_end <= pos)
+			return 0;
+
+		/* a free slot makes the request asynchronous */
+		struct fs_req sync_req;
+		struct fs_req * r;
+		for (r = fs_req; r < &fs_req[NR_FS_REQ]; r++)
+			if (!r->busy)
+				break;
+		if (r < &fs_req[NR_FS_REQ]) {
+			r->busy = 1;
+			r->buf = fsbuf + FSBUF_SIZE / 2 +
+				(r - fs_req) * FS_REQ_SECTS * SECTOR_SIZE;
+		}
+		else {
+			r = &sync_req;
+			r->busy = 0;
+			r->buf = fsbuf;
+		}
+
+		r->msg		= fs_msg;
+		r->caller	= pcaller;
+		r->pin		= pin;
+		r->grant	= -1;
+		r->off		= pos % SECTOR_SIZE;
+		r->fsect	= pos >> SECTOR_SIZE_SHIFT;
+		r->fsect_max	= (pos_end - 1) >> SECTOR_SIZE_SHIFT;
+		r->bytes_rw	= 0;
+		r->bytes_left	= pos_end - pos;
+
+		if (rdwt_run(r)) {
+			fs_msg.type = SUSPEND_PROC;
+			return 0;
+		}
+
+		return rdwt_finish(r);
+	}
+}
 
-		int off = pos % SECTOR_SIZE;
-		int rw_sect_min=pin->i_start_sect+(pos>>SECTOR_SIZE_SHIFT);
-		int rw_sect_max=pin->i_start_sect+(pos_end>>SECTOR_SIZE_SHIFT);
+/*****************************************************************************
+ *                                rdwt_resume
+ *****************************************************************************/
+/**
+ * Carry on with an asynchronous READ/WRITE when TASK_HD has replied. Once
+ * the whole request is done, the caller is replied.
+ * 
+ * @param m  The reply of TASK_HD.
+ *****************************************************************************/
+PUBLIC void rdwt_resume(MESSAGE * m)
+{
+	assert(m->REQ_ID > 0 && m->REQ_ID <= NR_FS_REQ);
 
-		int chunk = min(rw_sect_max - rw_sect_min + 1,
-				FSBUF_SIZE >> SECTOR_SIZE_SHIFT);
+	struct fs_req * r = &fs_req[m->REQ_ID - 1];
+	assert(r->busy);
 
-		int bytes_rw = 0;
-		int bytes_left = len;
+	if (r->grant >= 0) {
+		grant_revoke(r->grant);
+		r->grant = -1;
+	}
+	else if (m->type == DEV_READ && r->msg.type == WRITE) {
+		/* the old content has been read, now write it */
+		rdwt_copy(r);
+		rdwt_submit(r, DEV_WRITE, 0);
+		return;
+	}
+	else if (r->msg.type == READ) {
+		rdwt_copy(r);
+	}
+	rdwt_advance(r);
+
+	if (rdwt_run(r))
+		return;
+
+	MESSAGE reply;
+	reply.type = SYSCALL_RET;
+	reply.CNT = rdwt_finish(r);
+	send_recv(SEND, r->msg.source, &reply);
+}
+
+/*****************************************************************************
+ *                                stash_reply
+ *****************************************************************************/
+/**
+ * Keep a reply of TASK_HD to an asynchronous request that was received
+ * while FS was waiting for a synchronous one, see drv_rw_sector().
+ * 
+ * @param m  The reply.
+ *****************************************************************************/
+PUBLIC void stash_reply(MESSAGE * m)
+{
+	assert(nr_fs_done < NR_FS_REQ);
+	fs_done[nr_fs_done++] = *m;
+}
+
+/*****************************************************************************
+ *                                resume_stashed
+ *****************************************************************************/
+/**
+ * Resume the requests whose replies have been stashed.
+ *****************************************************************************/
+PUBLIC void resume_stashed()
+{
+	while (nr_fs_done) {
+		MESSAGE m = fs_done[0];
 		int i;
-		for (i = rw_sect_min; i <= rw_sect_max; i += chunk) {
-			/* read/write this amount of bytes every time */
-			int bytes = min(bytes_left, chunk * SECTOR_SIZE - off);
-			rw_sector(DEV_READ,
-				  pin->i_dev,
-				  i * SECTOR_SIZE,
-				  chunk * SECTOR_SIZE,
-				  TASK_FS,
-				  fsbuf);
-
-			if (fs_msg.type == READ) {
-				phys_copy((void*)va2la(src, buf + bytes_rw),
-					  (void*)va2la(TASK_FS, fsbuf + off),
-					  bytes);
-			}
-			else {	/* WRITE */
-				phys_copy((void*)va2la(TASK_FS, fsbuf + off),
-					  (void*)va2la(src, buf + bytes_rw),
-					  bytes);
-				rw_sector(DEV_WRITE,
-					  pin->i_dev,
-					  i * SECTOR_SIZE,
-					  chunk * SECTOR_SIZE,
-					  TASK_FS,
-					  fsbuf);
-			}
-			off = 0;
-			bytes_rw += bytes;
-			pcaller->filp[fd]->fd_pos += bytes;
-			bytes_left -= bytes;
+		for (i = 1; i < nr_fs_done; i++)
+			fs_done[i - 1] = fs_done[i];
+		nr_fs_done--;
+		rdwt_resume(&m);
+	}
+}
+
+/*****************************************************************************
+ *                                rdwt_run
+ *****************************************************************************/
+/**
+ * R/W the chunks of a request, until it is done or a chunk has been handed
+ * to TASK_HD asynchronously. Small chunks go through the sector cache, big
+ * ones of whole sectors go to the caller's buffer directly.
+ * 
+ * @param r  The request.
+ * 
+ * @return Nonzero if r is waiting for TASK_HD.
+ *****************************************************************************/
+PRIVATE int rdwt_run(struct fs_req * r)
+{
+	while (r->fsect <= r->fsect_max) {
+		/* a chunk never crosses the end of an extent */
+		int run;
+		r->sect = bmap(r->pin, r->fsect, &run);
+		assert(r->sect);
+		r->nr_sects = min(min(r->fsect_max - r->fsect + 1, run),
+				  FS_REQ_SECTS);
+		/* read/write this amount of bytes every time */
+		r->bytes = min(r->bytes_left,
+			       r->nr_sects * SECTOR_SIZE - r->off);
+
+		if (r->nr_sects > BC_MAX_IO &&
+		    r->off == 0 && r->bytes == r->nr_sects * SECTOR_SIZE) {
+			rdwt_submit(r, r->msg.type == READ ? DEV_READ : DEV_WRITE,
+				    1);
+			if (r->busy)
+				return 1;
+			rdwt_advance(r);
+			continue;
 		}
 
-		if (pcaller->filp[fd]->fd_pos > pin->i_size) {
-			/* update inode::size */
-			pin->i_size = pcaller->filp[fd]->fd_pos;
-			/* write the updated i-node back to disk */
-			sync_inode(pin);
+		if (r->busy && r->nr_sects > BC_MAX_IO) {
+			rdwt_submit(r, DEV_READ, 0);
+			return 1;
 		}
 
-		return bytes_rw;
+		rw_sector(DEV_READ,
+			  r->pin->i_dev,
+			  (u64)r->sect * SECTOR_SIZE,
+			  r->nr_sects * SECTOR_SIZE,
+			  TASK_FS,
+			  r->buf);
+		rdwt_copy(r);
+		if (r->msg.type == WRITE)
+			rw_sector(DEV_WRITE,
+				  r->pin->i_dev,
+				  (u64)r->sect * SECTOR_SIZE,
+				  r->nr_sects * SECTOR_SIZE,
+				  TASK_FS,
+				  r->buf);
+		rdwt_advance(r);
+	}
+
+	return 0;
+}
+
+/*****************************************************************************
+ *                                rdwt_copy
+ *****************************************************************************/
+/**
+ * Copy the bytes of the current chunk between the staging buffer and the
+ * caller.
+ * 
+ * @param r  The request.
+ *****************************************************************************/
+PRIVATE void rdwt_copy(struct fs_req * r)
+{
+	int src = r->msg.source;
+	void * buf = r->msg.BUF;
+
+	if (r->msg.type == READ) {
+		phys_copy((void*)va2la(src, buf + r->bytes_rw),
+			  (void*)va2la(TASK_FS, r->buf + r->off),
+			  r->bytes);
 	}
+	else {	/* WRITE */
+		phys_copy((void*)va2la(TASK_FS, r->buf + r->off),
+			  (void*)va2la(src, buf + r->bytes_rw),
+			  r->bytes);
+	}
+}
+
+/*****************************************************************************
+ *                                rdwt_advance
+ *****************************************************************************/
+/**
+ * The current chunk is done, move on to the next one.
+ * 
+ * @param r  The request.
+ *****************************************************************************/
+PRIVATE void rdwt_advance(struct fs_req * r)
+{
+	r->fsect += r->nr_sects;
+	r->off = 0;
+	r->bytes_rw += r->bytes;
+	r->caller->filp[r->msg.FD]->fd_pos += r->bytes;
+	r->bytes_left -= r->bytes;
+}
+
+/*****************************************************************************
+ *                                rdwt_finish
+ *****************************************************************************/
+/**
+ * Update the i-node after the last chunk and free the request slot.
+ * 
+ * @param r  The request.
+ * 
+ * @return How many bytes have been read/written.
+ *****************************************************************************/
+PRIVATE int rdwt_finish(struct fs_req * r)
+{
+	struct file_desc * f = r->caller->filp[r->msg.FD];
+
+	if (f->fd_pos > r->pin->i_size) {
+		/* update inode::size */
+		r->pin->i_size = f->fd_pos;
+		/* write the updated i-node back to disk */
+		sync_inode(r->pin);
+	}
+
+	r->busy = 0;
+
+	return r->bytes_rw;
+}
+
+/*****************************************************************************
+ *                                rdwt_submit
+ *****************************************************************************/
+/**
+ * Hand the current chunk of a request to TASK_HD, without waiting for it
+ * unless the request is synchronous. The cached copies of the sectors are
+ * written back first (read), or dropped (write).
+ * 
+ * @param r        The request.
+ * @param io_type  DEV_READ or DEV_WRITE.
+ * @param direct   Nonzero to grant the caller's buffer to the driver
+ *                 instead of using the staging buffer.
+ *****************************************************************************/
+PRIVATE void rdwt_submit(struct fs_req * r, int io_type, int direct)
+{
+	MESSAGE driver_msg;
+	int dev = r->pin->i_dev;
+	int driver = dd_map[MAJOR(dev)].driver_nr;
+
+	cache_flush(dev, r->sect, r->nr_sects, io_type == DEV_WRITE);
+
+	driver_msg.type		= io_type;
+	driver_msg.DEVICE	= MINOR(dev);
+	driver_msg.POSITION	= (u64)r->sect * SECTOR_SIZE;
+	driver_msg.BUF		= r->buf;
+	driver_msg.CNT		= r->nr_sects * SECTOR_SIZE;
+	driver_msg.PROC_NR	= TASK_FS;
+	driver_msg.GRANT	= 0;
+	if (direct) {
+		r->grant = grant_create(driver, r->msg.source,
+					r->msg.BUF + r->bytes_rw,
+					driver_msg.CNT,
+					io_type == DEV_READ ?
+					GRANT_WRITE : GRANT_READ);
+		assert(r->grant >= 0);
+		driver_msg.GRANT = (void*)(r->grant + 1);
+	}
+
+	if (!r->busy) {
+		drv_request(dev, &driver_msg);
+		if (direct) {
+			grant_revoke(r->grant);
+			r->grant = -1;
+		}
+		return;
+	}
+
+	driver_msg.REQ_ID	= r - fs_req + 1;
+	assert(driver != INVALID_DRIVER);
+	if (send_recv(ASEND, driver, &driver_msg))
+		send_recv(SEND, driver, &driver_msg);
 }
@@ -50,6 +50,17 @@ struct stat {
 	int st_size;		/* file size */
 };
 
+/**
+ * @struct cache_stat
+ * @brief  Counters of the FS sector cache, returned by cache_stat();
+ */
+struct cache_stat {
+	int nr_bufs;		/* sectors the cache can hold */
+	int hits;		/* sectors read from the cache */
+	int misses;		/* sectors read from the disk */
+	int writebacks;		/* dirty sectors written to the disk */
+};
+
 /**
  * @struct time
  * @brief  RTC time from CMOS.
@@ -147,6 +158,10 @@ PUBLIC int	execv		(const char * path, char * argv[]);
 /* lib/stat.c */
 PUBLIC int	stat		(const char *path, struct stat *buf);
 
+/* lib/sync.c */
+PUBLIC int	sync		();
+PUBLIC int	cache_stat	(struct cache_stat *buf);
+
 /* lib/syslog.c */
 PUBLIC	int	syslog		(const char *fmt, ...);
 
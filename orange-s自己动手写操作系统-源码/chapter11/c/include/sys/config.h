@@ -34,6 +34,12 @@
  */
 #define	MINOR_BOOT			MINOR_hd2c
 
+/*
+ * let the hard disk driver use bus-master DMA if the IDE controller has
+ * it; comment it out to always use PIO (e.g. to compare the two)
+ */
+#define	ENABLE_HD_DMA
+
 /*
  * disk log
  */
@@ -150,6 +150,14 @@
 #define SEND		1
 #define RECEIVE		2
 #define BOTH		3	/* BOTH = (SEND | RECEIVE) */
+#define ASEND		4	/* post to the mailbox, never blocks */
+#define RECV_BATCH	5	/* receive up to `src_dest' messages at once */
+
+#define NR_MAILBOX	8	/* slots in proc::mailbox[] */
+
+#define NR_GRANTS	8	/* slots in proc::grants[] */
+#define GRANT_READ	1	/* the grantee may read the memory */
+#define GRANT_WRITE	2	/* the grantee may write the memory */
 
 /* magic chars used by `printx' */
 #define MAG_CH_PANIC	'\002'
@@ -170,7 +178,7 @@ enum msgtype {
 	GET_TICKS, GET_PID, GET_RTC_TIME,
 
 	/* FS */
-	OPEN, CLOSE, READ, WRITE, LSEEK, STAT, UNLINK,
+	OPEN, CLOSE, READ, WRITE, LSEEK, STAT, UNLINK, SYNC, CACHE_STAT,
 
 	/* FS & TTY */
 	SUSPEND_PROC, RESUME_PROC,
@@ -209,6 +217,8 @@ enum msgtype {
 
 #define	PID		u.m3.m3i2
 #define	RETVAL		u.m3.m3i1
+#define	REQ_ID		u.m3.m3i1	/* FS <-> HD: nonzero if asynchronous */
+#define	GRANT		u.m3.m3p1	/* DEV_READ/WRITE: grant id + 1, or 0 */
 #define	STATUS		u.m3.m3i1
 
 
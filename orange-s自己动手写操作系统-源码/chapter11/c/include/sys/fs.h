@@ -76,8 +76,10 @@ struct inode {
 	u32	i_mode;		/**< Accsess mode */
 	u32	i_size;		/**< File size */
 	u32	i_start_sect;	/**< The first sector of the data */
-	u32	i_nr_sects;	/**< How many sectors the file occupies */
-	u8	_unused[16];	/**< Stuff for alignment */
+	u32	i_nr_sects;	/**< How many sectors the 1st extent has */
+	u32	i_ext_sect;	/**< The sector holding the other extents */
+	u32	i_nr_extents;	/**< How many extents in i_ext_sect */
+	u8	_unused[8];	/**< Stuff for alignment */
 
 	/* the following items are only present in memory */
 	int	i_dev;
@@ -94,6 +96,28 @@ struct inode {
  */
 #define	INODE_SIZE	32
 
+/**
+ * @struct extent
+ * @brief  A run of contiguous sectors of a file. See fs/extent.c.
+ */
+struct extent {
+	u32	e_fsect;	/**< Index in the file of its 1st sector */
+	u32	e_start;	/**< Its 1st sector on the disk */
+	u32	e_nr_sects;	/**< How many sectors */
+};
+
+/**
+ * @def   NR_EXTENTS
+ * @brief Max nr. of extents in i_ext_sect (besides the one in the i-node).
+ */
+#define	NR_EXTENTS	(SECTOR_SIZE / sizeof(struct extent))
+
+/**
+ * @def   EXT_GROW_SECTS
+ * @brief A file grows by a multiple of this amount of sectors.
+ */
+#define	EXT_GROW_SECTS	64
+
 /**
  * @def   MAX_FILENAME_LEN
  * @brief Max len of a filename
@@ -147,5 +171,67 @@ struct file_desc {
 				       TASK_FS,				\
 				       fsbuf);
 
+/**
+ * @def   NR_FS_REQ
+ * @brief How many READ/WRITE requests FS can have waiting for the disk.
+ *
+ * Each one has its own FS_REQ_SECTS sectors in the upper half of fsbuf.
+ * The replies of TASK_HD to them, plus the one to a synchronous request,
+ * must fit in the mailbox of FS (NR_MAILBOX).
+ */
+#define	NR_FS_REQ	4
+#define	FS_REQ_SECTS	128
+
+/**
+ * @struct fs_req
+ * @brief  A READ/WRITE request in progress. See fs/read_write.c.
+ */
+struct fs_req {
+	int		busy;		/**< 0 for a synchronous request */
+	MESSAGE		msg;		/**< The request as received */
+	struct proc *	caller;
+	struct inode *	pin;
+	u8 *		buf;		/**< Staging buffer in fsbuf */
+	int		grant;		/**< Grant of the caller's buffer to
+					     the driver, -1 if none */
+	int		fsect;		/**< Next sector, index in the file */
+	int		fsect_max;	/**< Last sector, index in the file */
+	int		sect;		/**< 1st sector of the current chunk */
+	int		nr_sects;	/**< Sectors in the current chunk */
+	int		off;		/**< Byte offset in the chunk */
+	int		bytes;		/**< Caller's bytes in the chunk */
+	int		bytes_rw;
+	int		bytes_left;
+};
+
+/**
+ * @def   NR_BCACHE
+ * @brief How many sectors the sector cache of FS holds.
+ *
+ * The data lives in bcache_buf[] (see kernel/global.c), which must be
+ * at least NR_BCACHE * SECTOR_SIZE bytes.
+ */
+#define	NR_BCACHE	1024
+
+/**
+ * @def   BC_MAX_IO
+ * @brief R/W requests larger than this (in sectors) bypass the cache.
+ */
+#define	BC_MAX_IO	64
+
+/**
+ * @struct bcache
+ * @brief  A slot of the sector cache. See fs/cache.c.
+ */
+struct bcache {
+	int		dev;	/**< NO_DEV if the slot is empty */
+	int		sect;	/**< Sector nr. in the device */
+	int		dirty;	/**< Modified but not written back yet */
+	u8 *		data;	/**< SECTOR_SIZE bytes in bcache_buf[] */
+	struct bcache *	prev;	/**< LRU list */
+	struct bcache *	next;
+	struct bcache *	hnext;	/**< Hash chain */
+};
+
 	
 #endif /* _ORANGES_FS_H_ */
@@ -52,6 +52,7 @@ EXTERN	struct inode		inode_table[NR_INODE];
 EXTERN	struct super_block	super_block[NR_SUPER_BLOCK];
 extern	u8 *			fsbuf;
 extern	const int		FSBUF_SIZE;
+extern	u8 *			bcache_buf;
 EXTERN	MESSAGE			fs_msg;
 EXTERN	struct proc *		pcaller;
 EXTERN	struct inode *		root_inode;
@@ -226,6 +226,41 @@ struct part_ent {
 
 #define MAX_IO_BYTES	256	/* how many sectors does one IO can handle */
 
+/* PCI configuration space (mechanism #1) */
+#define	PCI_CONFIG_ADDR	0xCF8
+#define	PCI_CONFIG_DATA	0xCFC
+#define	PCI_ADDR(bus,dev,func,reg) (0x80000000 | ((bus) << 16) |	\
+				    ((dev) << 11) | ((func) << 8) | (reg))
+#define	PCI_REG_ID	0x00	/* device id << 16 | vendor id */
+#define	PCI_REG_CMD	0x04	/* status << 16 | command */
+#define	PCI_REG_CLASS	0x08	/* class << 24 | subclass << 16 | prog if << 8 */
+#define	PCI_REG_BAR4	0x20
+#define	PCI_CMD_IO	0x1
+#define	PCI_CMD_MASTER	0x4
+
+/* Bus master IDE registers, offsets from BAR4 (primary channel) */
+#define	BM_CMD		0	/* Command */
+#define	BM_STATUS	2	/* Status */
+#define	BM_PRDT		4	/* Physical Region Descriptor Table address */
+#define	BM_CMD_START	0x01
+#define	BM_CMD_READ	0x08	/* bus master writes the memory */
+#define	BM_ST_ACTIVE	0x01
+#define	BM_ST_ERR	0x02
+#define	BM_ST_IRQ	0x04
+
+/**
+ * @struct prd
+ * @brief  Physical Region Descriptor. A region must not cross a 64K
+ *         boundary, and 0 in count means 64K.
+ */
+struct prd {
+	u32	addr;
+	u16	count;
+	u16	flags;
+};
+#define	PRD_EOT		0x8000	/* the last entry in the table */
+#define	NR_PRD		8
+
 struct hd_cmd {
 	u8	features;
 	u8	count;
@@ -245,6 +280,7 @@ struct part_info {
 struct hd_info
 {
 	int			open_cnt;
+	int			dma;	/* the drive can do DMA */
 	struct part_info	primary[NR_PRIM_PER_DRIVE];
 	struct part_info	logical[NR_SUB_PER_DRIVE];
 };
@@ -258,6 +294,8 @@ struct hd_info
 #define ATA_IDENTIFY		0xEC
 #define ATA_READ		0x20
 #define ATA_WRITE		0x30
+#define ATA_READ_DMA		0xC8
+#define ATA_WRITE_DMA		0xCA
 /* for DEVICE register. */
 #define	MAKE_DEVICE_REG(lba,drv,lba_highest) (((lba) << 6) |		\
 					      ((drv) << 4) |		\
@@ -28,6 +28,18 @@ struct stackframe {	/* proc_ptr points here				↑ Low			*/
 };
 
 
+/**
+ * A memory grant: the grantor lets g_grantee access some memory of a
+ * proc (usually a buffer that proc has passed to the grantor), without
+ * the grantor copying it. See grant_create().
+ */
+struct grant {
+	int	g_access;	/* GRANT_READ | GRANT_WRITE, 0 if free */
+	int	g_grantee;
+	u8 *	g_la;		/* linear address of the memory */
+	int	g_size;
+};
+
 struct proc {
 	struct stackframe regs;    /* process registers saved in stack frame */
 
@@ -62,6 +74,27 @@ struct proc {
 				    * next proc in the sending
 				    * queue (q_sending)
 				    */
+	struct proc * q_sending_tail;/**
+				      * last proc in q_sending, so that
+				      * a sender is appended in O(1)
+				      */
+
+	MESSAGE mailbox[NR_MAILBOX];/**
+				     * ring of messages posted with ASEND,
+				     * oldest at mb_head
+				     */
+	int p_handoff;             /**
+				    * the proc this one has just woken up
+				    * with a message, see block()
+				    */
+
+	int mb_head;
+	int mb_cnt;                /**
+				    * nonzero if there are messages in the
+				    * mailbox (like has_int_msg)
+				    */
+
+	struct grant grants[NR_GRANTS];
 
 	int p_parent; /**< pid of parent process */
 
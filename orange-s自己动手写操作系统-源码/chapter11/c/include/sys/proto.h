@@ -8,6 +8,8 @@
 /* kliba.asm */
 PUBLIC void	out_byte(u16 port, u8 value);
 PUBLIC u8	in_byte(u16 port);
+PUBLIC void	out_dword(u16 port, u32 value);
+PUBLIC u32	in_dword(u16 port);
 PUBLIC void	disp_str(char * info);
 PUBLIC void	disp_color_str(char * info, int color);
 PUBLIC void	disable_irq(int irq);
@@ -75,6 +77,10 @@ PUBLIC void task_sys();
 PUBLIC void			task_fs();
 PUBLIC int			rw_sector(int io_type, int dev, u64 pos,
 					  int bytes, int proc_nr, void * buf);
+PUBLIC int			drv_rw_sector(int io_type, int dev, u64 pos,
+					      int bytes, int proc_nr,
+					      void * buf);
+PUBLIC void			drv_request(int dev, MESSAGE * m);
 PUBLIC struct inode *		get_inode(int dev, int num);
 PUBLIC void			put_inode(struct inode * pinode);
 PUBLIC void			sync_inode(struct inode * p);
@@ -85,8 +91,16 @@ PUBLIC int		do_open();
 PUBLIC int		do_close();
 PUBLIC int		do_lseek();
 
+/* fs/extent.c */
+PUBLIC int		bmap(struct inode * pin, int fsect, int * run);
+PUBLIC int		extend_file(struct inode * pin, int nr_sects);
+PUBLIC void		free_extents(struct inode * pin);
+
 /* fs/read_write.c */
 PUBLIC int		do_rdwt();
+PUBLIC void		rdwt_resume(MESSAGE * m);
+PUBLIC void		stash_reply(MESSAGE * m);
+PUBLIC void		resume_stashed();
 
 /* fs/link.c */
 PUBLIC int		do_unlink();
@@ -97,6 +111,14 @@ PUBLIC int		strip_path(char * filename, const char * pathname,
 				   struct inode** ppinode);
 PUBLIC int		search_file(char * path);
 
+/* fs/cache.c */
+PUBLIC void		init_bcache();
+PUBLIC int		cache_rw(int io_type, int dev, u64 pos, int bytes,
+				 int proc_nr, void * buf);
+PUBLIC int		do_sync();
+PUBLIC int		do_cache_stat();
+PUBLIC void		cache_flush(int dev, int sect, int nr_sects, int drop);
+
 /* fs/disklog.c */
 PUBLIC int		do_disklog();
 PUBLIC int		disklog(char * logstr); /* for debug */
@@ -126,6 +148,10 @@ PUBLIC int  is_current_console(CONSOLE* p_con);
 PUBLIC	void	schedule();
 PUBLIC	void*	va2la(int pid, void* va);
 PUBLIC	int	ldt_seg_linear(struct proc* p, int idx);
+PUBLIC	int	grant_create(int grantee, int pid, void* va, int size,
+			     int access);
+PUBLIC	void	grant_revoke(int gid);
+PUBLIC	void*	grant_la(int grantor, int gid, int off, int size, int access);
 PUBLIC	void	reset_msg(MESSAGE* p);
 PUBLIC	void	dump_msg(const char * title, MESSAGE* m);
 PUBLIC	void	dump_proc(struct proc * p);
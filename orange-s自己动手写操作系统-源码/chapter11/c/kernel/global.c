@@ -75,10 +75,16 @@ struct dev_drv_map dd_map[] = {
 };
 
 /**
- * 6MB~7MB: buffer for FS
+ * 6MB~6.5MB: buffer for FS
  */
 PUBLIC	u8 *		fsbuf		= (u8*)0x600000;
-PUBLIC	const int	FSBUF_SIZE	= 0x100000;
+PUBLIC	const int	FSBUF_SIZE	= 0x80000;
+
+
+/**
+ * 6.5MB~7MB: sector cache of FS (NR_BCACHE sectors)
+ */
+PUBLIC	u8 *		bcache_buf	= (u8*)0x680000;
 
 
 /**
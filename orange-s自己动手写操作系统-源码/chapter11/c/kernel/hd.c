@@ -9,6 +9,7 @@
  *****************************************************************************/
 
 #include "type.h"
+#include "config.h"
 #include "stdio.h"
 #include "const.h"
 #include "protect.h"
@@ -35,11 +36,28 @@ PRIVATE int	waitfor			(int mask, int val, int timeout);
 PRIVATE void	interrupt_wait		();
 PRIVATE	void	hd_identify		(int drive);
 PRIVATE void	print_identify_info	(u16* hdinfo);
+PRIVATE void	hd_dma_probe		();
+PRIVATE int	hd_dma_rdwt		(MESSAGE * p, u8 * la, struct hd_cmd * cmd);
+PRIVATE u32	pci_read		(int bus, int dev, int func, int reg);
+PRIVATE void	pci_write		(int bus, int dev, int func, int reg,
+					 u32 val);
+PRIVATE void	hd_enqueue		(MESSAGE * p);
+PRIVATE u32	hd_abs_sect		(MESSAGE * p);
+PRIVATE int	hd_conflict		(MESSAGE * p, MESSAGE * q);
+PRIVATE void	hd_reply		(MESSAGE * p);
 
 PRIVATE	u8		hd_status;
 PRIVATE	u8		hdbuf[SECTOR_SIZE * 2];
 PRIVATE	struct hd_info	hd_info[1];
 
+/* bus master IDE: I/O base of the primary channel (0 if none), PRD table */
+PRIVATE	u16		hd_bm_base;
+PRIVATE	struct prd	hd_prdt[NR_PRD] __attribute__((aligned(64)));
+
+/* DEV_READ/DEV_WRITE requests received but not yet served */
+PRIVATE	MESSAGE		hd_queue[NR_MAILBOX];
+PRIVATE	int		hd_nr_queued;
+
 #define	DRV_OF_DEV(dev) (dev <= MAX_PRIM ? \
 			 dev / NR_PRIM_PER_DRIVE : \
 			 (dev - MINOR_hd1a) / NR_SUB_PER_DRIVE)
@@ -49,45 +67,154 @@ PRIVATE	struct hd_info	hd_info[1];
  *****************************************************************************/
 /**
  * Main loop of HD driver.
+ *
+ * All the messages pending are fetched at once. R/W requests among them
+ * are queued in (device, position) order and then served back to back,
+ * so that the head sweeps across the disk once per batch.
  * 
  *****************************************************************************/
 PUBLIC void task_hd()
 {
-	MESSAGE msg;
+	MESSAGE msgs[NR_MAILBOX];
+	int i;
 
 	init_hd();
 
 	while (1) {
-		send_recv(RECEIVE, ANY, &msg);
+		int nr_msgs = send_recv(RECV_BATCH, NR_MAILBOX, msgs);
 
-		int src = msg.source;
+		for (i = 0; i < nr_msgs; i++) {
+			MESSAGE * m = &msgs[i];
 
-		switch (msg.type) {
-		case DEV_OPEN:
-			hd_open(msg.DEVICE);
-			break;
+			switch (m->type) {
+			case DEV_OPEN:
+				hd_open(m->DEVICE);
+				break;
 
-		case DEV_CLOSE:
-			hd_close(msg.DEVICE);
-			break;
+			case DEV_CLOSE:
+				hd_close(m->DEVICE);
+				break;
 
-		case DEV_READ:
-		case DEV_WRITE:
-			hd_rdwt(&msg);
-			break;
+			case DEV_READ:
+			case DEV_WRITE:
+				hd_enqueue(m);
+				continue;
 
-		case DEV_IOCTL:
-			hd_ioctl(&msg);
-			break;
+			case DEV_IOCTL:
+				hd_ioctl(m);
+				break;
 
-		default:
-			dump_msg("HD driver::unknown msg", &msg);
-			spin("FS::main_loop (invalid msg.type)");
-			break;
+			default:
+				dump_msg("HD driver::unknown msg", m);
+				spin("FS::main_loop (invalid msg.type)");
+				break;
+			}
+
+			hd_reply(m);
 		}
 
-		send_recv(SEND, src, &msg);
+		for (i = 0; i < hd_nr_queued; i++) {
+			hd_rdwt(&hd_queue[i]);
+			hd_reply(&hd_queue[i]);
+		}
+		hd_nr_queued = 0;
+	}
+}
+
+/*****************************************************************************
+ *                                hd_enqueue
+ *****************************************************************************/
+/**
+ * <Ring 1> Insert a R/W request into hd_queue, sorted by device and then
+ * by position. Requests for the same place keep their arrival order, and
+ * a request never goes ahead of one it conflicts with, see hd_conflict().
+ * 
+ * @param p  Ptr to the MESSAGE.
+ *****************************************************************************/
+PRIVATE void hd_enqueue(MESSAGE * p)
+{
+	int i;
+
+	assert(hd_nr_queued < NR_MAILBOX);
+
+	for (i = hd_nr_queued; i > 0; i--) {
+		MESSAGE * q = &hd_queue[i - 1];
+		if (q->DEVICE < p->DEVICE ||
+		    (q->DEVICE == p->DEVICE && q->POSITION <= p->POSITION))
+			break;
+		if (hd_conflict(p, q))
+			break;
+		hd_queue[i] = *q;
 	}
+	hd_queue[i] = *p;
+	hd_nr_queued++;
+}
+
+/*****************************************************************************
+ *                                hd_abs_sect
+ *****************************************************************************/
+/**
+ * <Ring 1> The sector on the drive where a R/W request begins.
+ * 
+ * @param p  Ptr to the MESSAGE.
+ *
+ * @return The LBA.
+ *****************************************************************************/
+PRIVATE u32 hd_abs_sect(MESSAGE * p)
+{
+	int drive = DRV_OF_DEV(p->DEVICE);
+	int logidx = (p->DEVICE - MINOR_hd1a) % NR_SUB_PER_DRIVE;
+	u32 sect_nr = (u32)(p->POSITION >> SECTOR_SIZE_SHIFT);
+
+	return sect_nr + (p->DEVICE < MAX_PRIM ?
+			  hd_info[drive].primary[p->DEVICE].base :
+			  hd_info[drive].logical[logidx].base);
+}
+
+/*****************************************************************************
+ *                                hd_conflict
+ *****************************************************************************/
+/**
+ * <Ring 1> Two R/W requests conflict if either of them is a write and
+ * their sectors overlap on the drive. Such requests must be served in
+ * the order they came in, or a read may get the data from before a write
+ * it has been sent after (and the other way round). The sectors are
+ * compared on the drive rather than per device, since a logical
+ * partition is also part of its extended partition.
+ * 
+ * @param p  Ptr to one MESSAGE.
+ * @param q  Ptr to the other.
+ *
+ * @return Nonzero if they conflict.
+ *****************************************************************************/
+PRIVATE int hd_conflict(MESSAGE * p, MESSAGE * q)
+{
+	if (p->type == DEV_READ && q->type == DEV_READ)
+		return 0;
+
+	u32 p_start = hd_abs_sect(p);
+	u32 q_start = hd_abs_sect(q);
+	u32 p_end = p_start + (p->CNT + SECTOR_SIZE - 1) / SECTOR_SIZE;
+	u32 q_end = q_start + (q->CNT + SECTOR_SIZE - 1) / SECTOR_SIZE;
+
+	return p_start < q_end && q_start < p_end;
+}
+
+/*****************************************************************************
+ *                                hd_reply
+ *****************************************************************************/
+/**
+ * <Ring 1> Send the request back to its sender, into the sender's mailbox
+ * if there's room.
+ * 
+ * @param p  Ptr to the MESSAGE.
+ *****************************************************************************/
+PRIVATE void hd_reply(MESSAGE * p)
+{
+	int src = p->source;
+
+	if (send_recv(ASEND, src, p))
+		send_recv(SEND, src, p);
 }
 
 /*****************************************************************************
@@ -113,6 +240,10 @@ PRIVATE void init_hd()
 	for (i = 0; i < (sizeof(hd_info) / sizeof(hd_info[0])); i++)
 		memset(&hd_info[i], 0, sizeof(hd_info[0]));
 	hd_info[0].open_cnt = 0;
+
+#ifdef ENABLE_HD_DMA
+	hd_dma_probe();
+#endif
 }
 
 /*****************************************************************************
@@ -160,6 +291,10 @@ PRIVATE void hd_close(int device)
  *****************************************************************************/
 /**
  * <Ring 1> This routine handles DEV_READ and DEV_WRITE message.
+ *
+ * The buffer is either BUF in the space of PROC_NR, or, if GRANT is not 0,
+ * the memory the sender has granted to TASK_HD. Whole sectors go between
+ * the disk and the buffer directly.
  * 
  * @param p Message ptr.
  *****************************************************************************/
@@ -175,11 +310,7 @@ PRIVATE void hd_rdwt(MESSAGE * p)
 	 */
 	assert((pos & 0x1FF) == 0);
 
-	u32 sect_nr = (u32)(pos >> SECTOR_SIZE_SHIFT); /* pos / SECTOR_SIZE */
-	int logidx = (p->DEVICE - MINOR_hd1a) % NR_SUB_PER_DRIVE;
-	sect_nr += p->DEVICE < MAX_PRIM ?
-		hd_info[drive].primary[p->DEVICE].base :
-		hd_info[drive].logical[logidx].base;
+	u32 sect_nr = hd_abs_sect(p);
 
 	struct hd_cmd cmd;
 	cmd.features	= 0;
@@ -188,18 +319,35 @@ PRIVATE void hd_rdwt(MESSAGE * p)
 	cmd.lba_mid	= (sect_nr >>  8) & 0xFF;
 	cmd.lba_high	= (sect_nr >> 16) & 0xFF;
 	cmd.device	= MAKE_DEVICE_REG(1, drive, (sect_nr >> 24) & 0xF);
-	cmd.command	= (p->type == DEV_READ) ? ATA_READ : ATA_WRITE;
-	hd_cmd_out(&cmd);
 
 	int bytes_left = p->CNT;
-	void * la = (void*)va2la(p->PROC_NR, p->BUF);
+	void * la;
+	if (p->GRANT)
+		la = grant_la(p->source, (int)p->GRANT - 1, 0, p->CNT,
+			      p->type == DEV_READ ? GRANT_WRITE : GRANT_READ);
+	else
+		la = (void*)va2la(p->PROC_NR, p->BUF);
+	if (!la)
+		panic("hd: access to the buffer not granted.");
+
+	if (hd_dma_rdwt(p, la, &cmd))
+		return;
+
+	cmd.command	= (p->type == DEV_READ) ? ATA_READ : ATA_WRITE;
+	hd_cmd_out(&cmd);
 
 	while (bytes_left) {
 		int bytes = min(SECTOR_SIZE, bytes_left);
 		if (p->type == DEV_READ) {
 			interrupt_wait();
-			port_read(REG_DATA, hdbuf, SECTOR_SIZE);
-			phys_copy(la, (void*)va2la(TASK_HD, hdbuf), bytes);
+			if (bytes == SECTOR_SIZE) {
+				port_read(REG_DATA, la, SECTOR_SIZE);
+			}
+			else {
+				port_read(REG_DATA, hdbuf, SECTOR_SIZE);
+				phys_copy(la, (void*)va2la(TASK_HD, hdbuf),
+					  bytes);
+			}
 		}
 		else {
 			if (!waitfor(STATUS_DRQ, STATUS_DRQ, HD_TIMEOUT))
@@ -395,6 +543,8 @@ PRIVATE void hd_identify(int drive)
 	hd_info[drive].primary[0].base = 0;
 	/* Total Nr of User Addressable Sectors */
 	hd_info[drive].primary[0].size = ((int)hdinfo[61] << 16) + hdinfo[60];
+	/* Capabilities: DMA supported */
+	hd_info[drive].dma = (hdinfo[49] & 0x0100) != 0;
 }
 
 /*****************************************************************************
@@ -430,6 +580,8 @@ PRIVATE void print_identify_info(u16* hdinfo)
 	int capabilities = hdinfo[49];
 	printl("{HD} LBA supported: %s\n",
 	       (capabilities & 0x0200) ? "Yes" : "No");
+	printl("{HD} DMA supported: %s\n",
+	       (capabilities & 0x0100) ? "Yes" : "No");
 
 	int cmd_set_supported = hdinfo[83];
 	printl("{HD} LBA48 supported: %s\n",
@@ -439,6 +591,133 @@ PRIVATE void print_identify_info(u16* hdinfo)
 	printl("{HD} HD size: %dMB\n", sectors * 512 / 1000000);
 }
 
+/*****************************************************************************
+ *                                hd_dma_probe
+ *****************************************************************************/
+/**
+ * <Ring 1> Look for a bus master IDE controller on PCI bus 0 (such as the
+ * PIIX of QEMU/Bochs) and let it be a bus master.
+ *****************************************************************************/
+PRIVATE void hd_dma_probe()
+{
+	int dev, func;
+
+	for (dev = 0; dev < 32; dev++) {
+		for (func = 0; func < 8; func++) {
+			u32 id = pci_read(0, dev, func, PCI_REG_ID);
+			if ((id & 0xFFFF) == 0xFFFF) /* no such function */
+				continue;
+
+			/* class 1 (mass storage), subclass 1 (IDE), and bit 7
+			 * of prog if: bus master capable */
+			u32 class = pci_read(0, dev, func, PCI_REG_CLASS);
+			if ((class >> 16) != 0x0101 || !(class & 0x8000))
+				continue;
+
+			u32 bar4 = pci_read(0, dev, func, PCI_REG_BAR4);
+			if (!(bar4 & 1))	/* not in I/O space */
+				continue;
+
+			u32 pcmd = pci_read(0, dev, func, PCI_REG_CMD);
+			pci_write(0, dev, func, PCI_REG_CMD,
+				  (pcmd & 0xFFFF) | PCI_CMD_IO | PCI_CMD_MASTER);
+
+			hd_bm_base = bar4 & 0xFFFC;
+			printl("{HD} bus master IDE %x:%x.%x, I/O base 0x%x\n",
+			       0, dev, func, hd_bm_base);
+			return;
+		}
+	}
+
+	printl("{HD} no bus master IDE, PIO only\n");
+}
+
+/*****************************************************************************
+ *                                hd_dma_rdwt
+ *****************************************************************************/
+/**
+ * <Ring 1> R/W by bus master DMA, if the controller and the drive can do
+ * it and the buffer suits. The buffer is described in hd_prdt[], split
+ * at 64K boundaries, and one interrupt tells the whole transfer is done.
+ *
+ * Linear addresses are physical ones, since the memory is mapped 1:1.
+ * 
+ * @param p    The DEV_READ/DEV_WRITE message.
+ * @param la   Linear address of the buffer.
+ * @param cmd  The command, to which the DMA command code is added.
+ * 
+ * @return Zero if it has to be done by PIO.
+ *****************************************************************************/
+PRIVATE int hd_dma_rdwt(MESSAGE * p, u8 * la, struct hd_cmd * cmd)
+{
+	int drive = DRV_OF_DEV(p->DEVICE);
+	int bytes = p->CNT;
+	struct prd * prd = hd_prdt;
+
+	if (!hd_bm_base || !hd_info[drive].dma ||
+	    ((u32)la & 1) || (bytes % SECTOR_SIZE))
+		return 0;
+
+	while (bytes) {
+		if (prd == &hd_prdt[NR_PRD])
+			return 0;
+		int n = min(bytes, 0x10000 - ((u32)la & 0xFFFF));
+		prd->addr = (u32)la;
+		prd->count = n & 0xFFFF;
+		prd->flags = 0;
+		la += n;
+		bytes -= n;
+		prd++;
+	}
+	(prd - 1)->flags = PRD_EOT;
+
+	u8 dir = (p->type == DEV_READ) ? BM_CMD_READ : 0;
+	out_byte(hd_bm_base + BM_CMD, dir);
+	out_dword(hd_bm_base + BM_PRDT, (u32)hd_prdt);
+	/* clear Interrupt and Error (write 1 to clear) */
+	out_byte(hd_bm_base + BM_STATUS,
+		 in_byte(hd_bm_base + BM_STATUS) | BM_ST_IRQ | BM_ST_ERR);
+
+	cmd->command = (p->type == DEV_READ) ? ATA_READ_DMA : ATA_WRITE_DMA;
+	hd_cmd_out(cmd);
+	out_byte(hd_bm_base + BM_CMD, dir | BM_CMD_START);
+
+	interrupt_wait();
+
+	out_byte(hd_bm_base + BM_CMD, dir);	/* stop */
+	u8 status = in_byte(hd_bm_base + BM_STATUS);
+	out_byte(hd_bm_base + BM_STATUS, status | BM_ST_IRQ | BM_ST_ERR);
+
+	if ((status & BM_ST_ERR) || (hd_status & STATUS_ERR))
+		panic("hd DMA error.");
+
+	return 1;
+}
+
+/*****************************************************************************
+ *                                pci_read
+ *****************************************************************************/
+/**
+ * <Ring 1> Read a dword in the configuration space of a PCI function.
+ *****************************************************************************/
+PRIVATE u32 pci_read(int bus, int dev, int func, int reg)
+{
+	out_dword(PCI_CONFIG_ADDR, PCI_ADDR(bus, dev, func, reg));
+	return in_dword(PCI_CONFIG_DATA);
+}
+
+/*****************************************************************************
+ *                                pci_write
+ *****************************************************************************/
+/**
+ * <Ring 1> Write a dword in the configuration space of a PCI function.
+ *****************************************************************************/
+PRIVATE void pci_write(int bus, int dev, int func, int reg, u32 val)
+{
+	out_dword(PCI_CONFIG_ADDR, PCI_ADDR(bus, dev, func, reg));
+	out_dword(PCI_CONFIG_DATA, val);
+}
+
 /*****************************************************************************
  *                                hd_cmd_out
  *****************************************************************************/
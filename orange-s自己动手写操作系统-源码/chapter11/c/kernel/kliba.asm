@@ -18,6 +18,8 @@ global	disp_str
 global	disp_color_str
 global	out_byte
 global	in_byte
+global	out_dword
+global	in_dword
 global	enable_irq
 global	disable_irq
 global	enable_int
@@ -126,6 +128,27 @@ in_byte:
 	nop
 	ret
 
+; ========================================================================
+;		   void out_dword(u16 port, u32 value);
+; ========================================================================
+out_dword:
+	mov	edx, [esp + 4]		; port
+	mov	eax, [esp + 4 + 4]	; value
+	out	dx, eax
+	nop	; 一点延迟
+	nop
+	ret
+
+; ========================================================================
+;		   u32 in_dword(u16 port);
+; ========================================================================
+in_dword:
+	mov	edx, [esp + 4]		; port
+	in	eax, dx
+	nop	; 一点延迟
+	nop
+	ret
+
 ; ========================================================================
 ;                  void port_read(u16 port, void* buf, int n);
 ; ========================================================================
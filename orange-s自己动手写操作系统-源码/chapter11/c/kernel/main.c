@@ -111,6 +111,11 @@ PUBLIC int kernel_main()
 		p->has_int_msg = 0;
 		p->q_sending = 0;
 		p->next_sending = 0;
+		p->q_sending_tail = 0;
+		p->p_handoff = NO_TASK;
+		p->mb_head = 0;
+		p->mb_cnt = 0;
+		memset(p->grants, 0, sizeof(p->grants));
 
 		for (j = 0; j < NR_FILES; j++)
 			p->filp[j] = 0;
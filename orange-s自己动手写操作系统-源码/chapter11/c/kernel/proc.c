@@ -21,7 +21,11 @@ PRIVATE void block(struct proc* p);
 PRIVATE void unblock(struct proc* p);
 PRIVATE int  msg_send(struct proc* current, int dest, MESSAGE* m);
 PRIVATE int  msg_receive(struct proc* current, int src, MESSAGE* m);
+PRIVATE int  msg_asend(struct proc* current, int dest, MESSAGE* m);
+PRIVATE int  msg_receive_batch(struct proc* current, MESSAGE* m, int max);
+PRIVATE int  mb_fetch(struct proc* p, int src, MESSAGE* m);
 PRIVATE int  deadlock(int src, int dest);
+PRIVATE struct proc* handoff_target(struct proc* p);
 
 /*****************************************************************************
  *                                schedule
@@ -58,16 +62,23 @@ PUBLIC void schedule()
 /**
  * <Ring 0> The core routine of system call `sendrec()'.
  * 
- * @param function SEND or RECEIVE
- * @param src_dest To/From whom the message is transferred.
+ * @param function SEND, RECEIVE, ASEND or RECV_BATCH
+ * @param src_dest To/From whom the message is transferred. For RECV_BATCH,
+ *                 how many messages m[] can hold.
  * @param m        Ptr to the MESSAGE body.
  * @param p        The caller proc.
  * 
- * @return Zero if success.
+ * @return Zero if success. For RECV_BATCH, how many messages are received.
  *****************************************************************************/
 PUBLIC int sys_sendrec(int function, int src_dest, MESSAGE* m, struct proc* p)
 {
 	assert(k_reenter == 0);	/* make sure we are not in ring0 */
+
+	if (function == RECV_BATCH) {
+		p->p_handoff = NO_TASK;
+		return msg_receive_batch(p, m, src_dest);
+	}
+
 	assert((src_dest >= 0 && src_dest < NR_TASKS + NR_PROCS) ||
 	       src_dest == ANY ||
 	       src_dest == INTERRUPT);
@@ -91,7 +102,17 @@ PUBLIC int sys_sendrec(int function, int src_dest, MESSAGE* m, struct proc* p)
 			return ret;
 	}
 	else if (function == RECEIVE) {
+		/* only the peer of the SEND half of a BOTH gets the handoff */
+		if (p->p_handoff != src_dest)
+			p->p_handoff = NO_TASK;
 		ret = msg_receive(p, src_dest, m);
+		p->p_handoff = NO_TASK;	/* got it without blocking */
+		if (ret != 0)
+			return ret;
+	}
+	else if (function == ASEND) {
+		ret = msg_asend(p, src_dest, m);
+		p->p_handoff = NO_TASK;	/* no reply to wait for */
 		if (ret != 0)
 			return ret;
 	}
@@ -147,6 +168,85 @@ PUBLIC void* va2la(int pid, void* va)
 	return (void*)la;
 }
 
+/*****************************************************************************
+ *				  grant_create
+ *****************************************************************************/
+/**
+ * <Ring 1> Let another proc access a piece of memory of a proc. The grant
+ * belongs to the caller (the grantor) and is valid until it's revoked.
+ * 
+ * @param grantee  Who may access the memory.
+ * @param pid      Whose memory.
+ * @param va       Virtual address of the memory, in pid's space.
+ * @param size     Size of the memory.
+ * @param access   GRANT_READ and/or GRANT_WRITE.
+ * 
+ * @return  The grant id, or -1 if the caller has no free grant slot.
+ *****************************************************************************/
+PUBLIC int grant_create(int grantee, int pid, void* va, int size, int access)
+{
+	struct grant * g = p_proc_ready->grants;
+	int i;
+
+	assert(access && size >= 0);
+
+	for (i = 0; i < NR_GRANTS; i++, g++) {
+		if (!g->g_access) {
+			g->g_grantee = grantee;
+			g->g_la = (u8*)va2la(pid, va);
+			g->g_size = size;
+			g->g_access = access;
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/*****************************************************************************
+ *				  grant_revoke
+ *****************************************************************************/
+/**
+ * <Ring 1> Revoke a grant made by the caller.
+ * 
+ * @param gid  The grant id.
+ *****************************************************************************/
+PUBLIC void grant_revoke(int gid)
+{
+	assert(gid >= 0 && gid < NR_GRANTS);
+	p_proc_ready->grants[gid].g_access = 0;
+}
+
+/*****************************************************************************
+ *				  grant_la
+ *****************************************************************************/
+/**
+ * <Ring 1> Check a grant made to the caller and get the linear address of
+ * a part of the granted memory.
+ * 
+ * @param grantor  Who made the grant.
+ * @param gid      The grant id.
+ * @param off      Offset in the granted memory.
+ * @param size     How many bytes are to be accessed.
+ * @param access   GRANT_READ and/or GRANT_WRITE.
+ * 
+ * @return  The linear address, or 0 if the access is not granted.
+ *****************************************************************************/
+PUBLIC void* grant_la(int grantor, int gid, int off, int size, int access)
+{
+	if (gid < 0 || gid >= NR_GRANTS)
+		return 0;
+
+	struct grant * g = &proc_table[grantor].grants[gid];
+
+	if ((g->g_access & access) != access ||
+	    g->g_grantee != proc2pid(p_proc_ready) ||
+	    off < 0 || size < 0 || off + size > g->g_size)
+		return 0;
+
+	return g->g_la + off;
+}
+
 /*****************************************************************************
  *                                reset_msg
  *****************************************************************************/
@@ -165,7 +265,13 @@ PUBLIC void reset_msg(MESSAGE* p)
  *****************************************************************************/
 /**
  * <Ring 0> This routine is called after `p_flags' has been set (!= 0), it
- * calls `schedule()' to choose another proc as the `proc_ready'.
+ * chooses another proc as the `proc_ready'.
+ *
+ * If p is blocked on a proc that can run (the server it has just sent a
+ * request to, or the client it has just replied to), that proc is run
+ * directly instead of calling `schedule()', and p's remaining ticks are
+ * given to it, up to its own `priority'. If the proc p waits for is itself blocked on another one
+ * (FS -> HD), the ticks go down the chain to the one that can run.
  *
  * @attention This routine does not change `p_flags'. Make sure the `p_flags'
  * of the proc to be blocked has been set properly.
@@ -175,7 +281,60 @@ PUBLIC void reset_msg(MESSAGE* p)
 PRIVATE void block(struct proc* p)
 {
 	assert(p->p_flags);
-	schedule();
+
+	struct proc* q = handoff_target(p);
+	if (q) {
+		q->ticks += p->ticks;
+		if (q->ticks > q->priority)
+			q->ticks = q->priority;
+		p->ticks = 0;
+		p_proc_ready = q;
+	}
+	else {
+		schedule();
+	}
+}
+
+/*****************************************************************************
+ *                                handoff_target
+ *****************************************************************************/
+/**
+ * <Ring 0> Find the proc p is waiting for, following the chain of
+ * blocked senders/receivers until a runnable one is found.
+ * 
+ * @param p The proc being blocked.
+ * 
+ * @return The runnable proc, or 0 if there's none.
+ *****************************************************************************/
+PRIVATE struct proc* handoff_target(struct proc* p)
+{
+	int next = p->p_handoff;
+	int i;
+
+	p->p_handoff = NO_TASK;
+
+	if (p->p_flags & SENDING)
+		next = p->p_sendto;
+	else if (p->p_recvfrom != ANY && p->p_recvfrom != INTERRUPT)
+		next = p->p_recvfrom;
+
+	for (i = 0; i < NR_TASKS + NR_PROCS; i++) {
+		if (next < 0 || next >= NR_TASKS + NR_PROCS)
+			break;
+
+		struct proc* q = proc_table + next;
+		if (q->p_flags == 0)
+			return q;
+		if (q->p_flags & SENDING)
+			next = q->p_sendto;
+		else if ((q->p_flags & RECEIVING) &&
+			 q->p_recvfrom != ANY && q->p_recvfrom != INTERRUPT)
+			next = q->p_recvfrom;
+		else
+			break;
+	}
+
+	return 0;
 }
 
 /*****************************************************************************
@@ -273,6 +432,7 @@ PRIVATE int msg_send(struct proc* current, int dest, MESSAGE* m)
 		p_dest->p_flags &= ~RECEIVING; /* dest has received the msg */
 		p_dest->p_recvfrom = NO_TASK;
 		unblock(p_dest);
+		sender->p_handoff = dest;
 
 		assert(p_dest->p_flags == 0);
 		assert(p_dest->p_msg == 0);
@@ -290,16 +450,11 @@ PRIVATE int msg_send(struct proc* current, int dest, MESSAGE* m)
 		sender->p_msg = m;
 
 		/* append to the sending queue */
-		struct proc * p;
-		if (p_dest->q_sending) {
-			p = p_dest->q_sending;
-			while (p->next_sending)
-				p = p->next_sending;
-			p->next_sending = sender;
-		}
-		else {
+		if (p_dest->q_sending)
+			p_dest->q_sending_tail->next_sending = sender;
+		else
 			p_dest->q_sending = sender;
-		}
+		p_dest->q_sending_tail = sender;
 		sender->next_sending = 0;
 
 		block(sender);
@@ -367,6 +522,16 @@ PRIVATE int msg_receive(struct proc* current, int src, MESSAGE* m)
 	}
 
 
+	/* Messages posted to the mailbox come before the blocked senders. */
+	if (p_who_wanna_recv->mb_cnt &&
+	    mb_fetch(p_who_wanna_recv, src, m) == 0) {
+		assert(p_who_wanna_recv->p_flags == 0);
+		assert(p_who_wanna_recv->p_msg == 0);
+		assert(p_who_wanna_recv->p_sendto == NO_TASK);
+
+		return 0;
+	}
+
 	/* Arrives here if no interrupt for p_who_wanna_recv. */
 	if (src == ANY) {
 		/* p_who_wanna_recv is ready to receive messages from
@@ -443,6 +608,8 @@ PRIVATE int msg_receive(struct proc* current, int src, MESSAGE* m)
 			prev->next_sending = p_from->next_sending;
 			p_from->next_sending = 0;
 		}
+		if (p_from == p_who_wanna_recv->q_sending_tail)
+			p_who_wanna_recv->q_sending_tail = prev;
 
 		assert(m);
 		assert(p_from->p_msg);
@@ -481,6 +648,129 @@ PRIVATE int msg_receive(struct proc* current, int src, MESSAGE* m)
 	return 0;
 }
 
+/*****************************************************************************
+ *                                msg_asend
+ *****************************************************************************/
+/**
+ * <Ring 0> Send a message without blocking. If dest is waiting for the
+ * message it is delivered at once, like msg_send() does. Otherwise it is
+ * put into dest's mailbox, to be picked up by dest's next receive.
+ * 
+ * @param current  The caller, the sender.
+ * @param dest     To whom the message is sent.
+ * @param m        The message.
+ * 
+ * @return Zero if success, nonzero if the mailbox of dest is full.
+ *****************************************************************************/
+PRIVATE int msg_asend(struct proc* current, int dest, MESSAGE* m)
+{
+	struct proc* sender = current;
+	struct proc* p_dest = proc_table + dest; /* proc dest */
+
+	assert(proc2pid(sender) != dest);
+	assert(m);
+
+	if ((p_dest->p_flags & RECEIVING) && /* dest is waiting for the msg */
+	    (p_dest->p_recvfrom == proc2pid(sender) ||
+	     p_dest->p_recvfrom == ANY)) {
+		assert(p_dest->p_msg);
+
+		phys_copy(va2la(dest, p_dest->p_msg),
+			  va2la(proc2pid(sender), m),
+			  sizeof(MESSAGE));
+		p_dest->p_msg = 0;
+		p_dest->p_flags &= ~RECEIVING; /* dest has received the msg */
+		p_dest->p_recvfrom = NO_TASK;
+		unblock(p_dest);
+
+		return 0;
+	}
+
+	if (p_dest->mb_cnt == NR_MAILBOX)
+		return 1;
+
+	/* enqueue at the tail of the ring */
+	phys_copy(&p_dest->mailbox[(p_dest->mb_head + p_dest->mb_cnt) %
+				   NR_MAILBOX],
+		  va2la(proc2pid(sender), m),
+		  sizeof(MESSAGE));
+	p_dest->mb_cnt++;
+
+	return 0;
+}
+
+/*****************************************************************************
+ *                                mb_fetch
+ *****************************************************************************/
+/**
+ * <Ring 0> Take the oldest message from src out of p's mailbox.
+ * 
+ * @param p    Whose mailbox.
+ * @param src  From whom, or ANY.
+ * @param m    Where the message goes (virtual address in p).
+ * 
+ * @return Zero if a message has been fetched.
+ *****************************************************************************/
+PRIVATE int mb_fetch(struct proc* p, int src, MESSAGE* m)
+{
+	int i, j;
+
+	for (i = 0; i < p->mb_cnt; i++) {
+		MESSAGE* msg = &p->mailbox[(p->mb_head + i) % NR_MAILBOX];
+		if (src == ANY || msg->source == src)
+			break;
+	}
+	if (i == p->mb_cnt)
+		return 1;
+
+	phys_copy(va2la(proc2pid(p), m),
+		  &p->mailbox[(p->mb_head + i) % NR_MAILBOX],
+		  sizeof(MESSAGE));
+
+	/* close the gap, the ring is short */
+	for (j = i; j > 0; j--)
+		p->mailbox[(p->mb_head + j) % NR_MAILBOX] =
+			p->mailbox[(p->mb_head + j - 1) % NR_MAILBOX];
+	p->mb_head = (p->mb_head + 1) % NR_MAILBOX;
+	p->mb_cnt--;
+
+	return 0;
+}
+
+/*****************************************************************************
+ *                                msg_receive_batch
+ *****************************************************************************/
+/**
+ * <Ring 0> Receive up to max messages from ANY in one call: the pending
+ * interrupt, the mailbox and the blocked senders are drained in that
+ * order. If nothing is pending, the caller is blocked until the first
+ * message arrives, and that one message is all it gets.
+ * 
+ * @param current  The caller, the proc who wanna receive.
+ * @param m        Array of max MESSAGEs.
+ * @param max      How many messages m[] can hold.
+ * 
+ * @return  How many messages have been received.
+ *****************************************************************************/
+PRIVATE int msg_receive_batch(struct proc* current, MESSAGE* m, int max)
+{
+	int n = 0;
+
+	assert(max > 0);
+
+	if (!current->has_int_msg && !current->mb_cnt && !current->q_sending) {
+		msg_receive(current, ANY, m);
+		return 1;
+	}
+
+	while (n < max &&
+	       (current->has_int_msg || current->mb_cnt || current->q_sending))
+		msg_receive(current, ANY, m + n++);
+	current->p_handoff = NO_TASK;
+
+	return n;
+}
+
 /*****************************************************************************
  *                                inform_int
  *****************************************************************************/
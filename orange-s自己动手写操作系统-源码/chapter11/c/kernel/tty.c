@@ -279,7 +279,9 @@ PRIVATE void tty_dev_write(TTY* tty)
 				msg.type = RESUME_PROC;
 				msg.PROC_NR = tty->tty_procnr;
 				msg.CNT = tty->tty_trans_cnt;
-				send_recv(SEND, tty->tty_caller, &msg);
+				/* don't wait for a busy FS */
+				if (send_recv(ASEND, tty->tty_caller, &msg))
+					send_recv(SEND, tty->tty_caller, &msg);
 				tty->tty_left_cnt = 0;
 			}
 		}
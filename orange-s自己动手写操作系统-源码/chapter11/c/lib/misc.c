@@ -29,11 +29,13 @@
  * It is an encapsulation of `sendrec',
  * invoking `sendrec' directly should be avoided
  *
- * @param function  SEND, RECEIVE or BOTH
- * @param src_dest  The caller's proc_nr
+ * @param function  SEND, RECEIVE, BOTH, ASEND or RECV_BATCH
+ * @param src_dest  The caller's proc_nr (RECV_BATCH: how many messages
+ *                  msg[] can hold)
  * @param msg       Pointer to the MESSAGE struct
  * 
- * @return always 0.
+ * @return 0, except: ASEND returns nonzero if dest's mailbox is full,
+ *         RECV_BATCH returns how many messages have been received.
  *****************************************************************************/
 PUBLIC int send_recv(int function, int src_dest, MESSAGE* msg)
 {
@@ -50,11 +52,14 @@ PUBLIC int send_recv(int function, int src_dest, MESSAGE* msg)
 		break;
 	case SEND:
 	case RECEIVE:
+	case ASEND:
+	case RECV_BATCH:
 		ret = sendrec(function, src_dest, msg);
 		break;
 	default:
 		assert((function == BOTH) ||
-		       (function == SEND) || (function == RECEIVE));
+		       (function == SEND) || (function == RECEIVE) ||
+		       (function == ASEND) || (function == RECV_BATCH));
 		break;
 	}
 
@@ -0,0 +1,62 @@
+/*************************************************************************//**
+ *****************************************************************************
+ * @file   sync.c
+ * @brief  sync(), cache_stat()
+ * @author Forrest Y. Yu
+ * @date   2008
+ *****************************************************************************
+ *****************************************************************************/
+
+#include "type.h"
+#include "stdio.h"
+#include "const.h"
+#include "protect.h"
+#include "string.h"
+#include "fs.h"
+#include "proc.h"
+#include "tty.h"
+#include "console.h"
+#include "global.h"
+#include "proto.h"
+
+
+/*****************************************************************************
+ *                                sync
+ *****************************************************************************/
+/**
+ * Write the sectors cached by FS back to the disk.
+ * 
+ * @return Zero if successful.
+ *****************************************************************************/
+PUBLIC int sync()
+{
+	MESSAGE msg;
+	msg.type	= SYNC;
+
+	send_recv(BOTH, TASK_FS, &msg);
+	assert(msg.type == SYSCALL_RET);
+
+	return msg.RETVAL;
+}
+
+/*****************************************************************************
+ *                                cache_stat
+ *****************************************************************************/
+/**
+ * Get the counters of the FS sector cache.
+ * 
+ * @param buf  Where the counters are copied to.
+ * 
+ * @return Zero if successful.
+ *****************************************************************************/
+PUBLIC int cache_stat(struct cache_stat *buf)
+{
+	MESSAGE msg;
+	msg.type	= CACHE_STAT;
+	msg.BUF		= (void*)buf;
+
+	send_recv(BOTH, TASK_FS, &msg);
+	assert(msg.type == SYSCALL_RET);
+
+	return msg.RETVAL;
+}
@@ -53,6 +53,10 @@ PUBLIC int do_fork()
 	*p = proc_table[pid];
 	p->ldt_sel = child_ldt_sel;
 	p->p_parent = pid;
+	p->q_sending = p->next_sending = p->q_sending_tail = 0;
+	p->mb_head = p->mb_cnt = 0;
+	p->p_handoff = NO_TASK;
+	memset(p->grants, 0, sizeof(p->grants));
 	sprintf(p->name, "%s_%d", proc_table[pid].name, child_pid);
 
 	/* duplicate the process: T, D & S */
@@ -24,10 +24,27 @@
 #define reg_alt_status(channel)  (channel->port_base + 0x206)
 #define reg_ctl(channel)	 reg_alt_status(channel)
 
+/* 总线主控寄存器的端口号 */
+#define bm_cmd(channel)		 (channel->bm_base + 0)
+#define bm_status(channel)	 (channel->bm_base + 2)
+#define bm_prdt(channel)	 (channel->bm_base + 4)
+
+/* 总线主控寄存器的一些关键位 */
+#define BIT_BM_START	 0x1	      // 开始传输
+#define BIT_BM_READ	 0x8	      // 方向:由硬盘到内存
+#define BIT_BM_ERR	 0x2	      // 传输出错
+#define BIT_BM_INTR	 0x4	      // 硬盘已发出中断
+#define PRD_EOT		 0x8000	      // prd表的最后一项
+
+/* PCI配置空间的端口号,按双字访问 */
+#define PCI_CONFIG_ADDR	 0xcf8
+#define PCI_CONFIG_DATA	 0xcfc
+
 /* reg_status寄存器的一些关键位 */
 #define BIT_STAT_BSY	 0x80	      // 硬盘忙
 #define BIT_STAT_DRDY	 0x40	      // 驱动器准备好	 
 #define BIT_STAT_DRQ	 0x8	      // 数据传输准备好了
+#define BIT_STAT_ERR	 0x1	      // 上一条命令出错
 
 /* device寄存器的一些关键位 */
 #define BIT_DEV_MBS	0xa0	    // 第7位和第5位固定为1
@@ -38,6 +55,11 @@
 #define CMD_IDENTIFY	   0xec	    // identify指令
 #define CMD_READ_SECTOR	   0x20     // 读扇区指令
 #define CMD_WRITE_SECTOR   0x30	    // 写扇区指令
+#define CMD_READ_DMA	   0xc8     // DMA读扇区指令
+#define CMD_WRITE_DMA	   0xca     // DMA写扇区指令
+
+/* 为1时,若ide控制器支持总线主控,便用DMA读写硬盘;为0时一律用PIO,可用来对比两者 */
+#define IDE_USE_DMA 1
 
 /* 定义可读写的最大扇区数,调试用的 */
 #define max_lba ((80*1024*1024/512) - 1)	// 只支持80MB硬盘
@@ -146,91 +168,229 @@ static bool busy_wait(struct disk* hd) {
    return false;
 }
 
-/* 从硬盘读取sec_cnt个扇区到buf */
-void ide_read(struct disk* hd, uint32_t lba, void* buf, uint32_t sec_cnt) {   // 此处的sec_cnt为32位大小
-   ASSERT(lba <= max_lba);
-   ASSERT(sec_cnt > 0);
-   lock_acquire (&hd->my_channel->lock);
+/* 在中断处理程序中不能睡眠,只能轮询等硬盘准备好数据,
+ * 读备用状态寄存器不会应答中断 */
+static bool drq_spin(struct ide_channel* channel) {
+   uint32_t spin = 1000000;
+   while (spin-- > 0) {
+      uint8_t status = inb(reg_alt_status(channel));
+      if (!(status & BIT_STAT_BSY)) {
+	 return (status & BIT_STAT_DRQ);
+      }
+   }
+   return false;
+}
 
-/* 1 先选择操作的硬盘 */
-   select_disk(hd);
+/* PIO方式在硬盘和当前请求间传送1个扇区 */
+static void pio_xfer_sector(struct ide_channel* channel) {
+   struct ide_request* req = channel->xfer_req;
+   void* buf = (void*)((uint32_t)req->buf + channel->xfer_off * 512);
+   if (req->is_read) {
+      read_from_sector(req->hd, buf, 1);
+   } else {
+      write2sector(req->hd, buf, 1);
+   }
+   if (++channel->xfer_off == req->sec_cnt) {
+      channel->xfer_req = req->merge_next;
+      channel->xfer_off = 0;
+   }
+}
 
-   uint32_t secs_op;		 // 每次操作的扇区数
-   uint32_t secs_done = 0;	 // 已完成的扇区数
-   while(secs_done < sec_cnt) {
-      if ((secs_done + 256) <= sec_cnt) {
-	 secs_op = 256;
-      } else {
-	 secs_op = sec_cnt - secs_done;
+/* 用合并在一起的请求填写prd表,按页把各请求的buf拆成物理内存块,
+ * 页是4K对齐的,所以每块都不会跨64K边界 */
+static void dma_setup(struct ide_channel* channel, struct ide_request* req) {
+   struct prd* prd = channel->prdt;
+   while (req != NULL) {
+      uint32_t vaddr = (uint32_t)req->buf;
+      uint32_t bytes_left = req->sec_cnt * 512;
+      while (bytes_left > 0) {
+	 uint32_t size = PG_SIZE - (vaddr & (PG_SIZE - 1));
+	 if (size > bytes_left) {
+	    size = bytes_left;
+	 }
+	 prd->phy_addr = addr_v2p(vaddr);
+	 prd->byte_cnt = size;
+	 prd->flags = 0;
+	 prd++;
+	 vaddr += size;
+	 bytes_left -= size;
       }
+      req = req->merge_next;
+   }
+   (prd - 1)->flags = PRD_EOT;
+}
 
-   /* 2 写入待读入的扇区数和起始扇区号 */
-      select_sector(hd, lba + secs_done, secs_op);
+/* 从请求队列取出下一条命令发给硬盘,队列为空时通道转为空闲.
+ * 在关中断的情况下调用,发起者或中断处理程序都可能调用它 */
+static void ide_start(struct ide_channel* channel) {
+   if (list_empty(&channel->req_queue)) {
+      channel->cur_req = NULL;
+      return;
+   }
+   struct ide_request* req = elem2entry(struct ide_request, tag, list_pop(&channel->req_queue));
+   struct disk* hd = req->hd;
+
+   /* 统计合并后的扇区数,有buf不是偶地址的就不能用DMA */
+   uint32_t secs = 0;
+   bool dma = channel->bm_base != 0 && hd->dma;
+   struct ide_request* r = req;
+   while (r != NULL) {
+      secs += r->sec_cnt;
+      if ((uint32_t)r->buf & 1) {
+	 dma = false;
+      }
+      r = r->merge_next;
+   }
+   ASSERT(secs <= 256);
 
-   /* 3 执行的命令写入reg_cmd寄存器 */
-      cmd_out(hd->my_channel, CMD_READ_SECTOR);	      // 准备开始读数据
+   channel->cur_req = req;
+   channel->cmd_secs = secs;
+   channel->secs_done = 0;
+   channel->cmd_dma = dma;
+   channel->xfer_req = req;
+   channel->xfer_off = 0;
+   channel->head_lba = req->lba + secs;
 
-   /*********************   阻塞自己的时机  ***********************
-      在硬盘已经开始工作(开始在内部读数据或写数据)后才能阻塞自己,现在硬盘已经开始忙了,
-      将自己阻塞,等待硬盘完成读操作后通过中断处理程序唤醒自己*/
-      sema_down(&hd->my_channel->disk_done);
-   /*************************************************************/
+   select_disk(hd);
+   if (dma) {
+      /* 设置prd表地址和传输方向,清除上次的中断和出错位(写1清0),发命令后启动总线主控 */
+      dma_setup(channel, req);
+      uint8_t dir = req->is_read ? BIT_BM_READ : 0;
+      outb(bm_cmd(channel), dir);
+      outl(bm_prdt(channel), addr_v2p((uint32_t)channel->prdt));
+      outb(bm_status(channel), inb(bm_status(channel)) | BIT_BM_INTR | BIT_BM_ERR);
+      select_sector(hd, req->lba, secs);
+      cmd_out(channel, req->is_read ? CMD_READ_DMA : CMD_WRITE_DMA);
+      outb(bm_cmd(channel), dir | BIT_BM_START);
+      return;
+   }
 
-   /* 4 检测硬盘状态是否可读 */
-      /* 醒来后开始执行下面代码*/
-      if (!busy_wait(hd)) {			      // 若失败
+   select_sector(hd, req->lba, secs);
+   cmd_out(channel, req->is_read ? CMD_READ_SECTOR : CMD_WRITE_SECTOR);
+   /* 写命令要先送出第1个扇区,硬盘写完后才会发中断 */
+   if (!req->is_read) {
+      if (!drq_spin(channel)) {
 	 char error[64];
-	 sprintf(error, "%s read sector %d failed!!!!!!\n", hd->name, lba);
+	 sprintf(error, "%s write sector %d failed!!!!!!\n", hd->name, req->lba);
 	 PANIC(error);
       }
+      pio_xfer_sector(channel);
+   }
+}
 
-   /* 5 把数据从硬盘的缓冲区中读出 */
-      read_from_sector(hd, (void*)((uint32_t)buf + secs_done * 512), secs_op);
-      secs_done += secs_op;
+/* 返回合并在q上的所有请求的扇区数,last返回其中最后一个请求 */
+static uint32_t chain_secs(struct ide_request* q, struct ide_request** last) {
+   uint32_t secs = q->sec_cnt;
+   while (q->merge_next != NULL) {
+      q = q->merge_next;
+      secs += q->sec_cnt;
    }
-   lock_release(&hd->my_channel->lock);
+   *last = q;
+   return secs;
 }
 
-/* 将buf中sec_cnt扇区数据写入硬盘 */
-void ide_write(struct disk* hd, uint32_t lba, void* buf, uint32_t sec_cnt) {
+/* 队列中的q(连同合并在它上面的请求)与req是否冲突:
+ * 同一块硬盘,扇区有重叠,且至少一方是写.冲突的请求必须按先来后到的顺序执行,
+ * 否则读到的可能是写之前的数据,或者后写的被先写的覆盖 */
+static bool ide_conflict(struct ide_request* q, struct ide_request* req) {
+   if (q->hd != req->hd || (q->is_read && req->is_read)) {
+      return false;
+   }
+   struct ide_request* last;
+   uint32_t secs = chain_secs(q, &last);
+   return q->lba < req->lba + req->sec_cnt && req->lba < q->lba + secs;
+}
+
+/* 把请求req放入通道的请求队列.
+ * 队列中最后一个与req冲突的请求是界限,req只能排在它后面.
+ * 界限之后能接在某个同方向且扇区相邻的请求后面就合成一条命令,
+ * 否则在界限之后按电梯(C-LOOK)顺序插入:先是head_lba及以上的请求按lba升序,
+ * 再是head_lba以下的,等磁头扫到最高处后再从低处开始 */
+static void ide_enqueue(struct ide_channel* channel, struct ide_request* req) {
+   struct list_elem* first = channel->req_queue.head.next;
+   struct list_elem* elem = first;
+   struct ide_request* q;
+   while (elem != &channel->req_queue.tail) {
+      q = elem2entry(struct ide_request, tag, elem);
+      elem = elem->next;
+      if (ide_conflict(q, req)) {
+	 first = elem;
+      }
+   }
+
+   elem = first;
+   while (elem != &channel->req_queue.tail) {
+      q = elem2entry(struct ide_request, tag, elem);
+      if (q->hd == req->hd && q->is_read == req->is_read) {
+	 struct ide_request* last;
+	 uint32_t secs = chain_secs(q, &last);
+	 if (last->lba + last->sec_cnt == req->lba && secs + req->sec_cnt <= 256) {
+	    last->merge_next = req;
+	    return;
+	 }
+      }
+      elem = elem->next;
+   }
+
+   bool req_ahead = req->lba >= channel->head_lba;
+   elem = first;
+   while (elem != &channel->req_queue.tail) {
+      q = elem2entry(struct ide_request, tag, elem);
+      bool q_ahead = q->lba >= channel->head_lba;
+      if (req_ahead ? (!q_ahead || q->lba > req->lba) : (!q_ahead && q->lba > req->lba)) {
+	 break;
+      }
+      elem = elem->next;
+   }
+   list_insert_before(elem, &req->tag);
+}
+
+/* 读写硬盘:每256个扇区做成一个请求放入请求队列,
+ * 通道空闲时就地发出,否则由中断处理程序在前面的命令完成后发出,
+ * 发起者阻塞到请求完成 */
+static void ide_rw(struct disk* hd, uint32_t lba, void* buf, uint32_t sec_cnt, bool is_read) {
    ASSERT(lba <= max_lba);
    ASSERT(sec_cnt > 0);
-   lock_acquire (&hd->my_channel->lock);
-
-/* 1 先选择操作的硬盘 */
-   select_disk(hd);
+   ASSERT((uint32_t)buf >= 0xc0000000);
+   struct ide_channel* channel = hd->my_channel;
+   struct ide_request req;
 
    uint32_t secs_op;		 // 每次操作的扇区数
    uint32_t secs_done = 0;	 // 已完成的扇区数
-   while(secs_done < sec_cnt) {
+   while (secs_done < sec_cnt) {
       if ((secs_done + 256) <= sec_cnt) {
 	 secs_op = 256;
       } else {
 	 secs_op = sec_cnt - secs_done;
       }
-
-   /* 2 写入待写入的扇区数和起始扇区号 */
-      select_sector(hd, lba + secs_done, secs_op);		      // 先将待读的块号lba地址和待读入的扇区数写入lba寄存器
-
-   /* 3 执行的命令写入reg_cmd寄存器 */
-      cmd_out(hd->my_channel, CMD_WRITE_SECTOR);	      // 准备开始写数据
-
-   /* 4 检测硬盘状态是否可读 */
-      if (!busy_wait(hd)) {			      // 若失败
-	 char error[64];
-	 sprintf(error, "%s write sector %d failed!!!!!!\n", hd->name, lba);
-	 PANIC(error);
+      req.hd = hd;
+      req.lba = lba + secs_done;
+      req.sec_cnt = secs_op;
+      req.buf = (void*)((uint32_t)buf + secs_done * 512);
+      req.is_read = is_read;
+      req.merge_next = NULL;
+      sema_init(&req.done, 0);
+
+      enum intr_status old_status = intr_disable();
+      ide_enqueue(channel, &req);
+      if (channel->cur_req == NULL) {
+	 ide_start(channel);
       }
+      intr_set_status(old_status);
 
-   /* 5 将数据写入硬盘 */
-      write2sector(hd, (void*)((uint32_t)buf + secs_done * 512), secs_op);
-
-      /* 在硬盘响应期间阻塞自己 */
-      sema_down(&hd->my_channel->disk_done);
+      sema_down(&req.done);
       secs_done += secs_op;
    }
-   /* 醒来后开始释放锁*/
-   lock_release(&hd->my_channel->lock);
+}
+
+/* 从硬盘读取sec_cnt个扇区到buf */
+void ide_read(struct disk* hd, uint32_t lba, void* buf, uint32_t sec_cnt) {   // 此处的sec_cnt为32位大小
+   ide_rw(hd, lba, buf, sec_cnt, true);
+}
+
+/* 将buf中sec_cnt扇区数据写入硬盘 */
+void ide_write(struct disk* hd, uint32_t lba, void* buf, uint32_t sec_cnt) {
+   ide_rw(hd, lba, buf, sec_cnt, false);
 }
 
 /* 将dst中len个相邻字节交换位置后存入buf */
@@ -271,6 +431,8 @@ static void identify_disk(struct disk* hd) {
    uint32_t sectors = *(uint32_t*)&id_info[60 * 2];
    printk("      SECTORS: %d\n", sectors);
    printk("      CAPACITY: %dMB\n", sectors * 512 / 1024 / 1024);
+   hd->dma = (*(uint16_t*)&id_info[49 * 2] & 0x100) != 0;	 // 第49字的第8位表示支持DMA
+   printk("      DMA: %s\n", hd->dma ? "yes" : "no");
 }
 
 /* 扫描硬盘hd中地址为ext_lba的扇区中的所有分区 */
@@ -326,22 +488,110 @@ static bool partition_info(struct list_elem* pelem, int arg UNUSED) {
    return false;
 }
 
-/* 硬盘中断处理程序 */
+/* 硬盘中断处理程序.当前命令完成后唤醒其中所有请求的发起者,
+ * 并就地发出队列中的下一条命令,不必等发起者被调度 */
 void intr_hd_handler(uint8_t irq_no) {
    ASSERT(irq_no == 0x2e || irq_no == 0x2f);
    uint8_t ch_no = irq_no - 0x2e;
    struct ide_channel* channel = &channels[ch_no];
    ASSERT(channel->irq_no == irq_no);
-/* 不必担心此中断是否对应的是这一次的expecting_intr,
- * 每次读写硬盘时会申请锁,从而保证了同步一致性 */
-   if (channel->expecting_intr) {
-      channel->expecting_intr = false;
-      sema_up(&channel->disk_done);
+
+   struct ide_request* req = channel->cur_req;
+   if (req == NULL) {
+   /* 不经请求队列的命令(如identify)由发命令的线程自己处理 */
+      if (channel->expecting_intr) {
+	 channel->expecting_intr = false;
+	 sema_up(&channel->disk_done);
 
 /* 读取状态寄存器使硬盘控制器认为此次的中断已被处理,
  * 从而硬盘可以继续执行新的读写 */
-      inb(reg_status(channel));
+	 inb(reg_status(channel));
+      }
+      return;
+   }
+
+   uint8_t status = inb(reg_status(channel));	 // 同时应答了中断
+   if (channel->cmd_dma) {
+      /* 停止总线主控,检查是否出错 */
+      outb(bm_cmd(channel), req->is_read ? BIT_BM_READ : 0);
+      uint8_t bm_stat = inb(bm_status(channel));
+      outb(bm_status(channel), bm_stat | BIT_BM_INTR | BIT_BM_ERR);
+      if (bm_stat & BIT_BM_ERR) {
+	 char error[64];
+	 sprintf(error, "%s dma %s sector %d failed!!!!!!\n", req->hd->name, req->is_read ? "read" : "write", req->lba);
+	 PANIC(error);
+      }
+   } else {
+      /* PIO每传送1个扇区硬盘发1次中断 */
+      if (status & BIT_STAT_ERR) {
+	 char error[64];
+	 sprintf(error, "%s %s sector %d failed!!!!!!\n", req->hd->name, req->is_read ? "read" : "write", req->lba);
+	 PANIC(error);
+      }
+      if (req->is_read) {
+	 pio_xfer_sector(channel);
+      }
+      if (++channel->secs_done < channel->cmd_secs) {
+	 if (!req->is_read) {
+	    if (!drq_spin(channel)) {
+	       char error[64];
+	       sprintf(error, "%s write sector %d failed!!!!!!\n", req->hd->name, req->lba);
+	       PANIC(error);
+	    }
+	    pio_xfer_sector(channel);
+	 }
+	 return;
+      }
+   }
+
+   /* 命令完成 */
+   channel->expecting_intr = false;
+   while (req != NULL) {
+      struct ide_request* next = req->merge_next;
+      sema_up(&req->done);
+      req = next;
    }
+   ide_start(channel);
+}
+
+/* 读PCI配置空间中bus总线上dev设备func功能的reg寄存器 */
+static uint32_t pci_read(uint8_t bus, uint8_t dev, uint8_t func, uint8_t reg) {
+   outl(PCI_CONFIG_ADDR, 0x80000000 | bus << 16 | dev << 11 | func << 8 | reg);
+   return inl(PCI_CONFIG_DATA);
+}
+
+/* 写PCI配置空间中bus总线上dev设备func功能的reg寄存器 */
+static void pci_write(uint8_t bus, uint8_t dev, uint8_t func, uint8_t reg, uint32_t val) {
+   outl(PCI_CONFIG_ADDR, 0x80000000 | bus << 16 | dev << 11 | func << 8 | reg);
+   outl(PCI_CONFIG_DATA, val);
+}
+
+/* 在0号总线上找支持总线主控的ide控制器(如qemu/bochs的PIIX),
+ * 返回其总线主控寄存器的起始端口号,没找到则返回0 */
+static uint16_t bus_master_probe(void) {
+   uint8_t dev, func;
+   for (dev = 0; dev < 32; dev++) {
+      for (func = 0; func < 8; func++) {
+	 if ((pci_read(0, dev, func, 0) & 0xffff) == 0xffff) {	 // 无此设备
+	    continue;
+	 }
+	 /* 类别1(大容量存储),子类别1(ide),编程接口第7位为1表示支持总线主控 */
+	 uint32_t class = pci_read(0, dev, func, 0x8);
+	 if ((class >> 16) != 0x0101 || !(class & 0x8000)) {
+	    continue;
+	 }
+	 uint32_t bar4 = pci_read(0, dev, func, 0x20);
+	 if (!(bar4 & 1)) {	 // 须在i/o空间
+	    continue;
+	 }
+	 /* 在命令寄存器中打开i/o访问和总线主控 */
+	 uint32_t cmd = pci_read(0, dev, func, 0x4);
+	 pci_write(0, dev, func, 0x4, (cmd & 0xffff) | 0x1 | 0x4);
+	 printk("   bus master ide %d:%d.%d, port 0x%x\n", 0, dev, func, bar4 & 0xfffc);
+	 return bar4 & 0xfffc;
+      }
+   }
+   return 0;
 }
 
 /* 硬盘数据结构初始化 */
@@ -352,6 +602,7 @@ void ide_init() {
    list_init(&partition_list);
    channel_cnt = DIV_ROUND_UP(hd_cnt, 2);	   // 一个ide通道上有两个硬盘,根据硬盘数量反推有几个ide通道
    struct ide_channel* channel;
+   uint16_t bm_base = IDE_USE_DMA ? bus_master_probe() : 0;
    uint8_t channel_no = 0, dev_no = 0; 
 
    /* 处理每个通道上的硬盘 */
@@ -372,7 +623,18 @@ void ide_init() {
       }
 
       channel->expecting_intr = false;		   // 未向硬盘写入指令时不期待硬盘的中断
-      lock_init(&channel->lock);		     
+      list_init(&channel->req_queue);
+      channel->cur_req = NULL;
+      channel->head_lba = 0;
+
+      /* 两个通道的总线主控寄存器各占8个端口 */
+      channel->bm_base = 0;
+      if (bm_base != 0) {
+	 channel->prdt = get_kernel_pages(1);
+	 if (channel->prdt != NULL) {
+	    channel->bm_base = bm_base + channel_no * 8;
+	 }
+      }
 
    /* 初始化为0,目的是向硬盘控制器请求数据后,硬盘驱动sema_down此信号量会阻塞线程,
    直到硬盘完成后通过发中断,由中断处理程序将此信号量sema_up,唤醒线程. */
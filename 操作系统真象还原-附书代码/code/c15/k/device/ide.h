@@ -18,11 +18,33 @@ struct partition {
    struct list open_inodes;	 // 本分区打开的i结点队列
 };
 
+/* PRD(Physical Region Descriptor),描述DMA要读写的一块物理内存,
+ * 一块内存不能跨64K边界,byte_cnt为0表示64K */
+struct prd {
+   uint32_t phy_addr;		 // 物理地址
+   uint16_t byte_cnt;		 // 字节数
+   uint16_t flags;		 // 最高位为1表示是prd表的最后一项
+} __attribute__ ((packed));
+
+/* 硬盘读写请求.挂在通道的请求队列上,由中断处理程序依次向硬盘发出,
+ * 与前一个请求扇区相邻的请求接在它的merge_next上,合成一条命令 */
+struct ide_request {
+   struct disk* hd;
+   uint32_t lba;		 // 起始扇区
+   uint32_t sec_cnt;		 // 扇区数,不超过256
+   void* buf;			 // 须在内核空间,发命令时的页表未必是发起者的
+   bool is_read;
+   struct ide_request* merge_next;	 // 合并在同一条命令中的下一个请求
+   struct list_elem tag;	 // 用于通道的请求队列
+   struct semaphore done;	 // 请求完成后由中断处理程序唤醒发起者
+};
+
 /* 硬盘结构 */
 struct disk {
    char name[8];			   // 本硬盘的名称，如sda等
    struct ide_channel* my_channel;	   // 此块硬盘归属于哪个ide通道
    uint8_t dev_no;			   // 本硬盘是主0还是从1
+   bool dma;				   // 硬盘是否支持DMA
    struct partition prim_parts[4];	   // 主分区顶多是4个
    struct partition logic_parts[8];	   // 逻辑分区数量无限,但总得有个支持的上限,那就支持8个
 };
@@ -32,10 +54,20 @@ struct ide_channel {
    char name[8];		 // 本ata通道名称, 如ata0,也被叫做ide0. 可以参考bochs配置文件中关于硬盘的配置。
    uint16_t port_base;		 // 本通道的起始端口号
    uint8_t irq_no;		 // 本通道所用的中断号
-   struct lock lock;
    bool expecting_intr;		 // 向硬盘发完命令后等待来自硬盘的中断
    struct semaphore disk_done;	 // 硬盘处理完成.线程用这个信号量来阻塞自己，由硬盘完成后产生的中断将线程唤醒
    struct disk devices[2];	 // 一个通道上连接两个硬盘，一主一从
+   uint16_t bm_base;		 // 本通道总线主控(bus master)寄存器的起始端口号,为0表示不支持DMA
+   struct prd* prdt;		 // 本通道的prd表,占一页
+
+   struct list req_queue;	 // 尚未发出的请求,按电梯顺序排列
+   struct ide_request* cur_req;	 // 正在执行的命令的第1个请求,为NULL表示通道空闲
+   uint32_t cmd_secs;		 // 当前命令的扇区数
+   uint32_t secs_done;		 // 当前命令已完成的扇区数
+   bool cmd_dma;		 // 当前命令是否用DMA
+   struct ide_request* xfer_req; // PIO时下一个要传送的扇区所在的请求
+   uint32_t xfer_off;		 // 及其在该请求内的扇区序号
+   uint32_t head_lba;		 // 上一条命令结束处的扇区,电梯从这里往高处扫
 };
 
 void intr_hd_handler(uint8_t irq_no);
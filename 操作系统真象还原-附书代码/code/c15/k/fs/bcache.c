@@ -0,0 +1,325 @@
+#include "bcache.h"
+#include "stdint.h"
+#include "fs.h"
+#include "global.h"
+#include "debug.h"
+#include "interrupt.h"
+#include "memory.h"
+#include "string.h"
+#include "sync.h"
+#include "thread.h"
+#include "timer.h"
+#include "list.h"
+#include "stdio-kernel.h"
+
+/* 文件系统的扇区缓存.inode,位图,目录和文件数据都经此读写,
+ * 写操作只写到缓存里,块被换出或刷新线程定期刷新时才写回硬盘.
+ * bcache_lock只保护缓存的数据结构,读写硬盘前释放,
+ * 所以多个线程的请求能同时在硬盘的请求队列中排序合并 */
+static struct bcache_buf* bcache_bufs;			 // 所有缓存块
+static struct list bcache_hash[BCACHE_HASH_SIZE];	 // 按(hd,lba)散列
+static struct list bcache_lru;				 // 队首最近使用,队尾最久未用
+static struct lock bcache_lock;
+static uint8_t* bcache_io_bufs[BCACHE_IO_BUFS];	 // 合并读写时拼接连续的扇区
+static bool bcache_io_used[BCACHE_IO_BUFS];
+static struct semaphore bcache_io_free;			 // 空闲的中转缓冲区数
+
+#define BCACHE_HASH(hd, lba) ((((uint32_t)(hd) >> 4) ^ (lba)) % BCACHE_HASH_SIZE)
+
+/* 在缓存中找硬盘hd的lba扇区,找不到返回NULL */
+static struct bcache_buf* bcache_lookup(struct disk* hd, uint32_t lba) {
+   struct list* bucket = &bcache_hash[BCACHE_HASH(hd, lba)];
+   struct list_elem* elem = bucket->head.next;
+   while (elem != &bucket->tail) {
+      struct bcache_buf* b = elem2entry(struct bcache_buf, hash_tag, elem);
+      if (b->hd == hd && b->lba == lba) {
+	 return b;
+      }
+      elem = elem->next;
+   }
+   return NULL;
+}
+
+/* 将b移到lru队首 */
+static void bcache_touch(struct bcache_buf* b) {
+   list_remove(&b->lru_tag);
+   list_push(&bcache_lru, &b->lru_tag);
+}
+
+/* 持有bcache_lock时将b置为busy */
+static void bcache_busy(struct bcache_buf* b) {
+   b->busy = true;
+   lock_acquire(&b->io_lock);
+}
+
+/* 持有bcache_lock时清除b的busy,唤醒等待的线程 */
+static void bcache_unbusy(struct bcache_buf* b) {
+   b->busy = false;
+   lock_release(&b->io_lock);
+}
+
+/* 等b的读写完成.进入和返回时都持有bcache_lock,期间b可能已被换出,主调函数要重新查找 */
+static void bcache_wait(struct bcache_buf* b) {
+   lock_release(&bcache_lock);
+   lock_acquire(&b->io_lock);
+   lock_release(&b->io_lock);
+   lock_acquire(&bcache_lock);
+}
+
+/* 取一个中转缓冲区,没有空闲的就阻塞.不能持有bcache_lock */
+static uint8_t* bcache_io_get(void) {
+   sema_down(&bcache_io_free);
+   enum intr_status old_status = intr_disable();
+   uint32_t idx = 0;
+   while (bcache_io_used[idx]) {
+      idx++;
+   }
+   ASSERT(idx < BCACHE_IO_BUFS);
+   bcache_io_used[idx] = true;
+   intr_set_status(old_status);
+   return bcache_io_bufs[idx];
+}
+
+/* 归还中转缓冲区io_buf */
+static void bcache_io_put(uint8_t* io_buf) {
+   enum intr_status old_status = intr_disable();
+   uint32_t idx = 0;
+   while (bcache_io_bufs[idx] != io_buf) {
+      idx++;
+   }
+   bcache_io_used[idx] = false;
+   intr_set_status(old_status);
+   sema_up(&bcache_io_free);
+}
+
+/* 把脏块写回硬盘,前后相邻的脏块一起写,合成一次ide_write.
+ * 写的过程中这些块是busy的,bcache_lock会暂时释放 */
+static void bcache_writeback(struct bcache_buf* b) {
+   ASSERT(b->dirty && !b->busy);
+   struct bcache_buf* run[BCACHE_RUN_SECS];
+   uint32_t start_lba = b->lba, sec_cnt = 1;
+   struct bcache_buf* nb;
+   while (sec_cnt < BCACHE_RUN_SECS && start_lba > 0 && \
+	  (nb = bcache_lookup(b->hd, start_lba - 1)) != NULL && nb->dirty && !nb->busy) {
+      start_lba--;
+      sec_cnt++;
+   }
+   while (sec_cnt < BCACHE_RUN_SECS && \
+	  (nb = bcache_lookup(b->hd, start_lba + sec_cnt)) != NULL && nb->dirty && !nb->busy) {
+      sec_cnt++;
+   }
+
+   uint32_t sec_idx = 0;
+   while (sec_idx < sec_cnt) {
+      run[sec_idx] = bcache_lookup(b->hd, start_lba + sec_idx);
+      run[sec_idx]->dirty = false;
+      bcache_busy(run[sec_idx]);
+      sec_idx++;
+   }
+   lock_release(&bcache_lock);
+
+   if (sec_cnt == 1) {
+      ide_write(b->hd, b->lba, b->data, 1);
+   } else {
+      uint8_t* io_buf = bcache_io_get();
+      for (sec_idx = 0; sec_idx < sec_cnt; sec_idx++) {
+	 memcpy(io_buf + sec_idx * SECTOR_SIZE, run[sec_idx]->data, SECTOR_SIZE);
+      }
+      ide_write(b->hd, start_lba, io_buf, sec_cnt);
+      bcache_io_put(io_buf);
+   }
+
+   lock_acquire(&bcache_lock);
+   for (sec_idx = 0; sec_idx < sec_cnt; sec_idx++) {
+      bcache_unbusy(run[sec_idx]);
+   }
+}
+
+/* 换出最久未用且不忙的块给硬盘hd的lba扇区用,返回的块valid为false,数据由主调函数填写.
+ * 换出脏块要先写回,期间会释放bcache_lock,若别的线程趁机缓存了lba扇区就返回NULL */
+static struct bcache_buf* bcache_get(struct disk* hd, uint32_t lba) {
+   while (1) {
+      if (bcache_lookup(hd, lba) != NULL) {
+	 return NULL;
+      }
+      struct list_elem* elem = bcache_lru.tail.prev;
+      struct bcache_buf* b = NULL;
+      while (elem != &bcache_lru.head) {
+	 b = elem2entry(struct bcache_buf, lru_tag, elem);
+	 if (!b->busy) {
+	    break;
+	 }
+	 elem = elem->prev;
+      }
+      if (elem == &bcache_lru.head) {	 // 全都在读写硬盘,等一会儿
+	 lock_release(&bcache_lock);
+	 thread_yield();
+	 lock_acquire(&bcache_lock);
+	 continue;
+      }
+      if (b->dirty) {
+	 bcache_writeback(b);
+	 continue;
+      }
+
+      if (b->hd != NULL) {
+	 list_remove(&b->hash_tag);
+      }
+      b->hd = hd;
+      b->lba = lba;
+      b->valid = false;
+      list_push(&bcache_hash[BCACHE_HASH(hd, lba)], &b->hash_tag);
+      return b;
+   }
+}
+
+/* 从硬盘读取hd的lba起最多BCACHE_RUN_SECS个未缓存的扇区到缓存.
+ * 调用时lba未缓存,持有bcache_lock,读硬盘时释放 */
+static void bcache_fill(struct disk* hd, uint32_t lba, uint32_t sec_cnt) {
+   struct bcache_buf* run[BCACHE_RUN_SECS];
+   uint32_t miss_cnt = 0;
+   while (miss_cnt < sec_cnt && miss_cnt < BCACHE_RUN_SECS) {
+      struct bcache_buf* b = bcache_get(hd, lba + miss_cnt);
+      if (b == NULL) {
+	 break;
+      }
+      bcache_busy(b);
+      run[miss_cnt++] = b;
+   }
+   if (miss_cnt == 0) {
+      return;
+   }
+   lock_release(&bcache_lock);
+
+   uint32_t sec_idx;
+   if (miss_cnt == 1) {
+      ide_read(hd, lba, run[0]->data, 1);
+   } else {
+      uint8_t* io_buf = bcache_io_get();
+      ide_read(hd, lba, io_buf, miss_cnt);
+      for (sec_idx = 0; sec_idx < miss_cnt; sec_idx++) {
+	 memcpy(run[sec_idx]->data, io_buf + sec_idx * SECTOR_SIZE, SECTOR_SIZE);
+      }
+      bcache_io_put(io_buf);
+   }
+
+   lock_acquire(&bcache_lock);
+   for (sec_idx = 0; sec_idx < miss_cnt; sec_idx++) {
+      run[sec_idx]->valid = true;
+      bcache_unbusy(run[sec_idx]);
+   }
+}
+
+/* 经缓存从硬盘读取sec_cnt个扇区到buf,
+ * 连续未命中的扇区合成一次ide_read,经中转缓冲区读到缓存中,再复制到buf.
+ * 硬盘驱动要求buf在内核空间,而buf可能是用户进程的堆 */
+void bcache_read(struct disk* hd, uint32_t lba, void* buf, uint32_t sec_cnt) {
+   lock_acquire(&bcache_lock);
+   uint32_t sec_idx = 0;
+   while (sec_idx < sec_cnt) {
+      struct bcache_buf* b = bcache_lookup(hd, lba + sec_idx);
+      if (b == NULL) {
+	 bcache_fill(hd, lba + sec_idx, sec_cnt - sec_idx);
+	 continue;
+      }
+      if (b->busy) {
+	 bcache_wait(b);
+	 continue;
+      }
+      ASSERT(b->valid);
+      memcpy((uint8_t*)buf + sec_idx * SECTOR_SIZE, b->data, SECTOR_SIZE);
+      bcache_touch(b);
+      sec_idx++;
+   }
+   lock_release(&bcache_lock);
+}
+
+/* 经缓存将buf中sec_cnt个扇区写入硬盘,只标记为脏,延迟写回 */
+void bcache_write(struct disk* hd, uint32_t lba, void* buf, uint32_t sec_cnt) {
+   lock_acquire(&bcache_lock);
+   uint32_t sec_idx = 0;
+   while (sec_idx < sec_cnt) {
+      struct bcache_buf* b = bcache_lookup(hd, lba + sec_idx);
+      if (b == NULL) {
+	 b = bcache_get(hd, lba + sec_idx);   // 整扇区覆盖,不必先读
+	 if (b == NULL) {
+	    continue;
+	 }
+      } else if (b->busy) {
+	 bcache_wait(b);
+	 continue;
+      }
+      memcpy(b->data, (uint8_t*)buf + sec_idx * SECTOR_SIZE, SECTOR_SIZE);
+      b->valid = true;
+      b->dirty = true;
+      bcache_touch(b);
+      sec_idx++;
+   }
+   lock_release(&bcache_lock);
+}
+
+/* 把所有脏块写回硬盘 */
+void bcache_sync(void) {
+   lock_acquire(&bcache_lock);
+   uint32_t buf_idx = 0;
+   while (buf_idx < BCACHE_BLOCKS) {
+      struct bcache_buf* b = &bcache_bufs[buf_idx];
+      if (b->busy) {
+	 bcache_wait(b);
+	 continue;
+      }
+      if (b->dirty) {
+	 bcache_writeback(b);
+      }
+      buf_idx++;
+   }
+   lock_release(&bcache_lock);
+}
+
+/* 刷新线程,定期写回脏块 */
+static void bcache_flush_thread(void* arg UNUSED) {
+   while (1) {
+      mtime_sleep(BCACHE_FLUSH_MS);
+      bcache_sync();
+   }
+}
+
+/* 初始化扇区缓存并启动刷新线程 */
+void bcache_init(void) {
+   bcache_bufs = (struct bcache_buf*)sys_malloc(sizeof(struct bcache_buf) * BCACHE_BLOCKS);
+   uint8_t* data = (uint8_t*)get_kernel_pages(BCACHE_BLOCKS * SECTOR_SIZE / PG_SIZE);
+   if (bcache_bufs == NULL || data == NULL) {
+      PANIC("bcache_init: alloc memory failed");
+   }
+   uint32_t idx = 0;
+   while (idx < BCACHE_IO_BUFS) {
+      bcache_io_bufs[idx] = (uint8_t*)get_kernel_pages(BCACHE_RUN_SECS * SECTOR_SIZE / PG_SIZE);
+      if (bcache_io_bufs[idx] == NULL) {
+	 PANIC("bcache_init: alloc memory failed");
+      }
+      bcache_io_used[idx] = false;
+      idx++;
+   }
+   sema_init(&bcache_io_free, BCACHE_IO_BUFS);
+
+   lock_init(&bcache_lock);
+   list_init(&bcache_lru);
+   idx = 0;
+   while (idx < BCACHE_HASH_SIZE) {
+      list_init(&bcache_hash[idx]);
+      idx++;
+   }
+   idx = 0;
+   while (idx < BCACHE_BLOCKS) {
+      bcache_bufs[idx].hd = NULL;
+      bcache_bufs[idx].lba = 0;
+      bcache_bufs[idx].valid = false;
+      bcache_bufs[idx].dirty = false;
+      bcache_bufs[idx].busy = false;
+      lock_init(&bcache_bufs[idx].io_lock);
+      bcache_bufs[idx].data = data + idx * SECTOR_SIZE;
+      list_append(&bcache_lru, &bcache_bufs[idx].lru_tag);
+      idx++;
+   }
+   thread_start("bcache_flush", 10, bcache_flush_thread, NULL);
+}
@@ -0,0 +1,31 @@
+#ifndef __FS_BCACHE_H
+#define __FS_BCACHE_H
+#include "stdint.h"
+#include "ide.h"
+
+#define BCACHE_BLOCKS	    256	 // 缓存的扇区数,共128K
+#define BCACHE_HASH_SIZE    64	 // 散列桶数
+#define BCACHE_FLUSH_MS	    3000 // 刷新线程每隔这么多毫秒把脏块写回硬盘
+#define BCACHE_RUN_SECS	    16	 // 一次读写硬盘最多合并的连续扇区数
+#define BCACHE_IO_BUFS	    4	 // 合并读写用的中转缓冲区个数
+
+/* 缓存块,缓存硬盘hd上lba处的1个扇区.
+ * 读写硬盘时不持有缓存的锁,正在读写的块置busy,
+ * 其他线程要用这个块就等在io_lock上,等到后重新查找 */
+struct bcache_buf {
+   struct disk* hd;		 // 为NULL表示空闲
+   uint32_t lba;
+   bool valid;			 // data中是该扇区的数据
+   bool dirty;			 // 数据比硬盘上的新,换出或刷新时须写回
+   bool busy;			 // 正在读写硬盘,不能访问data,也不能换出
+   struct lock io_lock;		 // busy期间由读写硬盘的线程持有
+   struct list_elem hash_tag;	 // 用于散列桶
+   struct list_elem lru_tag;	 // 用于lru队列,队首为最近使用的
+   uint8_t* data;		 // 扇区数据
+};
+
+void bcache_init(void);
+void bcache_read(struct disk* hd, uint32_t lba, void* buf, uint32_t sec_cnt);
+void bcache_write(struct disk* hd, uint32_t lba, void* buf, uint32_t sec_cnt);
+void bcache_sync(void);
+#endif
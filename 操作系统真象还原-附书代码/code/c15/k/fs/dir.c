@@ -10,13 +10,137 @@
 #include "string.h"
 #include "interrupt.h"
 #include "super_block.h"
+#include "bcache.h"
 
 struct dir root_dir;             // 根目录
 
+/* 目录项缓存,以(分区,目录inode编号,文件名)直接映射到槽,
+ * 命中时search_dir_entry不用读盘 */
+struct dir_cache_entry {
+   struct partition* part;	 // 为NULL表示空槽
+   uint32_t dir_ino;		 // 所在目录的inode编号
+   struct dir_entry de;
+};
+static struct dir_cache_entry dir_cache[DIR_CACHE_SIZE];
+
+/* 比较目录项中的文件名filename与name,filename最长MAX_FILE_NAME_LEN且未必以0结尾 */
+static bool dir_name_equal(const char* filename, const char* name) {
+   uint32_t idx = 0;
+   while (idx < MAX_FILE_NAME_LEN) {
+      if (filename[idx] != name[idx]) {
+	 return false;
+      }
+      if (filename[idx] == 0) {
+	 return true;
+      }
+      idx++;
+   }
+   return name[idx] == 0;
+}
+
+/* 文件名的散列值(FNV-1a) */
+static uint32_t dir_name_hash(const char* name) {
+   uint32_t hash = 2166136261u, idx = 0;
+   while (idx < MAX_FILE_NAME_LEN && name[idx] != 0) {
+      hash = (hash ^ (uint8_t)name[idx]) * 16777619;
+      idx++;
+   }
+   return hash;
+}
+
+/* 返回名为name的目录项的家块,.和..固定在第0块 */
+static uint32_t dir_home_block(const char* name) {
+   if (dir_name_equal(name, ".") || dir_name_equal(name, "..")) {
+      return 0;
+   }
+   return dir_name_hash(name) % DIR_BLOCK_CNT;
+}
+
+/* 返回目录dir_ino中名为name的目录项在缓存中的槽 */
+static struct dir_cache_entry* dir_cache_slot(uint32_t dir_ino, const char* name) {
+   return &dir_cache[(dir_name_hash(name) + dir_ino) % DIR_CACHE_SIZE];
+}
+
+/* 目录项被删除后使其缓存失效 */
+static void dir_cache_invalidate(struct partition* part, uint32_t dir_ino, const char* name) {
+   struct dir_cache_entry* dce = dir_cache_slot(dir_ino, name);
+   if (dce->part == part && dce->dir_ino == dir_ino && dir_name_equal(dce->de.filename, name)) {
+      dce->part = NULL;
+   }
+}
+
+/* 将一级间接块表读入all_blocks[12~],没有间接块表时清0 */
+static void dir_read_indirect(struct partition* part, struct inode* dir_inode, uint32_t* all_blocks) {
+   if (dir_inode->i_sectors[12] != 0) {
+      bcache_read(part->my_disk, dir_inode->i_sectors[12], all_blocks + 12, 1);
+   } else {
+      memset(all_blocks + 12, 0, 128 * 4);
+   }
+}
+
+/* 为目录分配第block_idx块,必要时先分配一级间接块表.成功返回块地址,失败返回-1 */
+static int32_t dir_block_alloc(struct partition* part, struct inode* dir_inode, uint32_t* all_blocks, uint32_t block_idx) {
+   int32_t table_lba = -1, block_lba;
+   if (block_idx >= 12 && dir_inode->i_sectors[12] == 0) {
+      table_lba = block_bitmap_alloc(part);
+      if (table_lba == -1) {
+	 return -1;
+      }
+      bitmap_sync(part, table_lba - part->sb->data_start_lba, BLOCK_BITMAP);
+      dir_inode->i_sectors[12] = table_lba;
+   }
+
+   block_lba = block_bitmap_alloc(part);
+   if (block_lba == -1) {
+      if (table_lba != -1) {	 // 回滚刚分配的间接块表
+	 bitmap_set(&part->block_bitmap, table_lba - part->sb->data_start_lba, 0);
+	 bitmap_sync(part, table_lba - part->sb->data_start_lba, BLOCK_BITMAP);
+	 dir_inode->i_sectors[12] = 0;
+      }
+      return -1;
+   }
+   bitmap_sync(part, block_lba - part->sb->data_start_lba, BLOCK_BITMAP);
+
+   all_blocks[block_idx] = block_lba;
+   if (block_idx < 12) {
+      dir_inode->i_sectors[block_idx] = block_lba;
+   } else {
+      bcache_write(part->my_disk, dir_inode->i_sectors[12], all_blocks + 12, 1);
+   }
+   return block_lba;
+}
+
+/* 回收目录的第block_idx块,间接块都回收后连同一级间接块表一起回收 */
+static void dir_block_free(struct partition* part, struct inode* dir_inode, uint32_t* all_blocks, uint32_t block_idx) {
+   uint32_t block_bitmap_idx = all_blocks[block_idx] - part->sb->data_start_lba;
+   bitmap_set(&part->block_bitmap, block_bitmap_idx, 0);
+   bitmap_sync(part, block_bitmap_idx, BLOCK_BITMAP);
+   all_blocks[block_idx] = 0;
+
+   if (block_idx < 12) {
+      dir_inode->i_sectors[block_idx] = 0;
+      return;
+   }
+
+   uint32_t indirect_block_idx = 12;
+   while (indirect_block_idx < DIR_BLOCK_CNT && all_blocks[indirect_block_idx] == 0) {
+      indirect_block_idx++;
+   }
+   if (indirect_block_idx < DIR_BLOCK_CNT) {	 // 还有其它间接块,仅在索引表中擦除当前块
+      bcache_write(part->my_disk, dir_inode->i_sectors[12], all_blocks + 12, 1);
+   } else {	 // 间接块已全部回收,回收间接索引表所在的块
+      block_bitmap_idx = dir_inode->i_sectors[12] - part->sb->data_start_lba;
+      bitmap_set(&part->block_bitmap, block_bitmap_idx, 0);
+      bitmap_sync(part, block_bitmap_idx, BLOCK_BITMAP);
+      dir_inode->i_sectors[12] = 0;
+   }
+}
+
 /* 打开根目录 */
 void open_root_dir(struct partition* part) {
    root_dir.inode = inode_open(part, part->sb->root_inode_no);
    root_dir.dir_pos = 0;
+   memset(dir_cache, 0, sizeof(dir_cache));	 // 挂载新分区时清空目录项缓存
 }
 
 /* 在分区part上打开i结点为inode_no的目录并返回目录指针 */
@@ -28,10 +152,17 @@ struct dir* dir_open(struct partition* part, uint32_t inode_no) {
 }
 
 /* 在part分区内的pdir目录内寻找名为name的文件或目录,
- * 找到后返回true并将其目录项存入dir_e,否则返回false */
+ * 找到后返回true并将其目录项存入dir_e,否则返回false.
+ * 先查目录项缓存,未命中时只读name的家块(家块是间接块时再加上间接块表),
+ * 仅当家块记录有顺延的目录项时才往后面的块找 */
 bool search_dir_entry(struct partition* part, struct dir* pdir, \
 		     const char* name, struct dir_entry* dir_e) {
-   uint32_t block_cnt = 140;	 // 12个直接块+128个一级间接块=140块
+   struct inode* dir_inode = pdir->inode;
+   struct dir_cache_entry* dce = dir_cache_slot(dir_inode->i_no, name);
+   if (dce->part == part && dce->dir_ino == dir_inode->i_no && dir_name_equal(dce->de.filename, name)) {
+      memcpy(dir_e, &dce->de, sizeof(struct dir_entry));
+      return true;
+   }
 
    /* 12个直接块大小+128个间接块,共560字节 */
    uint32_t* all_blocks = (uint32_t*)sys_malloc(48 + 512);
@@ -39,55 +170,69 @@ bool search_dir_entry(struct partition* part, struct dir* pdir, \
       printk("search_dir_entry: sys_malloc for all_blocks failed");
       return false;
    }
-
-   uint32_t block_idx = 0;
-   while (block_idx < 12) {
-      all_blocks[block_idx] = pdir->inode->i_sectors[block_idx];
-      block_idx++;
-   }
-   block_idx = 0;
-
-   if (pdir->inode->i_sectors[12] != 0) {	// 若含有一级间接块表
-      ide_read(part->my_disk, pdir->inode->i_sectors[12], all_blocks + 12, 1);
+   /* 写目录项的时候已保证目录项不跨扇区,只申请容纳1个扇区的内存 */
+   uint8_t* buf = (uint8_t*)sys_malloc(SECTOR_SIZE);
+   if (buf == NULL) {
+      sys_free(all_blocks);
+      printk("search_dir_entry: sys_malloc for buf failed");
+      return false;
    }
-/* 至此,all_blocks存储的是该文件或目录的所有扇区地址 */
+   memcpy(all_blocks, dir_inode->i_sectors, 48);
+   bool indirect_read = false;	 // 一级间接块表只在用到时读一次
 
-   /* 写目录项的时候已保证目录项不跨扇区,
-    * 这样读目录项时容易处理, 只申请容纳1个扇区的内存 */
-   uint8_t* buf = (uint8_t*)sys_malloc(SECTOR_SIZE);
-   struct dir_entry* p_de = (struct dir_entry*)buf;	    // p_de为指向目录项的指针,值为buf起始地址
+   struct dir_entry* p_de = (struct dir_entry*)buf;
+   struct dir_sec_tail* tail = (struct dir_sec_tail*)(buf + DIR_SEC_TAIL_OFF);
    uint32_t dir_entry_size = part->sb->dir_entry_size;
    uint32_t dir_entry_cnt = SECTOR_SIZE / dir_entry_size;   // 1扇区内可容纳的目录项个数
-
-   /* 开始在所有块中查找目录项 */
-   while (block_idx < block_cnt) {		  
-   /* 块地址为0时表示该块中无数据,继续在其它块中找 */
-      if (all_blocks[block_idx] == 0) {
-	 block_idx++;
-	 continue;
+   uint32_t home = dir_home_block(name);
+   uint32_t overflow_cnt = 0, overflow_seen = 0, probe = 0;
+   bool found = false;
+
+   while (probe < DIR_BLOCK_CNT) {
+      uint32_t block_idx = (home + probe) % DIR_BLOCK_CNT;
+      if (block_idx >= 12 && !indirect_read) {
+	 dir_read_indirect(part, dir_inode, all_blocks);
+	 indirect_read = true;
       }
-      ide_read(part->my_disk, all_blocks[block_idx], buf, 1);
-
-      uint32_t dir_entry_idx = 0;
-      /* 遍历扇区中所有目录项 */
-      while (dir_entry_idx < dir_entry_cnt) {
-	 /* 若找到了,就直接复制整个目录项 */
-	 if (!strcmp(p_de->filename, name)) {
-	    memcpy(dir_e, p_de, dir_entry_size);
-	    sys_free(buf);
-	    sys_free(all_blocks);
-	    return true;
+      /* 块地址为0时表示该块中无数据 */
+      if (all_blocks[block_idx] != 0) {
+	 bcache_read(part->my_disk, all_blocks[block_idx], buf, 1);
+	 if (probe == 0) {
+	    overflow_cnt = tail->overflow_cnt;
+	 }
+	 uint32_t dir_entry_idx = 0;
+	 while (dir_entry_idx < dir_entry_cnt) {
+	    if ((p_de + dir_entry_idx)->f_type != FT_UNKNOWN) {
+	       if (dir_name_equal((p_de + dir_entry_idx)->filename, name)) {
+		  found = true;
+		  break;
+	       }
+	       if (probe != 0 && dir_home_block((p_de + dir_entry_idx)->filename) == home) {
+		  overflow_seen++;
+	       }
+	    }
+	    dir_entry_idx++;
+	 }
+	 if (found) {
+	    memcpy(dir_e, p_de + dir_entry_idx, dir_entry_size);
+	    break;
 	 }
-	 dir_entry_idx++;
-	 p_de++;
       }
-      block_idx++;
-      p_de = (struct dir_entry*)buf;  // 此时p_de已经指向扇区内最后一个完整目录项了,需要恢复p_de指向为buf
-      memset(buf, 0, SECTOR_SIZE);	  // 将buf清0,下次再用
+      /* 从家块顺延出去的目录项都已比较过,不必再往后找 */
+      if (overflow_seen >= overflow_cnt) {
+	 break;
+      }
+      probe++;
    }
    sys_free(buf);
    sys_free(all_blocks);
-   return false;
+
+   if (found) {
+      dce->part = part;
+      dce->dir_ino = dir_inode->i_no;
+      memcpy(&dce->de, dir_e, sizeof(struct dir_entry));
+   }
+   return found;
 }
 
 /* 关闭目录 */
@@ -113,7 +258,8 @@ void create_dir_entry(char* filename, uint32_t inode_no, uint8_t file_type, stru
    p_de->f_type = file_type;
 }
 
-/* 将目录项p_de写入父目录parent_dir中,io_buf由主调函数提供 */
+/* 将目录项p_de写入父目录parent_dir中,io_buf由主调函数提供.
+ * 目录项优先写入其家块,家块已满时顺延写入后面的块,并在家块尾部计数 */
 bool sync_dir_entry(struct dir* parent_dir, struct dir_entry* p_de, void* io_buf) {
    struct inode* dir_inode = parent_dir->inode;
    uint32_t dir_size = dir_inode->i_size;
@@ -122,120 +268,76 @@ bool sync_dir_entry(struct dir* parent_dir, struct dir_entry* p_de, void* io_buf
    ASSERT(dir_size % dir_entry_size == 0);	 // dir_size应该是dir_entry_size的整数倍
 
    uint32_t dir_entrys_per_sec = (512 / dir_entry_size);       // 每扇区最大的目录项数目
-   int32_t block_lba = -1;
+   ASSERT(dir_entrys_per_sec * dir_entry_size <= DIR_SEC_TAIL_OFF);
 
    /* 将该目录的所有扇区地址(12个直接块+ 128个间接块)存入all_blocks */
-   uint8_t block_idx = 0;
-   uint32_t all_blocks[140] = {0};	  // all_blocks保存目录所有的块
-
-   /* 将12个直接块存入all_blocks */
-   while (block_idx < 12) {
-      all_blocks[block_idx] = dir_inode->i_sectors[block_idx];
-      block_idx++;
-   }
+   uint32_t all_blocks[DIR_BLOCK_CNT] = {0};	  // all_blocks保存目录所有的块
+   memcpy(all_blocks, dir_inode->i_sectors, 48);
+   dir_read_indirect(cur_part, dir_inode, all_blocks);
 
    struct dir_entry* dir_e = (struct dir_entry*)io_buf;	       // dir_e用来在io_buf中遍历目录项
-   int32_t block_bitmap_idx = -1;
+   struct dir_sec_tail* tail = (struct dir_sec_tail*)((uint8_t*)io_buf + DIR_SEC_TAIL_OFF);
+   uint32_t home = dir_home_block(p_de->filename);
+   uint32_t probe = 0, block_idx = 0, dir_entry_idx = 0;
 
-   /* 开始遍历所有块以寻找目录项空位,若已有扇区中没有空闲位,
-    * 在不超过文件大小的情况下申请新扇区来存储新目录项 */
-   block_idx = 0;
-   while (block_idx < 140) {  // 文件(包括目录)最大支持12个直接块+128个间接块＝140个块
-      block_bitmap_idx = -1;
-      if (all_blocks[block_idx] == 0) {   // 在三种情况下分配块
-	 block_lba = block_bitmap_alloc(cur_part);
-	 if (block_lba == -1) {
+   /* 从家块开始依次找有空位的块,块尚未分配就分配它 */
+   while (probe < DIR_BLOCK_CNT) {
+      block_idx = (home + probe) % DIR_BLOCK_CNT;
+      if (all_blocks[block_idx] == 0) {
+	 if (dir_block_alloc(cur_part, dir_inode, all_blocks, block_idx) == -1) {
 	    printk("alloc block bitmap for sync_dir_entry failed\n");
 	    return false;
 	 }
-
-      /* 每分配一个块就同步一次block_bitmap */
-	 block_bitmap_idx = block_lba - cur_part->sb->data_start_lba;
-	 ASSERT(block_bitmap_idx != -1);
-	 bitmap_sync(cur_part, block_bitmap_idx, BLOCK_BITMAP);
-
-	 block_bitmap_idx = -1;
-	 if (block_idx < 12) {	    // 若是直接块
-	    dir_inode->i_sectors[block_idx] = all_blocks[block_idx] = block_lba;
-	 } else if (block_idx == 12) {	  // 若是尚未分配一级间接块表(block_idx等于12表示第0个间接块地址为0)
-	    dir_inode->i_sectors[12] = block_lba;       // 将上面分配的块做为一级间接块表地址
-	    block_lba = -1;
-	    block_lba = block_bitmap_alloc(cur_part);	       // 再分配一个块做为第0个间接块
-	    if (block_lba == -1) {
-	       block_bitmap_idx = dir_inode->i_sectors[12] - cur_part->sb->data_start_lba;
-	       bitmap_set(&cur_part->block_bitmap, block_bitmap_idx, 0);
-	       dir_inode->i_sectors[12] = 0;
-	       printk("alloc block bitmap for sync_dir_entry failed\n");
-	       return false;
-	    }
-
-	 /* 每分配一个块就同步一次block_bitmap */
-	    block_bitmap_idx = block_lba - cur_part->sb->data_start_lba;
-	    ASSERT(block_bitmap_idx != -1);
-	    bitmap_sync(cur_part, block_bitmap_idx, BLOCK_BITMAP);
-
-	    all_blocks[12] = block_lba;
-	    /* 把新分配的第0个间接块地址写入一级间接块表 */
-	    ide_write(cur_part->my_disk, dir_inode->i_sectors[12], all_blocks + 12, 1);
-	 } else {	   // 若是间接块未分配
-	    all_blocks[block_idx] = block_lba;
-	    /* 把新分配的第(block_idx-12)个间接块地址写入一级间接块表 */
-	    ide_write(cur_part->my_disk, dir_inode->i_sectors[12], all_blocks + 12, 1);
+	 memset(io_buf, 0, SECTOR_SIZE);
+	 dir_entry_idx = 0;
+      } else {
+	 bcache_read(cur_part->my_disk, all_blocks[block_idx], io_buf, 1);
+	 /* FT_UNKNOWN为0,无论是初始化或是删除文件后,都会将f_type置为FT_UNKNOWN */
+	 dir_entry_idx = 0;
+	 while (dir_entry_idx < dir_entrys_per_sec && (dir_e + dir_entry_idx)->f_type != FT_UNKNOWN) {
+	    dir_entry_idx++;
 	 }
-
-	 /* 再将新目录项p_de写入新分配的间接块 */
-	 memset(io_buf, 0, 512);
-	 memcpy(io_buf, p_de, dir_entry_size);
-	 ide_write(cur_part->my_disk, all_blocks[block_idx], io_buf, 1);
-	 dir_inode->i_size += dir_entry_size;
-	 return true;
       }
-
-   /* 若第block_idx块已存在,将其读进内存,然后在该块中查找空目录项 */
-      ide_read(cur_part->my_disk, all_blocks[block_idx], io_buf, 1); 
-      /* 在扇区内查找空目录项 */
-      uint8_t dir_entry_idx = 0;
-      while (dir_entry_idx < dir_entrys_per_sec) {
-	 if ((dir_e + dir_entry_idx)->f_type == FT_UNKNOWN) {	// FT_UNKNOWN为0,无论是初始化或是删除文件后,都会将f_type置为FT_UNKNOWN.
-	    memcpy(dir_e + dir_entry_idx, p_de, dir_entry_size);    
-	    ide_write(cur_part->my_disk, all_blocks[block_idx], io_buf, 1);
-
-	    dir_inode->i_size += dir_entry_size;
-	    return true;
-	 }
-	 dir_entry_idx++;
+      if (dir_entry_idx < dir_entrys_per_sec) {
+	 memcpy(dir_e + dir_entry_idx, p_de, dir_entry_size);
+	 bcache_write(cur_part->my_disk, all_blocks[block_idx], io_buf, 1);
+	 break;
       }
-      block_idx++;
-   }   
-   printk("directory is full!\n");
-   return false;
+      probe++;
+   }
+   if (probe == DIR_BLOCK_CNT) {
+      printk("directory is full!\n");
+      return false;
+   }
+
+   /* 未能写入家块,在家块尾部记下顺延数,查找时据此决定是否往后找 */
+   if (probe != 0) {
+      bcache_read(cur_part->my_disk, all_blocks[home], io_buf, 1);
+      tail->overflow_cnt++;
+      bcache_write(cur_part->my_disk, all_blocks[home], io_buf, 1);
+   }
+   dir_inode->i_size += dir_entry_size;
+   return true;
 }
 
 /* 把分区part目录pdir中编号为inode_no的目录项删除 */
 bool delete_dir_entry(struct partition* part, struct dir* pdir, uint32_t inode_no, void* io_buf) {
    struct inode* dir_inode = pdir->inode;
-   uint32_t block_idx = 0, all_blocks[140] = {0};
+   uint32_t block_idx = 0, all_blocks[DIR_BLOCK_CNT] = {0};
    /* 收集目录全部块地址 */
-   while (block_idx < 12) {
-      all_blocks[block_idx] = dir_inode->i_sectors[block_idx];
-      block_idx++;
-   }
-   if (dir_inode->i_sectors[12]) {
-      ide_read(part->my_disk, dir_inode->i_sectors[12], all_blocks + 12, 1);
-   }
+   memcpy(all_blocks, dir_inode->i_sectors, 48);
+   dir_read_indirect(part, dir_inode, all_blocks);
 
    /* 目录项在存储时保证不会跨扇区 */
    uint32_t dir_entry_size = part->sb->dir_entry_size;
    uint32_t dir_entrys_per_sec = (SECTOR_SIZE / dir_entry_size);       // 每扇区最大的目录项数目
    struct dir_entry* dir_e = (struct dir_entry*)io_buf;   
    struct dir_entry* dir_entry_found = NULL;
+   struct dir_sec_tail* tail = (struct dir_sec_tail*)((uint8_t*)io_buf + DIR_SEC_TAIL_OFF);
    uint8_t dir_entry_idx, dir_entry_cnt;
-   bool is_dir_first_block = false;     // 目录的第1个块 
 
    /* 遍历所有块,寻找目录项 */
-   block_idx = 0;
-   while (block_idx < 140) {
-      is_dir_first_block = false;
+   while (block_idx < DIR_BLOCK_CNT) {
       if (all_blocks[block_idx] == 0) {
 	 block_idx++;
 	 continue;
@@ -243,21 +345,17 @@ bool delete_dir_entry(struct partition* part, struct dir* pdir, uint32_t inode_n
       dir_entry_idx = dir_entry_cnt = 0;
       memset(io_buf, 0, SECTOR_SIZE);
       /* 读取扇区,获得目录项 */
-      ide_read(part->my_disk, all_blocks[block_idx], io_buf, 1);
+      bcache_read(part->my_disk, all_blocks[block_idx], io_buf, 1);
 
-      /* 遍历所有的目录项,统计该扇区的目录项数量及是否有待删除的目录项 */
+      /* 遍历所有的目录项,统计该扇区的目录项数量(包括.和..)及是否有待删除的目录项 */
       while (dir_entry_idx < dir_entrys_per_sec) {
 	 if ((dir_e + dir_entry_idx)->f_type != FT_UNKNOWN) {
-	    if (!strcmp((dir_e + dir_entry_idx)->filename, ".")) { 
-	       is_dir_first_block = true;
-	    } else if (strcmp((dir_e + dir_entry_idx)->filename, ".") && 
-	       strcmp((dir_e + dir_entry_idx)->filename, "..")) {
-	       dir_entry_cnt++;     // 统计此扇区内的目录项个数,用来判断删除目录项后是否回收该扇区
-	       if ((dir_e + dir_entry_idx)->i_no == inode_no) {	  // 如果找到此i结点,就将其记录在dir_entry_found
-		  ASSERT(dir_entry_found == NULL);  // 确保目录中只有一个编号为inode_no的inode,找到一次后dir_entry_found就不再是NULL
-		  dir_entry_found = dir_e + dir_entry_idx;
-		  /* 找到后也继续遍历,统计总共的目录项数 */
-	       }
+	    dir_entry_cnt++;     // 统计此扇区内的目录项个数,用来判断删除目录项后是否回收该扇区
+	    if ((dir_e + dir_entry_idx)->i_no == inode_no && \
+		!dir_name_equal((dir_e + dir_entry_idx)->filename, ".") && \
+		!dir_name_equal((dir_e + dir_entry_idx)->filename, "..")) {
+	       ASSERT(dir_entry_found == NULL);  // 确保目录中只有一个编号为inode_no的inode
+	       dir_entry_found = dir_e + dir_entry_idx;
 	    }
 	 }
 	 dir_entry_idx++;
@@ -269,45 +367,37 @@ bool delete_dir_entry(struct partition* part, struct dir* pdir, uint32_t inode_n
 	 continue;
       }
 
-   /* 在此扇区中找到目录项后,清除该目录项并判断是否回收扇区,随后退出循环直接返回 */
+      char filename[MAX_FILE_NAME_LEN + 1] = {0};
+      memcpy(filename, dir_entry_found->filename, MAX_FILE_NAME_LEN);
+      uint32_t home = dir_home_block(filename);
+      dir_cache_invalidate(part, dir_inode->i_no, filename);
+
+   /* 清除该目录项,除目录第1个扇区外,若扇区上只有该目录项且没有从本块顺延出去的目录项,则将整个扇区回收 */
       ASSERT(dir_entry_cnt >= 1);
-    /* 除目录第1个扇区外,若该扇区上只有该目录项自己,则将整个扇区回收 */
-      if (dir_entry_cnt == 1 && !is_dir_first_block) {
-	 /* a 在块位图中回收该块 */
-	 uint32_t block_bitmap_idx = all_blocks[block_idx] - part->sb->data_start_lba;
-	 bitmap_set(&part->block_bitmap, block_bitmap_idx, 0);
-	 bitmap_sync(cur_part, block_bitmap_idx, BLOCK_BITMAP);
-
-	 /* b 将块地址从数组i_sectors或索引表中去掉 */
-	 if (block_idx < 12) {
-	    dir_inode->i_sectors[block_idx] = 0;
-	 } else {    // 在一级间接索引表中擦除该间接块地址
-	    /*先判断一级间接索引表中间接块的数量,如果仅有这1个间接块,连同间接索引表所在的块一同回收 */
-	    uint32_t indirect_blocks = 0;
-	    uint32_t indirect_block_idx = 12;
-	    while (indirect_block_idx < 140) {
-	       if (all_blocks[indirect_block_idx] != 0) {
-		  indirect_blocks++;
-	       }
-	    }
-	    ASSERT(indirect_blocks >= 1);  // 包括当前间接块
-
-	    if (indirect_blocks > 1) {	  // 间接索引表中还包括其它间接块,仅在索引表中擦除当前这个间接块地址
-	       all_blocks[block_idx] = 0; 
-	       ide_write(part->my_disk, dir_inode->i_sectors[12], all_blocks + 12, 1); 
-	    } else {	// 间接索引表中就当前这1个间接块,直接把间接索引表所在的块回收,然后擦除间接索引表块地址
-	       /* 回收间接索引表所在的块 */
-	       block_bitmap_idx = dir_inode->i_sectors[12] - part->sb->data_start_lba;
-	       bitmap_set(&part->block_bitmap, block_bitmap_idx, 0);
-	       bitmap_sync(cur_part, block_bitmap_idx, BLOCK_BITMAP);
-	       
-	       /* 将间接索引表地址清0 */
-	       dir_inode->i_sectors[12] = 0;
+      if (dir_entry_cnt == 1 && block_idx != 0 && tail->overflow_cnt == 0) {
+	 dir_block_free(part, dir_inode, all_blocks, block_idx);
+      } else {
+	 memset(dir_entry_found, 0, dir_entry_size);
+	 bcache_write(part->my_disk, all_blocks[block_idx], io_buf, 1);
+      }
+
+      /* 目录项是从家块顺延过来的,家块的顺延数减1,家块因此变得无用时一并回收 */
+      if (block_idx != home) {
+	 bcache_read(part->my_disk, all_blocks[home], io_buf, 1);
+	 ASSERT(tail->overflow_cnt > 0);
+	 tail->overflow_cnt--;
+	 dir_entry_idx = dir_entry_cnt = 0;
+	 while (dir_entry_idx < dir_entrys_per_sec) {
+	    if ((dir_e + dir_entry_idx)->f_type != FT_UNKNOWN) {
+	       dir_entry_cnt++;
 	    }
+	    dir_entry_idx++;
+	 }
+	 if (dir_entry_cnt == 0 && home != 0 && tail->overflow_cnt == 0) {
+	    dir_block_free(part, dir_inode, all_blocks, home);
+	 } else {
+	    bcache_write(part->my_disk, all_blocks[home], io_buf, 1);
 	 }
-      } else { // 仅将该目录项清空
-	 memset(dir_entry_found, 0, dir_entry_size);
-	 ide_write(part->my_disk, all_blocks[block_idx], io_buf, 1);
       }
 
    /* 更新i结点信息并同步到硬盘 */
@@ -333,7 +423,7 @@ struct dir_entry* dir_read(struct dir* dir) {
       block_idx++;
    }
    if (dir_inode->i_sectors[12] != 0) {	     // 若含有一级间接块表
-      ide_read(cur_part->my_disk, dir_inode->i_sectors[12], all_blocks + 12, 1);
+      bcache_read(cur_part->my_disk, dir_inode->i_sectors[12], all_blocks + 12, 1);
       block_cnt = 140;
    }
    block_idx = 0;
@@ -351,7 +441,7 @@ struct dir_entry* dir_read(struct dir* dir) {
 	 continue;
       }
       memset(dir_e, 0, SECTOR_SIZE);
-      ide_read(cur_part->my_disk, all_blocks[block_idx], dir_e, 1);
+      bcache_read(cur_part->my_disk, all_blocks[block_idx], dir_e, 1);
       dir_entry_idx = 0;
       /* 遍历扇区内所有目录项 */
       while (dir_entry_idx < dir_entrys_per_sec) {
@@ -7,6 +7,9 @@
 #include "global.h"
 
 #define MAX_FILE_NAME_LEN  16	 // 最大文件名长度
+#define DIR_BLOCK_CNT	   140	 // 目录最多12个直接块+128个间接块
+#define DIR_SEC_TAIL_OFF   504	 // 扇区内21个目录项之后的8字节存放dir_sec_tail
+#define DIR_CACHE_SIZE	   64	 // 目录项缓存的槽数
 
 /* 目录结构 */
 struct dir {
@@ -15,6 +18,13 @@ struct dir {
    uint8_t dir_buf[512];  // 目录的数据缓存
 };
 
+/* 目录扇区的尾部.目录项按文件名散列到"家块",
+ * 家块已满时顺延存入后面的块,并在家块尾部记下顺延的个数 */
+struct dir_sec_tail {
+   uint32_t overflow_cnt;	 // 家块是本块却存放在后续块中的目录项数
+   uint32_t reserved;
+};
+
 /* 目录项结构 */
 struct dir_entry {
    char filename[MAX_FILE_NAME_LEN];  // 普通文件或目录名称
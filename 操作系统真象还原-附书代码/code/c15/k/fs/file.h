@@ -26,6 +26,7 @@ enum bitmap_type {
 };
 
 #define MAX_FILE_OPEN 32    // 系统可打开的最大文件数
+#define FILE_RUN_SECS 16    // 读写文件时一次最多合并的连续扇区数
 
 extern struct file file_table[MAX_FILE_OPEN];
 int32_t inode_bitmap_alloc(struct partition* part);
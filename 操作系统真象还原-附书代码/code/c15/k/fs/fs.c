@@ -15,6 +15,7 @@
 #include "keyboard.h"
 #include "ioqueue.h"
 #include "pipe.h"
+#include "bcache.h"
 
 struct partition* cur_part;	 // 默认情况下操作的是哪个分区
 
@@ -50,6 +51,12 @@ static bool mount_partition(struct list_elem* pelem, int arg) {
       cur_part->block_bitmap.btmp_bytes_len = sb_buf->block_bitmap_sects * SECTOR_SIZE;
       /* 从硬盘上读入块位图到分区的block_bitmap.bits */
       ide_read(hd, sb_buf->block_bitmap_lba, cur_part->block_bitmap.bits, sb_buf->block_bitmap_sects);   
+      /* 块位图很大,给它配上第二级位图,分配块时可以跳过已满的部分 */
+      cur_part->block_bitmap.summary = (uint32_t*)sys_malloc(BITMAP_SUMMARY_BYTES(cur_part->block_bitmap.btmp_bytes_len));
+      if (cur_part->block_bitmap.summary == NULL) {
+	 PANIC("alloc memory failed!");
+      }
+      bitmap_summarize(&cur_part->block_bitmap);
       /*************************************************************/
 
       /**********     将硬盘上的inode位图读入到内存    ************/
@@ -92,7 +99,7 @@ static void partition_format(struct partition* part) {
    
    /* 超级块初始化 */
    struct super_block sb;
-   sb.magic = 0x19590318;
+   sb.magic = SB_MAGIC;
    sb.sec_cnt = part->sec_cnt;
    sb.inode_cnt = MAX_FILES_PER_PART;
    sb.part_lba_base = part->start_lba;
@@ -608,7 +615,7 @@ int32_t sys_mkdir(const char* pathname) {
    memcpy(p_de->filename, "..", 2);
    p_de->i_no = parent_dir->inode->i_no;
    p_de->f_type = FT_DIRECTORY;
-   ide_write(cur_part->my_disk, new_dir_inode.i_sectors[0], io_buf, 1);
+   bcache_write(cur_part->my_disk, new_dir_inode.i_sectors[0], io_buf, 1);
 
    new_dir_inode.i_size = 2 * cur_part->sb->dir_entry_size;
 
@@ -737,7 +744,7 @@ static uint32_t get_parent_dir_inode_nr(uint32_t child_inode_nr, void* io_buf) {
    uint32_t block_lba = child_dir_inode->i_sectors[0];
    ASSERT(block_lba >= cur_part->sb->data_start_lba);
    inode_close(child_dir_inode);
-   ide_read(cur_part->my_disk, block_lba, io_buf, 1);   
+   bcache_read(cur_part->my_disk, block_lba, io_buf, 1);   
    struct dir_entry* dir_e = (struct dir_entry*)io_buf;
    /* 第0个目录项是".",第1个目录项是".." */
    ASSERT(dir_e[1].i_no < 4096 && dir_e[1].f_type == FT_DIRECTORY);
@@ -756,7 +763,7 @@ static int get_child_dir_name(uint32_t p_inode_nr, uint32_t c_inode_nr, char* pa
       block_idx++;
    }
    if (parent_dir_inode->i_sectors[12]) {	// 若包含了一级间接块表,将共读入all_blocks.
-      ide_read(cur_part->my_disk, parent_dir_inode->i_sectors[12], all_blocks + 12, 1);
+      bcache_read(cur_part->my_disk, parent_dir_inode->i_sectors[12], all_blocks + 12, 1);
       block_cnt = 140;
    }
    inode_close(parent_dir_inode);
@@ -768,7 +775,7 @@ static int get_child_dir_name(uint32_t p_inode_nr, uint32_t c_inode_nr, char* pa
   /* 遍历所有块 */
    while(block_idx < block_cnt) {
       if(all_blocks[block_idx]) {      // 如果相应块不为空则读入相应块
-	 ide_read(cur_part->my_disk, all_blocks[block_idx], io_buf, 1);
+	 bcache_read(cur_part->my_disk, all_blocks[block_idx], io_buf, 1);
 	 uint8_t dir_e_idx = 0;
 	 /* 遍历每个目录项 */
 	 while(dir_e_idx < dir_entrys_per_sec) {
@@ -909,6 +916,8 @@ void sys_help(void) {
 void filesys_init() {
    uint8_t channel_no = 0, dev_no, part_idx = 0;
 
+   bcache_init();
+
    /* sb_buf用来存储从硬盘上读入的超级块 */
    struct super_block* sb_buf = (struct super_block*)sys_malloc(SECTOR_SIZE);
 
@@ -941,7 +950,7 @@ void filesys_init() {
 	       ide_read(hd, part->start_lba + 1, sb_buf, 1);   
 
 	       /* 只支持自己的文件系统.若磁盘上已经有文件系统就不再格式化了 */
-	       if (sb_buf->magic == 0x19590318) {
+	       if (sb_buf->magic == SB_MAGIC) {
 		  printk("%s has filesystem\n", part->name);
 	       } else {			  // 其它文件系统不支持,一律按无文件系统处理
 		  printk("formatting %s`s partition %s......\n", hd->name, part->name);
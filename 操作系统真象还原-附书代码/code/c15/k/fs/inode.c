@@ -9,6 +9,7 @@
 #include "stdio-kernel.h"
 #include "string.h"
 #include "super_block.h"
+#include "bcache.h"
 
 /* 用来存储inode位置 */
 struct inode_position {
@@ -59,17 +60,17 @@ void inode_sync(struct partition* part, struct inode* inode, void* io_buf) {	 //
    char* inode_buf = (char*)io_buf;
    if (inode_pos.two_sec) {	    // 若是跨了两个扇区,就要读出两个扇区再写入两个扇区
    /* 读写硬盘是以扇区为单位,若写入的数据小于一扇区,要将原硬盘上的内容先读出来再和新数据拼成一扇区后再写入  */
-      ide_read(part->my_disk, inode_pos.sec_lba, inode_buf, 2);	// inode在format中写入硬盘时是连续写入的,所以读入2块扇区
+      bcache_read(part->my_disk, inode_pos.sec_lba, inode_buf, 2);	// inode在format中写入硬盘时是连续写入的,所以读入2块扇区
 
    /* 开始将待写入的inode拼入到这2个扇区中的相应位置 */
       memcpy((inode_buf + inode_pos.off_size), &pure_inode, sizeof(struct inode));
    
    /* 将拼接好的数据再写入磁盘 */
-      ide_write(part->my_disk, inode_pos.sec_lba, inode_buf, 2);
+      bcache_write(part->my_disk, inode_pos.sec_lba, inode_buf, 2);
    } else {			    // 若只是一个扇区
-      ide_read(part->my_disk, inode_pos.sec_lba, inode_buf, 1);
+      bcache_read(part->my_disk, inode_pos.sec_lba, inode_buf, 1);
       memcpy((inode_buf + inode_pos.off_size), &pure_inode, sizeof(struct inode));
-      ide_write(part->my_disk, inode_pos.sec_lba, inode_buf, 1);
+      bcache_write(part->my_disk, inode_pos.sec_lba, inode_buf, 1);
    }
 }
 
@@ -110,10 +111,10 @@ struct inode* inode_open(struct partition* part, uint32_t inode_no) {
 
    /* i结点表是被partition_format函数连续写入扇区的,
     * 所以下面可以连续读出来 */
-      ide_read(part->my_disk, inode_pos.sec_lba, inode_buf, 2);
+      bcache_read(part->my_disk, inode_pos.sec_lba, inode_buf, 2);
    } else {	// 否则,所查找的inode未跨扇区,一个扇区大小的缓冲区足够
       inode_buf = (char*)sys_malloc(512);
-      ide_read(part->my_disk, inode_pos.sec_lba, inode_buf, 1);
+      bcache_read(part->my_disk, inode_pos.sec_lba, inode_buf, 1);
    }
    memcpy(inode_found, inode_buf + inode_pos.off_size, sizeof(struct inode));
 
@@ -152,60 +153,135 @@ void inode_delete(struct partition* part, uint32_t inode_no, void* io_buf) {
    char* inode_buf = (char*)io_buf;
    if (inode_pos.two_sec) {   // inode跨扇区,读入2个扇区
       /* 将原硬盘上的内容先读出来 */
-      ide_read(part->my_disk, inode_pos.sec_lba, inode_buf, 2);
+      bcache_read(part->my_disk, inode_pos.sec_lba, inode_buf, 2);
       /* 将inode_buf清0 */
       memset((inode_buf + inode_pos.off_size), 0, sizeof(struct inode));
       /* 用清0的内存数据覆盖磁盘 */
-      ide_write(part->my_disk, inode_pos.sec_lba, inode_buf, 2);
+      bcache_write(part->my_disk, inode_pos.sec_lba, inode_buf, 2);
    } else {    // 未跨扇区,只读入1个扇区就好
       /* 将原硬盘上的内容先读出来 */
-      ide_read(part->my_disk, inode_pos.sec_lba, inode_buf, 1);
+      bcache_read(part->my_disk, inode_pos.sec_lba, inode_buf, 1);
       /* 将inode_buf清0 */
       memset((inode_buf + inode_pos.off_size), 0, sizeof(struct inode));
       /* 用清0的内存数据覆盖磁盘 */
-      ide_write(part->my_disk, inode_pos.sec_lba, inode_buf, 1);
+      bcache_write(part->my_disk, inode_pos.sec_lba, inode_buf, 1);
    }
 }
 
+/* 分配1个块并同步块位图,失败返回-1 */
+static int32_t inode_block_alloc(struct partition* part) {
+   int32_t block_lba = block_bitmap_alloc(part);
+   if (block_lba != -1) {
+      bitmap_sync(part, block_lba - part->sb->data_start_lba, BLOCK_BITMAP);
+   }
+   return block_lba;
+}
+
+/* 回收块block_lba并同步块位图 */
+static void inode_block_free(struct partition* part, uint32_t block_lba) {
+   uint32_t block_bitmap_idx = block_lba - part->sb->data_start_lba;
+   ASSERT(block_bitmap_idx > 0);
+   bitmap_set(&part->block_bitmap, block_bitmap_idx, 0);
+   bitmap_sync(part, block_bitmap_idx, BLOCK_BITMAP);
+}
+
+/* 返回inode第blk_idx块的扇区地址,只查这一块所经过的各级间接块表.
+ * create为true时沿途缺少的间接块表和数据块都分配上,分配失败返回-1;
+ * create为false时该块尚未分配返回0.
+ * io_buf由主调函数提供,1个扇区大小 */
+int32_t inode_bmap(struct partition* part, struct inode* inode, uint32_t blk_idx, bool create, void* io_buf) {
+   ASSERT(blk_idx < INODE_MAX_BLKS);
+   uint32_t* table = (uint32_t*)io_buf;
+   uint32_t* slot;		 // 指向存放下一级块地址的位置
+   uint32_t level = 0;		 // slot所指的块是几级间接块表,0表示数据块
+   uint32_t span = 1;		 // 该表中每项覆盖的块数
+
+   if (blk_idx < INODE_DIRECT_BLKS) {
+      slot = &inode->i_sectors[blk_idx];
+   } else {
+      /* 依次减去一级,二级间接块覆盖的块数,确定用几级间接块 */
+      blk_idx -= INODE_DIRECT_BLKS;
+      level = 1;
+      while (blk_idx >= span * BLOCK_PTRS) {
+	 blk_idx -= span * BLOCK_PTRS;
+	 span *= BLOCK_PTRS;
+	 level++;
+      }
+      slot = &inode->i_sectors[INODE_DIRECT_BLKS + level - 1];
+   }
+
+   uint32_t table_lba = 0;	 // slot所在的间接块表,为0表示slot在inode中
+   while (1) {
+      uint32_t block_lba = *slot;
+      if (block_lba == 0) {
+	 if (!create) {
+	    return 0;
+	 }
+	 int32_t new_lba = inode_block_alloc(part);
+	 if (new_lba == -1) {
+	    return -1;
+	 }
+	 block_lba = *slot = new_lba;
+	 if (table_lba != 0) {
+	    bcache_write(part->my_disk, table_lba, table, 1);
+	 }
+	 /* 新的间接块表须清0 */
+	 if (level > 0) {
+	    memset(table, 0, BLOCK_SIZE);
+	    bcache_write(part->my_disk, block_lba, table, 1);
+	 }
+      }
+      if (level == 0) {
+	 return block_lba;
+      }
+
+      /* 进入下一级 */
+      bcache_read(part->my_disk, block_lba, table, 1);
+      table_lba = block_lba;
+      slot = &table[blk_idx / span];
+      blk_idx %= span;
+      span /= BLOCK_PTRS;
+      level--;
+   }
+}
+
+/* 回收level级间接块表block_lba及其下的所有块,level为0时block_lba是数据块.
+ * io_buf由主调函数提供,至少level个扇区 */
+static void inode_free_tree(struct partition* part, uint32_t block_lba, uint32_t level, uint32_t* io_buf) {
+   if (level > 0) {
+      bcache_read(part->my_disk, block_lba, io_buf, 1);
+      uint32_t idx = 0;
+      while (idx < BLOCK_PTRS) {
+	 if (io_buf[idx] != 0) {
+	    inode_free_tree(part, io_buf[idx], level - 1, io_buf + BLOCK_PTRS);
+	 }
+	 idx++;
+      }
+   }
+   inode_block_free(part, block_lba);
+}
+
 /* 回收inode的数据块和inode本身 */
 void inode_release(struct partition* part, uint32_t inode_no) {
    struct inode* inode_to_del = inode_open(part, inode_no);
    ASSERT(inode_to_del->i_no == inode_no);
 
-/* 1 回收inode占用的所有块 */
-   uint8_t block_idx = 0, block_cnt = 12;
-   uint32_t block_bitmap_idx;
-   uint32_t all_blocks[140] = {0};	  //12个直接块+128个间接块
-
-   /* a 先将前12个直接块存入all_blocks */
-   while (block_idx < 12) {
-      all_blocks[block_idx] = inode_to_del->i_sectors[block_idx];
-      block_idx++;
+   /* 三级间接块表逐级往下要用3个扇区,inode_delete要用2个扇区 */
+   void* io_buf = sys_malloc(SECTOR_SIZE * 3);
+   if (io_buf == NULL) {
+      printk("inode_release: sys_malloc for io_buf failed\n");
+      inode_close(inode_to_del);
+      return;
    }
 
-   /* b 如果一级间接块表存在,将其128个间接块读到all_blocks[12~], 并释放一级间接块表所占的扇区 */
-   if (inode_to_del->i_sectors[12] != 0) {
-      ide_read(part->my_disk, inode_to_del->i_sectors[12], all_blocks + 12, 1);
-      block_cnt = 140;
-
-      /* 回收一级间接块表占用的扇区 */
-      block_bitmap_idx = inode_to_del->i_sectors[12] - part->sb->data_start_lba;
-      ASSERT(block_bitmap_idx > 0);
-      bitmap_set(&part->block_bitmap, block_bitmap_idx, 0);
-      bitmap_sync(cur_part, block_bitmap_idx, BLOCK_BITMAP);
-   }
-   
-   /* c inode所有的块地址已经收集到all_blocks中,下面逐个回收 */
-   block_idx = 0;
-   while (block_idx < block_cnt) {
-      if (all_blocks[block_idx] != 0) {
-	 block_bitmap_idx = 0;
-	 block_bitmap_idx = all_blocks[block_idx] - part->sb->data_start_lba;
-	 ASSERT(block_bitmap_idx > 0);
-	 bitmap_set(&part->block_bitmap, block_bitmap_idx, 0);
-	 bitmap_sync(cur_part, block_bitmap_idx, BLOCK_BITMAP);
+/* 1 回收inode占用的所有块,直接块是0级,i_sectors[12~14]依次是1~3级 */
+   uint32_t sec_idx = 0;
+   while (sec_idx < INODE_SECTORS) {
+      if (inode_to_del->i_sectors[sec_idx] != 0) {
+	 uint32_t level = sec_idx < INODE_DIRECT_BLKS ? 0 : sec_idx - INODE_DIRECT_BLKS + 1;
+	 inode_free_tree(part, inode_to_del->i_sectors[sec_idx], level, io_buf);
       }
-      block_idx++; 
+      sec_idx++;
    }
 
 /*2 回收该inode所占用的inode */
@@ -216,10 +292,9 @@ void inode_release(struct partition* part, uint32_t inode_no) {
    * 此函数会在inode_table中将此inode清0,
    * 但实际上是不需要的,inode分配是由inode位图控制的,
    * 硬盘上的数据不需要清0,可以直接覆盖*/
-   void* io_buf = sys_malloc(1024);
    inode_delete(part, inode_no, io_buf);
-   sys_free(io_buf);
    /***********************************************/
+   sys_free(io_buf);
     
    inode_close(inode_to_del);
 }
@@ -233,8 +308,8 @@ void inode_init(uint32_t inode_no, struct inode* new_inode) {
 
    /* 初始化块索引数组i_sector */
    uint8_t sec_idx = 0;
-   while (sec_idx < 13) {
-   /* i_sectors[12]为一级间接块地址 */
+   while (sec_idx < INODE_SECTORS) {
+   /* i_sectors[12~14]为间接块表地址 */
       new_inode->i_sectors[sec_idx] = 0;
       sec_idx++;
    }
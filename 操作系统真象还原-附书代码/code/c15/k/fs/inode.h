@@ -4,6 +4,12 @@
 #include "list.h"
 #include "ide.h"
 
+#define INODE_DIRECT_BLKS 12	 // 直接块数
+#define INODE_SECTORS	  15	 // 12个直接块+一级,二级,三级间接块表
+#define BLOCK_PTRS	  128	 // 每个间接块表容纳的块地址数
+/* 文件最多占用的块数 */
+#define INODE_MAX_BLKS (INODE_DIRECT_BLKS + BLOCK_PTRS + BLOCK_PTRS * BLOCK_PTRS + BLOCK_PTRS * BLOCK_PTRS * BLOCK_PTRS)
+
 /* inode结构 */
 struct inode {
    uint32_t i_no;    // inode编号
@@ -15,8 +21,9 @@ struct inode {
    uint32_t i_open_cnts;   // 记录此文件被打开的次数
    bool write_deny;	   // 写文件不能并行,进程写文件前检查此标识
 
-/* i_sectors[0-11]是直接块, i_sectors[12]用来存储一级间接块指针 */
-   uint32_t i_sectors[13];
+/* i_sectors[0-11]是直接块, i_sectors[12],[13],[14]分别是一级,二级,三级间接块表指针.
+ * 目录只用到一级间接块 */
+   uint32_t i_sectors[INODE_SECTORS];
    struct list_elem inode_tag;
 };
 
@@ -26,4 +33,5 @@ void inode_init(uint32_t inode_no, struct inode* new_inode);
 void inode_close(struct inode* inode);
 void inode_release(struct partition* part, uint32_t inode_no);
 void inode_delete(struct partition* part, uint32_t inode_no, void* io_buf);
+int32_t inode_bmap(struct partition* part, struct inode* inode, uint32_t blk_idx, bool create, void* io_buf);
 #endif
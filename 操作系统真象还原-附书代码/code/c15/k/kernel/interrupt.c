@@ -3,6 +3,7 @@
 #include "global.h"
 #include "io.h"
 #include "print.h"
+#include "memory.h"
 
 #define PIC_M_CTRL 0x20	       // 这里用的可编程中断控制器是8259A,主片的控制端口是0x20
 #define PIC_M_DATA 0x21	       // 主片的数据端口是0x21
@@ -89,6 +90,13 @@ static void general_intr_handler(uint8_t vec_nr) {
    if (vec_nr == 0x27 || vec_nr == 0x2f) {	// 0x2f是从片8259A上的最后一个irq引脚，保留
       return;		//IRQ7和IRQ15会产生伪中断(spurious interrupt),无须处理。
    }
+   if (vec_nr == 14) {	  // 写fork后共享的页引起的Pagefault,复制一份后返回重新执行写操作
+      uint32_t page_fault_vaddr = 0;
+      asm ("movl %%cr2, %0" : "=r" (page_fault_vaddr));
+      if (cow_page_fault(page_fault_vaddr)) {
+	 return;
+      }
+   }
   /* 将光标置为0,从屏幕左上角清出一片打印异常信息的区域,方便阅读 */
    set_cursor(0);
    int cursor_pos = 0;
@@ -27,6 +27,7 @@ struct pool {
    uint32_t phy_addr_start;	 // 本内存池所管理物理内存的起始地址
    uint32_t pool_size;		 // 本内存池字节容量
    struct lock lock;		 // 申请内存时互斥
+   uint32_t lock_contended;	 // 申请lock时它已被别的线程持有的次数
 };
 
 /* 内存仓库arena元信息 */
@@ -42,6 +43,24 @@ struct mem_block_desc k_block_descs[DESC_CNT];	// 内核内存块描述符数组
 struct pool kernel_pool, user_pool;      // 生成内核内存池和用户内存池
 struct virtual_addr kernel_vaddr;	 // 此结构是用来给内核分配虚拟地址
 
+/* 写时复制(COW)用: 用户内存池中每个页框除第一个使用者外还有几个进程在共享它,
+ * 为0表示页框为一个进程独有.只在关中断时修改 */
+static uint16_t* user_frame_refs;
+static void* cow_buf;			 // 复制共享页时的中转页
+
+/* 获取内存池m_pool的锁,并统计争用次数 */
+static void pool_lock(struct pool* m_pool) {
+   if (m_pool->lock.holder != NULL && m_pool->lock.holder != running_thread()) {
+      m_pool->lock_contended++;
+   }
+   lock_acquire(&m_pool->lock);
+}
+
+/* 返回pf表示的内存池的锁争用次数 */
+uint32_t mem_lock_contended(enum pool_flags pf) {
+   return pf == PF_KERNEL ? kernel_pool.lock_contended : user_pool.lock_contended;
+}
+
 /* 在pf表示的虚拟内存池中申请pg_cnt个虚拟页,
  * 成功则返回虚拟页的起始地址, 失败则返回NULL */
 static void* vaddr_get(enum pool_flags pf, uint32_t pg_cnt) {
@@ -105,8 +124,8 @@ static void* palloc(struct pool* m_pool) {
    return (void*)page_phyaddr;
 }
 
-/* 页表中添加虚拟地址_vaddr与物理地址_page_phyaddr的映射 */
-static void page_table_add(void* _vaddr, void* _page_phyaddr) {
+/* 页表中添加虚拟地址_vaddr与物理地址_page_phyaddr的映射,页表项属性为attr */
+static void page_table_map(void* _vaddr, void* _page_phyaddr, uint32_t attr) {
    uint32_t vaddr = (uint32_t)_vaddr, page_phyaddr = (uint32_t)_page_phyaddr;
    uint32_t* pde = pde_ptr(vaddr);
    uint32_t* pte = pte_ptr(vaddr);
@@ -121,7 +140,7 @@ static void page_table_add(void* _vaddr, void* _page_phyaddr) {
       ASSERT(!(*pte & 0x00000001));
 
       if (!(*pte & 0x00000001)) {   // 只要是创建页表,pte就应该不存在,多判断一下放心
-	 *pte = (page_phyaddr | PG_US_U | PG_RW_W | PG_P_1);    // US=1,RW=1,P=1
+	 *pte = (page_phyaddr | attr);
       } else {	  // 调试模式下不会执行到此,上面的ASSERT会先执行.关闭调试时下面的PANIC会起作用
 	 PANIC("pte repeat");
       }
@@ -137,10 +156,15 @@ static void page_table_add(void* _vaddr, void* _page_phyaddr) {
       memset((void*)((int)pte & 0xfffff000), 0, PG_SIZE); 
 /************************************************************/
       ASSERT(!(*pte & 0x00000001));
-      *pte = (page_phyaddr | PG_US_U | PG_RW_W | PG_P_1);      // US=1,RW=1,P=1
+      *pte = (page_phyaddr | attr);
    }
 }
 
+/* 页表中添加虚拟地址_vaddr与物理地址_page_phyaddr的映射 */
+static void page_table_add(void* _vaddr, void* _page_phyaddr) {
+   page_table_map(_vaddr, _page_phyaddr, PG_US_U | PG_RW_W | PG_P_1);	  // US=1,RW=1,P=1
+}
+
 /* 分配pg_cnt个页空间,成功则返回起始虚拟地址,失败时返回NULL */
 void* malloc_page(enum pool_flags pf, uint32_t pg_cnt) {
    ASSERT(pg_cnt > 0 && pg_cnt < 3840);
@@ -175,7 +199,7 @@ void* malloc_page(enum pool_flags pf, uint32_t pg_cnt) {
 /* 从内核物理内存池中申请pg_cnt页内存,
  * 成功则返回其虚拟地址,失败则返回NULL */
 void* get_kernel_pages(uint32_t pg_cnt) {
-   lock_acquire(&kernel_pool.lock);
+   pool_lock(&kernel_pool);
    void* vaddr =  malloc_page(PF_KERNEL, pg_cnt);
    if (vaddr != NULL) {	   // 若分配的地址不为空,将页框清0后返回
       memset(vaddr, 0, pg_cnt * PG_SIZE);
@@ -186,7 +210,7 @@ void* get_kernel_pages(uint32_t pg_cnt) {
 
 /* 在用户空间中申请4k内存,并返回其虚拟地址 */
 void* get_user_pages(uint32_t pg_cnt) {
-   lock_acquire(&user_pool.lock);
+   pool_lock(&user_pool);
    void* vaddr = malloc_page(PF_USER, pg_cnt);
    if (vaddr != NULL) {	   // 若分配的地址不为空,将页框清0后返回
       memset(vaddr, 0, pg_cnt * PG_SIZE);
@@ -198,7 +222,7 @@ void* get_user_pages(uint32_t pg_cnt) {
 /* 将地址vaddr与pf池中的物理地址关联,仅支持一页空间分配 */
 void* get_a_page(enum pool_flags pf, uint32_t vaddr) {
    struct pool* mem_pool = pf & PF_KERNEL ? &kernel_pool : &user_pool;
-   lock_acquire(&mem_pool->lock);
+   pool_lock(mem_pool);
 
    /* 先将虚拟地址对应的位图置1 */
    struct task_struct* cur = running_thread();
@@ -232,7 +256,7 @@ void* get_a_page(enum pool_flags pf, uint32_t vaddr) {
 /* 安装1页大小的vaddr,专门针对fork时虚拟地址位图无须操作的情况 */
 void* get_a_page_without_opvaddrbitmap(enum pool_flags pf, uint32_t vaddr) {
    struct pool* mem_pool = pf & PF_KERNEL ? &kernel_pool : &user_pool;
-   lock_acquire(&mem_pool->lock);
+   pool_lock(mem_pool);
    void* page_phyaddr = palloc(mem_pool);
    if (page_phyaddr == NULL) {
       lock_release(&mem_pool->lock);
@@ -243,6 +267,78 @@ void* get_a_page_without_opvaddrbitmap(enum pool_flags pf, uint32_t vaddr) {
    return (void*)vaddr;
 }
 
+/* fork时把父进程的用户物理页pg_phy_addr只读地映射到当前页表的vaddr处,
+ * 两个进程谁先写谁就在cow_page_fault中得到自己的副本 */
+void cow_page_share(uint32_t vaddr, uint32_t pg_phy_addr) {
+   ASSERT(pg_phy_addr >= user_pool.phy_addr_start);
+   enum intr_status old_status = intr_disable();
+   page_table_map((void*)vaddr, (void*)pg_phy_addr, PG_US_U | PG_RW_R | PG_P_1);
+   user_frame_refs[(pg_phy_addr - user_pool.phy_addr_start) / PG_SIZE]++;
+   intr_set_status(old_status);
+}
+
+/* 处理对写时复制页的写,由缺页异常处理程序调用.
+ * 是写共享页引起的异常返回true,否则返回false */
+bool cow_page_fault(uint32_t vaddr) {
+   struct task_struct* cur = running_thread();
+   if (cur->pgdir == NULL || vaddr >= 0xc0000000) {
+      return false;
+   }
+   uint32_t* pde = pde_ptr(vaddr);
+   uint32_t* pte = pte_ptr(vaddr);
+   /* 只有存在而只读的用户页才是共享页,pde的判断要在pte之前 */
+   if (!(*pde & PG_P_1) || !(*pte & PG_P_1) || (*pte & PG_RW_W)) {
+      return false;
+   }
+   uint32_t pg_phy_addr = *pte & 0xfffff000;
+   if (pg_phy_addr < user_pool.phy_addr_start) {
+      return false;
+   }
+
+   vaddr &= 0xfffff000;
+   uint16_t* refs = &user_frame_refs[(pg_phy_addr - user_pool.phy_addr_start) / PG_SIZE];
+   void* page_phyaddr = NULL;
+   if (*refs > 0) {
+      pool_lock(&user_pool);
+      page_phyaddr = palloc(&user_pool);
+      lock_release(&user_pool.lock);
+      if (page_phyaddr == NULL) {
+	 return false;
+      }
+   }
+
+   /* 等锁时可能有别的进程退出,放弃了共享,所以重新判断 */
+   if (*refs == 0) {
+   /* 共享此页的进程都已经退出或复制过了,直接改为可写 */
+      if (page_phyaddr != NULL) {
+	 free_a_phy_page((uint32_t)page_phyaddr);
+      }
+      *pte |= PG_RW_W;
+      asm volatile ("invlpg %0"::"m" (*(char*)vaddr):"memory");
+   } else {
+      (*refs)--;
+      /* 新页框还没有映射,所以经cow_buf中转 */
+      memcpy(cow_buf, (void*)vaddr, PG_SIZE);
+      *pte = ((uint32_t)page_phyaddr | PG_US_U | PG_RW_W | PG_P_1);
+      asm volatile ("invlpg %0"::"m" (*(char*)vaddr):"memory");
+      memcpy((void*)vaddr, cow_buf, PG_SIZE);
+   }
+   return true;
+}
+
+/* 若用户物理页pg_phy_addr还被别的进程共享,就只减少其引用计数并返回true */
+static bool user_frame_shared(uint32_t pg_phy_addr) {
+   bool shared = false;
+   enum intr_status old_status = intr_disable();
+   uint16_t* refs = &user_frame_refs[(pg_phy_addr - user_pool.phy_addr_start) / PG_SIZE];
+   if (*refs > 0) {
+      (*refs)--;
+      shared = true;
+   }
+   intr_set_status(old_status);
+   return shared;
+}
+
 /* 得到虚拟地址映射到的物理地址 */
 uint32_t addr_v2p(uint32_t vaddr) {
    uint32_t* pte = pte_ptr(vaddr);
@@ -261,6 +357,65 @@ static struct arena* block2arena(struct mem_block* b) {
    return (struct arena*)((uint32_t)b & 0xfffff000);
 }
 
+/* 从desc的free_list中取一批内存块放入线程缓存cache,free_list空了就创建新的arena.
+ * 取走的块在arena中就算作已分配了.调用者须持有内存池的锁 */
+static void cache_refill(struct mem_cache* cache, struct mem_block_desc* desc, enum pool_flags PF) {
+   uint32_t batch = desc->blocks_per_arena < MEM_CACHE_BATCH ? desc->blocks_per_arena : MEM_CACHE_BATCH;
+   struct arena* a;
+   struct mem_block* b;
+   while (cache->cnt < batch) {
+   /* 若mem_block_desc的free_list中已经没有可用的mem_block,
+    * 就创建新的arena提供mem_block */
+      if (list_empty(&desc->free_list)) {
+	 a = malloc_page(PF, 1);       // 分配1页框做为arena
+	 if (a == NULL) {
+	    return;
+	 }
+	 memset(a, 0, PG_SIZE);
+
+    /* 对于分配的小块内存,将desc置为相应内存块描述符, 
+     * cnt置为此arena可用的内存块数,large置为false */
+	 a->desc = desc;
+	 a->large = false;
+	 a->cnt = desc->blocks_per_arena;
+	 uint32_t block_idx;
+
+	 enum intr_status old_status = intr_disable();
+
+	 /* 开始将arena拆分成内存块,并添加到内存块描述符的free_list中 */
+	 for (block_idx = 0; block_idx < desc->blocks_per_arena; block_idx++) {
+	    b = arena2block(a, block_idx);
+	    ASSERT(!elem_find(&a->desc->free_list, &b->free_elem));
+	    list_append(&a->desc->free_list, &b->free_elem);	
+	 }
+	 intr_set_status(old_status);
+      }
+      b = elem2entry(struct mem_block, free_elem, list_pop(&desc->free_list));
+      a = block2arena(b);  // 获取内存块b所在的arena
+      a->cnt--;		   // 将此arena中的空闲内存块数减1
+      list_push(&cache->blocks, &b->free_elem);
+      cache->cnt++;
+   }
+}
+
+/* 将内存块b归还给所在的arena,arena中的块都空闲了就释放arena.调用者须持有内存池的锁 */
+static void block_return(struct mem_block* b, enum pool_flags PF) {
+   struct arena* a = block2arena(b);
+   /* 先将内存块回收到free_list */
+   list_append(&a->desc->free_list, &b->free_elem);
+
+   /* 再判断此arena中的内存块是否都是空闲,如果是就释放arena */
+   if (++a->cnt == a->desc->blocks_per_arena) {
+      uint32_t block_idx;
+      for (block_idx = 0; block_idx < a->desc->blocks_per_arena; block_idx++) {
+	 struct mem_block*  b = arena2block(a, block_idx);
+	 ASSERT(elem_find(&a->desc->free_list, &b->free_elem));
+	 list_remove(&b->free_elem);
+      }
+      mfree_page(PF, a, 1); 
+   } 
+}
+
 /* 在堆中申请size字节内存 */
 void* sys_malloc(uint32_t size) {
    enum pool_flags PF;
@@ -288,11 +443,11 @@ void* sys_malloc(uint32_t size) {
    }
    struct arena* a;
    struct mem_block* b;	
-   lock_acquire(&mem_pool->lock);
 /* 超过最大内存块1024, 就分配页框 */
    if (size > 1024) {
       uint32_t page_cnt = DIV_ROUND_UP(size + sizeof(struct arena), PG_SIZE);    // 向上取整需要的页框数
 
+      pool_lock(mem_pool);
       a = malloc_page(PF, page_cnt);
 
       if (a != NULL) {
@@ -317,41 +472,22 @@ void* sys_malloc(uint32_t size) {
 	    break;
 	 }
       }
-   	       
-   /* 若mem_block_desc的free_list中已经没有可用的mem_block,
-    * 就创建新的arena提供mem_block */
-      if (list_empty(&descs[desc_idx].free_list)) {
-	 a = malloc_page(PF, 1);       // 分配1页框做为arena
-	 if (a == NULL) {
-	    lock_release(&mem_pool->lock);
-	    return NULL;
-	 }
-	 memset(a, 0, PG_SIZE);
 
-    /* 对于分配的小块内存,将desc置为相应内存块描述符, 
-     * cnt置为此arena可用的内存块数,large置为false */
-	 a->desc = &descs[desc_idx];
-	 a->large = false;
-	 a->cnt = descs[desc_idx].blocks_per_arena;
-	 uint32_t block_idx;
-
-	 enum intr_status old_status = intr_disable();
-
-	 /* 开始将arena拆分成内存块,并添加到内存块描述符的free_list中 */
-	 for (block_idx = 0; block_idx < descs[desc_idx].blocks_per_arena; block_idx++) {
-	    b = arena2block(a, block_idx);
-	    ASSERT(!elem_find(&a->desc->free_list, &b->free_elem));
-	    list_append(&a->desc->free_list, &b->free_elem);	
+   /* 先从本线程的缓存中取,缓存空了才加锁从arena中成批取一些过来.
+    * 内核和用户的块分开缓存,进程临时把pgdir置为NULL申请的是内核块 */
+      struct mem_cache* cache = PF == PF_KERNEL ? &cur_thread->k_cache[desc_idx] : &cur_thread->u_cache[desc_idx];
+      if (cache->cnt == 0) {
+	 pool_lock(mem_pool);
+	 cache_refill(cache, &descs[desc_idx], PF);
+	 lock_release(&mem_pool->lock);
+	 if (cache->cnt == 0) {
+	    return NULL;
 	 }
-	 intr_set_status(old_status);
-      }    
+      }
    /* 开始分配内存块 */
-      b = elem2entry(struct mem_block, free_elem, list_pop(&(descs[desc_idx].free_list)));
+      b = elem2entry(struct mem_block, free_elem, list_pop(&cache->blocks));
+      cache->cnt--;
       memset(b, 0, descs[desc_idx].block_size);
-
-      a = block2arena(b);  // 获取内存块b所在的arena
-      a->cnt--;		   // 将此arena中的空闲内存块数减1
-      lock_release(&mem_pool->lock);
       return (void*)b;
    }
 }
@@ -361,6 +497,9 @@ void pfree(uint32_t pg_phy_addr) {
    struct pool* mem_pool;
    uint32_t bit_idx = 0;
    if (pg_phy_addr >= user_pool.phy_addr_start) {     // 用户物理内存池
+      if (user_frame_shared(pg_phy_addr)) {
+	 return;	 // 别的进程还在用,不能回收
+      }
       mem_pool = &user_pool;
       bit_idx = (pg_phy_addr - user_pool.phy_addr_start) / PG_SIZE;
    } else {	  // 内核物理内存池
@@ -455,9 +594,10 @@ void sys_free(void* ptr) {
    if (ptr != NULL) {
       enum pool_flags PF;
       struct pool* mem_pool;
+      struct task_struct* cur_thread = running_thread();
 
    /* 判断是线程还是进程 */
-      if (running_thread()->pgdir == NULL) {
+      if (cur_thread->pgdir == NULL) {
 	 ASSERT((uint32_t)ptr >= K_HEAP_START);
 	 PF = PF_KERNEL; 
 	 mem_pool = &kernel_pool;
@@ -466,28 +606,39 @@ void sys_free(void* ptr) {
 	 mem_pool = &user_pool;
       }
 
-      lock_acquire(&mem_pool->lock);   
       struct mem_block* b = ptr;
       struct arena* a = block2arena(b);	     // 把mem_block转换成arena,获取元信息
       ASSERT(a->large == 0 || a->large == 1);
       if (a->desc == NULL && a->large == true) { // 大于1024的内存
+	 pool_lock(mem_pool);
 	 mfree_page(PF, a, a->cnt); 
-      } else {				 // 小于等于1024的内存块
-	 /* 先将内存块回收到free_list */
-	 list_append(&a->desc->free_list, &b->free_elem);
-
-	 /* 再判断此arena中的内存块是否都是空闲,如果是就释放arena */
-	 if (++a->cnt == a->desc->blocks_per_arena) {
-	    uint32_t block_idx;
-	    for (block_idx = 0; block_idx < a->desc->blocks_per_arena; block_idx++) {
-	       struct mem_block*  b = arena2block(a, block_idx);
-               ASSERT(elem_find(&a->desc->free_list, &b->free_elem));
-	       list_remove(&b->free_elem);
-	    }
-	    mfree_page(PF, a, 1); 
-	 } 
-      }   
-      lock_release(&mem_pool->lock); 
+	 lock_release(&mem_pool->lock); 
+	 return;
+      }
+
+      /* 小于等于1024的内存块先放回本线程的缓存.
+       * fork前父进程分配的块,其arena的desc不在本进程的描述符数组中,直接还给arena */
+      uint32_t desc_idx = a->desc - (PF == PF_KERNEL ? k_block_descs : cur_thread->u_block_desc);
+      if (desc_idx >= DESC_CNT) {
+	 pool_lock(mem_pool);
+	 block_return(b, PF);
+	 lock_release(&mem_pool->lock); 
+	 return;
+      }
+      struct mem_cache* cache = PF == PF_KERNEL ? &cur_thread->k_cache[desc_idx] : &cur_thread->u_cache[desc_idx];
+      list_push(&cache->blocks, &b->free_elem);
+      cache->cnt++;
+
+      /* 缓存的块太多了,就成批还给arena,以便arena能被回收 */
+      if (cache->cnt >= MEM_CACHE_BATCH * 2) {
+	 pool_lock(mem_pool);
+	 while (cache->cnt > MEM_CACHE_BATCH) {
+	    b = elem2entry(struct mem_block, free_elem, list_pop(&cache->blocks));
+	    cache->cnt--;
+	    block_return(b, PF);
+	 }
+	 lock_release(&mem_pool->lock); 
+      }
    }
 }
 
@@ -540,10 +691,6 @@ static void mem_pool_init(uint32_t all_mem) {
    put_str(" user_pool_phy_addr_start:");put_int(user_pool.phy_addr_start);
    put_str("\n");
 
-   /* 将位图置0*/
-   bitmap_init(&kernel_pool.pool_bitmap);
-   bitmap_init(&user_pool.pool_bitmap);
-
    lock_init(&kernel_pool.lock);
    lock_init(&user_pool.lock);
 
@@ -554,6 +701,15 @@ static void mem_pool_init(uint32_t all_mem) {
    kernel_vaddr.vaddr_bitmap.bits = (void*)(MEM_BITMAP_BASE + kbm_length + ubm_length);
 
    kernel_vaddr.vaddr_start = K_HEAP_START;
+
+  /* 三个位图的第二级位图依次放在内核虚拟地址位图之后,按4字节对齐 */
+   uint32_t summary_base = DIV_ROUND_UP((MEM_BITMAP_BASE + kbm_length * 2 + ubm_length), 4) * 4;
+   kernel_pool.pool_bitmap.summary = (uint32_t*)summary_base;
+   user_pool.pool_bitmap.summary = (uint32_t*)(summary_base + BITMAP_SUMMARY_BYTES(kbm_length));
+   kernel_vaddr.vaddr_bitmap.summary = (uint32_t*)(summary_base + BITMAP_SUMMARY_BYTES(kbm_length) + BITMAP_SUMMARY_BYTES(ubm_length));
+
+   bitmap_init(&kernel_pool.pool_bitmap);
+   bitmap_init(&user_pool.pool_bitmap);
    bitmap_init(&kernel_vaddr.vaddr_bitmap);
    put_str("   mem_pool_init done\n");
 }
@@ -575,11 +731,38 @@ void block_desc_init(struct mem_block_desc* desc_array) {
    }
 }
 
+/* 初始化线程的内存块缓存caches */
+void mem_cache_init(struct mem_cache* caches) {
+   uint16_t desc_idx;
+   for (desc_idx = 0; desc_idx < DESC_CNT; desc_idx++) {
+      list_init(&caches[desc_idx].blocks);
+      caches[desc_idx].cnt = 0;
+   }
+}
+
+/* 把缓存caches中的内存块全部还给pf内存池的arena,线程退出时调用 */
+void mem_cache_drain(struct mem_cache* caches, enum pool_flags pf) {
+   struct pool* mem_pool = pf == PF_KERNEL ? &kernel_pool : &user_pool;
+   uint16_t desc_idx;
+   pool_lock(mem_pool);
+   for (desc_idx = 0; desc_idx < DESC_CNT; desc_idx++) {
+      while (caches[desc_idx].cnt > 0) {
+	 struct mem_block* b = elem2entry(struct mem_block, free_elem, list_pop(&caches[desc_idx].blocks));
+	 caches[desc_idx].cnt--;
+	 block_return(b, pf);
+      }
+   }
+   lock_release(&mem_pool->lock);
+}
+
 /* 根据物理页框地址pg_phy_addr在相应的内存池的位图清0,不改动页表*/
 void free_a_phy_page(uint32_t pg_phy_addr) {
    struct pool* mem_pool;
    uint32_t bit_idx = 0;
    if (pg_phy_addr >= user_pool.phy_addr_start) {
+      if (user_frame_shared(pg_phy_addr)) {
+	 return;
+      }
       mem_pool = &user_pool;
       bit_idx = (pg_phy_addr - user_pool.phy_addr_start) / PG_SIZE;
    } else {
@@ -594,6 +777,19 @@ void mem_init() {
    put_str("mem_init start\n");
    uint32_t mem_bytes_total = (*(uint32_t*)(0xb00));
    mem_pool_init(mem_bytes_total);	  // 初始化内存池
+
+/* 给写时复制准备页框引用计数和中转页 */
+   uint32_t refs_pg_cnt = DIV_ROUND_UP((user_pool.pool_size / PG_SIZE * sizeof(uint16_t)), PG_SIZE);
+   user_frame_refs = malloc_page(PF_KERNEL, refs_pg_cnt);
+   cow_buf = malloc_page(PF_KERNEL, 1);
+   ASSERT(user_frame_refs != NULL && cow_buf != NULL);
+   memset(user_frame_refs, 0, refs_pg_cnt * PG_SIZE);
+
+/* 置cr0的WP位,使内核写只读的用户页时同样引发缺页异常,
+ * 否则内核写共享页(如read到用户缓冲区)会改了别的进程的数据 */
+   uint32_t cr0;
+   asm volatile ("movl %%cr0, %0" : "=r" (cr0));
+   asm volatile ("movl %0, %%cr0" : : "r" (cr0 | 0x00010000) : "memory");
 /* 初始化mem_block_desc数组descs,为malloc做准备 */
    block_desc_init(k_block_descs);
    put_str("mem_init done\n");
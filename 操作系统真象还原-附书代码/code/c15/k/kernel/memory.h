@@ -39,6 +39,15 @@ struct mem_block_desc {
 
 #define DESC_CNT 7
 
+/* 线程私有的空闲内存块缓存,每种规格一个.
+ * 小块内存的分配和释放先在这里进行,不用获取内存池的锁 */
+struct mem_cache {
+   struct list blocks;		 // 缓存的mem_block
+   uint32_t cnt;		 // blocks中内存块的数量
+};
+
+#define MEM_CACHE_BATCH 8	 // 缓存与arena之间一次转移的内存块数量
+
 extern struct pool kernel_pool, user_pool;
 void mem_init(void);
 void* get_kernel_pages(uint32_t pg_cnt);
@@ -56,4 +65,9 @@ void pfree(uint32_t pg_phy_addr);
 void sys_free(void* ptr);
 void* get_a_page_without_opvaddrbitmap(enum pool_flags pf, uint32_t vaddr);
 void free_a_phy_page(uint32_t pg_phy_addr);
+void cow_page_share(uint32_t vaddr, uint32_t pg_phy_addr);
+bool cow_page_fault(uint32_t vaddr);
+void mem_cache_init(struct mem_cache* caches);
+void mem_cache_drain(struct mem_cache* caches, enum pool_flags pf);
+uint32_t mem_lock_contended(enum pool_flags pf);
 #endif
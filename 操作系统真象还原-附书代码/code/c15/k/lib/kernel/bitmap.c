@@ -5,9 +5,64 @@
 #include "interrupt.h"
 #include "debug.h"
 
+#define WORD_FULL 0xffffffff
+
+/* 返回x中最低的1所在的位,x不能为0 */
+static inline uint32_t bsf(uint32_t x) {
+   uint32_t idx;
+   asm ("bsfl %1, %0" : "=r" (idx) : "rm" (x));
+   return idx;
+}
+
+/* 读出位图中第word_idx个32位字,超出btmp_bytes_len的部分按1(已占用)处理 */
+static uint32_t word_get(struct bitmap* btmp, uint32_t word_idx) {
+   uint32_t byte_idx = word_idx * 4;
+   if (byte_idx + 4 <= btmp->btmp_bytes_len) {
+      return *(uint32_t*)(btmp->bits + byte_idx);
+   }
+   uint32_t word = WORD_FULL;
+   uint32_t i = 0;
+   while (byte_idx + i < btmp->btmp_bytes_len) {
+      word &= ~((uint32_t)0xff << (i * 8));
+      word |= (uint32_t)btmp->bits[byte_idx + i] << (i * 8);
+      i++;
+   }
+   return word;
+}
+
+/* 按第word_idx个字是否已满更新summary中对应的位 */
+static void summary_update(struct bitmap* btmp, uint32_t word_idx) {
+   if (btmp->summary == NULL) {
+      return;
+   }
+   uint32_t mask = BITMAP_MASK << (word_idx % 32);
+   if (word_get(btmp, word_idx) == WORD_FULL) {
+      btmp->summary[word_idx / 32] |= mask;
+   } else {
+      btmp->summary[word_idx / 32] &= ~mask;
+   }
+}
+
 /* 将位图btmp初始化 */
 void bitmap_init(struct bitmap* btmp) {
    memset(btmp->bits, 0, btmp->btmp_bytes_len);   
+   bitmap_summarize(btmp);
+}
+
+/* 由bits重建summary并让next_word回到开头,
+ * 用于bits不是经bitmap_set修改的场合,如从硬盘读入位图之后 */
+void bitmap_summarize(struct bitmap* btmp) {
+   btmp->next_word = 0;
+   if (btmp->summary == NULL) {
+      return;
+   }
+   uint32_t words = BITMAP_WORDS(btmp->btmp_bytes_len);
+   /* 最后一组中多出来的位不对应任何字,置1当作满字跳过 */
+   memset(btmp->summary, 0xff, BITMAP_SUMMARY_BYTES(btmp->btmp_bytes_len));
+   uint32_t word_idx = 0;
+   while (word_idx < words) {
+      summary_update(btmp, word_idx++);
+   }
 }
 
 /* 判断bit_idx位是否为1,若为1则返回true，否则返回false */
@@ -17,49 +72,92 @@ bool bitmap_scan_test(struct bitmap* btmp, uint32_t bit_idx) {
    return (btmp->bits[byte_idx] & (BITMAP_MASK << bit_odd));
 }
 
-/* 在位图中申请连续cnt个位,返回其起始位下标 */
-int bitmap_scan(struct bitmap* btmp, uint32_t cnt) {
-   uint32_t idx_byte = 0;	 // 用于记录空闲位所在的字节
-/* 先逐字节比较,蛮力法 */
-   while (( 0xff == btmp->bits[idx_byte]) && (idx_byte < btmp->btmp_bytes_len)) {
-/* 1表示该位已分配,所以若为0xff,则表示该字节内已无空闲位,向下一字节继续找 */
-      idx_byte++;
-   }
-
-   ASSERT(idx_byte < btmp->btmp_bytes_len);
-   if (idx_byte == btmp->btmp_bytes_len) {  // 若该内存池找不到可用空间		
-      return -1;
-   }
-
- /* 若在位图数组范围内的某字节内找到了空闲位，
-  * 在该字节内逐位比对,返回空闲位的索引。*/
-   int idx_bit = 0;
- /* 和btmp->bits[idx_byte]这个字节逐位对比 */
-   while ((uint8_t)(BITMAP_MASK << idx_bit) & btmp->bits[idx_byte]) { 
-	 idx_bit++;
-   }
-	 
-   int bit_idx_start = idx_byte * 8 + idx_bit;    // 空闲位在位图内的下标
-   if (cnt == 1) {
-      return bit_idx_start;
+/* 从第word_idx个字起找第一个未满的字,找不到则返回word_end */
+static uint32_t next_free_word(struct bitmap* btmp, uint32_t word_idx, uint32_t word_end) {
+   while (word_idx < word_end) {
+      if (btmp->summary != NULL) {
+	 /* 本组32个字中从word_idx起还未满的字 */
+	 uint32_t not_full = ~btmp->summary[word_idx / 32] >> (word_idx % 32);
+	 if (not_full == 0) {
+	    word_idx = (word_idx / 32 + 1) * 32;
+	    continue;
+	 }
+	 word_idx += bsf(not_full);
+	 if (word_idx >= word_end) {
+	    break;
+	 }
+      }
+      if (word_get(btmp, word_idx) != WORD_FULL) {
+	 return word_idx;
+      }
+      word_idx++;
    }
+   return word_end;
+}
 
-   uint32_t bit_left = (btmp->btmp_bytes_len * 8 - bit_idx_start);   // 记录还有多少位可以判断
-   uint32_t next_bit = bit_idx_start + 1;
-   uint32_t count = 1;	      // 用于记录找到的空闲位的个数
+/* 在第word_start到第word_end(不含)个字中找连续cnt个空闲位,
+ * 返回其起始位下标,找不到则返回-1 */
+static int scan_words(struct bitmap* btmp, uint32_t cnt, uint32_t word_start, uint32_t word_end) {
+   uint32_t run_start = 0;	// 当前这段连续空闲位的起始位下标
+   uint32_t run_len = 0;	// 当前这段连续空闲位的长度
+   uint32_t word_idx = word_start;
+   while (word_idx < word_end) {
+      /* 不在一段空闲位中时,已满的字可以整个跳过 */
+      if (run_len == 0) {
+	 word_idx = next_free_word(btmp, word_idx, word_end);
+	 if (word_idx == word_end) {
+	    break;
+	 }
+      }
 
-   bit_idx_start = -1;	      // 先将其置为-1,若找不到连续的位就直接返回
-   while (bit_left-- > 0) {
-      if (!(bitmap_scan_test(btmp, next_bit))) {	 // 若next_bit为0
-	 count++;
+      uint32_t word = word_get(btmp, word_idx);
+      if (word == 0) {
+	 if (run_len == 0) {
+	    run_start = word_idx * 32;
+	 }
+	 run_len += 32;
+      } else if (word == WORD_FULL) {
+	 run_len = 0;
       } else {
-	 count = 0;
+      /* 字内用bsf一段一段地找: 一段0接到当前空闲段上,一段1则使其中断 */
+	 uint32_t bit_odd = 0;
+	 while (bit_odd < 32 && run_len < cnt) {
+	    uint32_t rest = word >> bit_odd;
+	    uint32_t len;
+	    if (rest & BITMAP_MASK) {
+	       len = bsf(~rest);	  // word不全为1,所以~rest不为0
+	       run_len = 0;
+	    } else {
+	       len = rest ? bsf(rest) : 32 - bit_odd;
+	       if (run_len == 0) {
+		  run_start = word_idx * 32 + bit_odd;
+	       }
+	       run_len += len;
+	    }
+	    bit_odd += len;
+	 }
       }
-      if (count == cnt) {	    // 若找到连续的cnt个空位
-	 bit_idx_start = next_bit - cnt + 1;
-	 break;
+
+      if (run_len >= cnt) {
+	 btmp->next_word = (run_start + cnt) / 32;
+	 return run_start;
       }
-      next_bit++;          
+      word_idx++;
+   }
+   return -1;
+}
+
+/* 在位图中申请连续cnt个位,返回其起始位下标,找不到则返回-1.
+ * 按next-fit从上次分配结束的字开始找,到末尾后再从头找. */
+int bitmap_scan(struct bitmap* btmp, uint32_t cnt) {
+   uint32_t words = BITMAP_WORDS(btmp->btmp_bytes_len);
+   uint32_t hint = btmp->next_word < words ? btmp->next_word : 0;
+
+   int bit_idx_start = scan_words(btmp, cnt, hint, words);
+   if (bit_idx_start == -1 && hint != 0) {
+   /* 从头再找,要多找几个字,以包括从hint之前开始、跨过hint的空闲段 */
+      uint32_t word_end = hint + cnt / 32 + 2;
+      bit_idx_start = scan_words(btmp, cnt, 0, word_end < words ? word_end : words);
    }
    return bit_idx_start;
 }
@@ -77,5 +175,5 @@ void bitmap_set(struct bitmap* btmp, uint32_t bit_idx, int8_t value) {
    } else {		      // 若为0
       btmp->bits[byte_idx] &= ~(BITMAP_MASK << bit_odd);
    }
+   summary_update(btmp, bit_idx / 32);
 }
-
@@ -2,13 +2,24 @@
 #define __LIB_KERNEL_BITMAP_H
 #include "global.h"
 #define BITMAP_MASK 1
+
+/* 查找空闲位时以32位字为单位,不足一字的尾部按已占用处理.
+ * 第二级位图summary中的一位对应bits中的一个字,为1表示该字已满,
+ * 这样一次就能跳过32个满字(1024位). */
+#define BITMAP_WORDS(bytes_len) (((bytes_len) + 3) / 4)				// 位图占多少个32位字
+#define BITMAP_SUMMARY_OFF(bytes_len) (BITMAP_WORDS(bytes_len) * 4)		// summary紧跟在bits后面时相对bits的偏移
+#define BITMAP_SUMMARY_BYTES(bytes_len) ((BITMAP_WORDS(bytes_len) + 31) / 32 * 4)	// summary的字节数
+
 struct bitmap {
    uint32_t btmp_bytes_len;
 /* 在遍历位图时,整体上以字节为单位,细节上是以位为单位,所以此处位图的指针必须是单字节 */
    uint8_t* bits;
+   uint32_t* summary;	  // 第二级位图,可以为NULL,须在bitmap_init或bitmap_summarize之前设置
+   uint32_t next_word;	  // next-fit: 下次从这个字开始找,避免每次都从头扫过已分配的部分
 };
 
 void bitmap_init(struct bitmap* btmp);
+void bitmap_summarize(struct bitmap* btmp);
 bool bitmap_scan_test(struct bitmap* btmp, uint32_t bit_idx);
 int bitmap_scan(struct bitmap* btmp, uint32_t cnt);
 void bitmap_set(struct bitmap* btmp, uint32_t bit_idx, int8_t value);
@@ -131,6 +131,8 @@ void init_thread(struct task_struct* pthread, char* name, int prio) {
    }
    pthread->cwd_inode_nr = 0;	    // 以根目录做为默认工作路径
    pthread->parent_pid = -1;        // -1表示没有父进程
+   mem_cache_init(pthread->k_cache);
+   mem_cache_init(pthread->u_cache);
    pthread->stack_magic = 0x19870916;	  // 自定义的魔数
 }
 
@@ -306,10 +308,20 @@ void sys_ps(void) {
    char* ps_title = "PID            PPID           STAT           TICKS          COMMAND\n";
    sys_write(stdout_no, ps_title, strlen(ps_title));
    list_traversal(&thread_all_list, elem2thread_info, 0);
+
+   /* 附带打印内核和用户内存池的锁争用次数 */
+   char out_buf[64] = {0};
+   sprintf(out_buf, "mem pool lock contended: kernel %d, user %d\n", \
+	 mem_lock_contended(PF_KERNEL), mem_lock_contended(PF_USER));
+   sys_write(stdout_no, out_buf, strlen(out_buf));
 }
 
 /* 回收thread_over的pcb和页表,并将其从调度队列中去除 */
 void thread_exit(struct task_struct* thread_over, bool need_schedule) {
+   /* 缓存的内核块还给内核内存池,否则随pcb一起丢了.
+    * 要获取锁,所以在关中断之前 */
+   mem_cache_drain(thread_over->k_cache, PF_KERNEL);
+
    /* 要保证schedule在关中断情况下调用 */
    intr_disable();
    thread_over->status = TASK_DIED;
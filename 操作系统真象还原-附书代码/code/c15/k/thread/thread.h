@@ -93,6 +93,8 @@ struct task_struct {
    uint32_t* pgdir;              // 进程自己页表的虚拟地址
    struct virtual_addr userprog_vaddr;   // 用户进程的虚拟地址
    struct mem_block_desc u_block_desc[DESC_CNT];   // 用户进程内存块描述符
+   struct mem_cache k_cache[DESC_CNT];	// 本线程缓存的内核堆空闲内存块
+   struct mem_cache u_cache[DESC_CNT];	// 本线程缓存的用户堆空闲内存块
    int32_t fd_table[MAX_FILES_OPEN_PER_PROC];	// 已打开文件数组
    uint32_t cwd_inode_nr;	 // 进程所在的工作目录的inode编号
    pid_t parent_pid;		 // 父进程pid
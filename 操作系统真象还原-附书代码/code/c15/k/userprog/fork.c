@@ -22,21 +22,39 @@ static int32_t copy_pcb_vaddrbitmap_stack0(struct task_struct* child_thread, str
    child_thread->general_tag.prev = child_thread->general_tag.next = NULL;
    child_thread->all_list_tag.prev = child_thread->all_list_tag.next = NULL;
    block_desc_init(child_thread->u_block_desc);
+   mem_cache_init(child_thread->k_cache);	  // 缓存的链表头还是父进程的,不能用
+   mem_cache_init(child_thread->u_cache);
 /* b 复制父进程的虚拟地址池的位图 */
-   uint32_t bitmap_pg_cnt = DIV_ROUND_UP((0xc0000000 - USER_VADDR_START) / PG_SIZE / 8 , PG_SIZE);
-   void* vaddr_btmp = get_kernel_pages(bitmap_pg_cnt);
+   void* vaddr_btmp = get_kernel_pages(USER_VADDR_BITMAP_PG_CNT);
    if (vaddr_btmp == NULL) return -1;
    /* 此时child_thread->userprog_vaddr.vaddr_bitmap.bits还是指向父进程虚拟地址的位图地址
     * 下面将child_thread->userprog_vaddr.vaddr_bitmap.bits指向自己的位图vaddr_btmp */
-   memcpy(vaddr_btmp, child_thread->userprog_vaddr.vaddr_bitmap.bits, bitmap_pg_cnt * PG_SIZE);
+   memcpy(vaddr_btmp, child_thread->userprog_vaddr.vaddr_bitmap.bits, USER_VADDR_BITMAP_PG_CNT * PG_SIZE);
    child_thread->userprog_vaddr.vaddr_bitmap.bits = vaddr_btmp;
+   /* 第二级位图随位图一起复制过来了,指针也要跟着指向自己的 */
+   child_thread->userprog_vaddr.vaddr_bitmap.summary = (uint32_t*)((uint8_t*)vaddr_btmp + BITMAP_SUMMARY_OFF(USER_VADDR_BITMAP_LEN));
    /* 调试用 */
 //   ASSERT(strlen(child_thread->name) < 11);	// pcb.name的长度是16,为避免下面strcat越界
 //   strcat(child_thread->name,"_fork");
    return 0;
 }
 
-/* 复制子进程的进程体(代码和数据)及用户栈 */
+/* 在子进程页表中只读地映射batch中的cnt个页,batch中依次是虚拟地址和物理地址 */
+static void share_pages(struct task_struct* child_thread, struct task_struct* parent_thread, uint32_t* batch, uint32_t cnt) {
+   /* 将页表切换到子进程,目的是在子进程的页表中安装pte及pde */
+   page_dir_activate(child_thread);
+   uint32_t idx = 0;
+   while (idx < cnt) {
+      cow_page_share(batch[idx * 2], batch[idx * 2 + 1]);
+      idx++;
+   }
+   /* 恢复父进程页表,重新加载cr3也使父进程tlb中可写的旧页表项失效 */
+   page_dir_activate(parent_thread);
+}
+
+/* 与子进程共享进程体(代码和数据)及用户栈.
+ * 不复制数据,而是把父子进程的页都设为只读,谁先写谁在缺页异常中得到自己的副本.
+ * 为减少切换页表的次数,先将要共享的页攒在buf_page中,攒满一批才切换到子进程页表一次 */
 static void copy_body_stack3(struct task_struct* child_thread, struct task_struct* parent_thread, void* buf_page) {
    uint8_t* vaddr_btmp = parent_thread->userprog_vaddr.vaddr_bitmap.bits;
    uint32_t btmp_bytes_len = parent_thread->userprog_vaddr.vaddr_bitmap.btmp_bytes_len;
@@ -44,6 +62,9 @@ static void copy_body_stack3(struct task_struct* child_thread, struct task_struc
    uint32_t idx_byte = 0;
    uint32_t idx_bit = 0;
    uint32_t prog_vaddr = 0;
+   uint32_t* batch = buf_page;
+   uint32_t batch_cnt = 0;
+   uint32_t* pte = NULL;
 
    /* 在父进程的用户空间中查找已有数据的页 */
    while (idx_byte < btmp_bytes_len) {
@@ -52,28 +73,27 @@ static void copy_body_stack3(struct task_struct* child_thread, struct task_struc
 	 while (idx_bit < 8) {
 	    if ((BITMAP_MASK << idx_bit) & vaddr_btmp[idx_byte]) {
 	       prog_vaddr = (idx_byte * 8 + idx_bit) * PG_SIZE + vaddr_start;
-	 /* 下面的操作是将父进程用户空间中的数据通过内核空间做中转,最终复制到子进程的用户空间 */
-
-	       /* a 将父进程在用户空间中的数据复制到内核缓冲区buf_page,
-	       目的是下面切换到子进程的页表后,还能访问到父进程的数据*/
-	       memcpy(buf_page, (void*)prog_vaddr, PG_SIZE);
 
-	       /* b 将页表切换到子进程,目的是避免下面申请内存的函数将pte及pde安装在父进程的页表中 */
-	       page_dir_activate(child_thread);
-	       /* c 申请虚拟地址prog_vaddr */
-	       get_a_page_without_opvaddrbitmap(PF_USER, prog_vaddr);
-
-	       /* d 从内核缓冲区中将父进程数据复制到子进程的用户空间 */
-	       memcpy((void*)prog_vaddr, buf_page, PG_SIZE);
-
-	       /* e 恢复父进程页表 */
-	       page_dir_activate(parent_thread);
+	       /* a 父进程的页改为只读,记下其物理地址,切换到子进程页表后就访问不到父进程的页表了 */
+	       pte = pte_ptr(prog_vaddr);
+	       *pte &= ~PG_RW_W;
+	       batch[batch_cnt * 2] = prog_vaddr;
+	       batch[batch_cnt * 2 + 1] = *pte & 0xfffff000;
+
+	       /* b 攒满一批就映射到子进程中 */
+	       if (++batch_cnt == PG_SIZE / 8) {
+		  share_pages(child_thread, parent_thread, batch, batch_cnt);
+		  batch_cnt = 0;
+	       }
 	    }
 	    idx_bit++;
 	 }
       }
       idx_byte++;
    }
+   if (batch_cnt > 0) {
+      share_pages(child_thread, parent_thread, batch, batch_cnt);
+   }
 }
 
 /* 为子进程构建thread_stack和修改返回值 */
@@ -130,7 +150,7 @@ static void update_inode_open_cnts(struct task_struct* thread) {
 
 /* 拷贝父进程本身所占资源给子进程 */
 static int32_t copy_process(struct task_struct* child_thread, struct task_struct* parent_thread) {
-   /* 内核缓冲区,作为父进程用户空间的数据复制到子进程用户空间的中转 */
+   /* 内核缓冲区,存放要与子进程共享的页 */
    void* buf_page = get_kernel_pages(1);
    if (buf_page == NULL) {
       return -1;
@@ -147,7 +167,7 @@ static int32_t copy_process(struct task_struct* child_thread, struct task_struct
       return -1;
    }
 
-   /* c 复制父进程进程体及用户栈给子进程 */
+   /* c 与子进程共享父进程进程体及用户栈 */
    copy_body_stack3(child_thread, parent_thread, buf_page);
 
    /* d 构建子进程thread_stack和修改返回值pid */
@@ -87,9 +87,9 @@ uint32_t* create_page_dir(void) {
 /* 创建用户进程虚拟地址位图 */
 void create_user_vaddr_bitmap(struct task_struct* user_prog) {
    user_prog->userprog_vaddr.vaddr_start = USER_VADDR_START;
-   uint32_t bitmap_pg_cnt = DIV_ROUND_UP((0xc0000000 - USER_VADDR_START) / PG_SIZE / 8 , PG_SIZE);
-   user_prog->userprog_vaddr.vaddr_bitmap.bits = get_kernel_pages(bitmap_pg_cnt);
-   user_prog->userprog_vaddr.vaddr_bitmap.btmp_bytes_len = (0xc0000000 - USER_VADDR_START) / PG_SIZE / 8;
+   user_prog->userprog_vaddr.vaddr_bitmap.bits = get_kernel_pages(USER_VADDR_BITMAP_PG_CNT);
+   user_prog->userprog_vaddr.vaddr_bitmap.btmp_bytes_len = USER_VADDR_BITMAP_LEN;
+   user_prog->userprog_vaddr.vaddr_bitmap.summary = (uint32_t*)(user_prog->userprog_vaddr.vaddr_bitmap.bits + BITMAP_SUMMARY_OFF(USER_VADDR_BITMAP_LEN));
    bitmap_init(&user_prog->userprog_vaddr.vaddr_bitmap);
 }
 
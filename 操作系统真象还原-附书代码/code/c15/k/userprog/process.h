@@ -5,6 +5,9 @@
 #define default_prio 31
 #define USER_STACK3_VADDR  (0xc0000000 - 0x1000)
 #define USER_VADDR_START 0x8048000
+/* 用户进程虚拟地址位图的字节数,以及位图连同紧跟其后的第二级位图所占的页数 */
+#define USER_VADDR_BITMAP_LEN ((0xc0000000 - USER_VADDR_START) / PG_SIZE / 8)
+#define USER_VADDR_BITMAP_PG_CNT DIV_ROUND_UP((BITMAP_SUMMARY_OFF(USER_VADDR_BITMAP_LEN) + BITMAP_SUMMARY_BYTES(USER_VADDR_BITMAP_LEN)), PG_SIZE)
 void process_execute(void* filename, char* name);
 void start_process(void* filename_);
 void process_activate(struct task_struct* p_thread);
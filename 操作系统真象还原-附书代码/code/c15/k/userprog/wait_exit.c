@@ -9,6 +9,7 @@
 #include "fs.h"
 #include "file.h"
 #include "pipe.h"
+#include "process.h"
 
 /* 释放用户进程资源: 
  * 1 页表中对应的物理页
@@ -27,6 +28,9 @@ static void release_prog_resource(struct task_struct* release_thread) {
    uint32_t* first_pte_vaddr_in_pde = NULL;	// 用来记录pde中第0个pte的地址
    uint32_t pg_phy_addr = 0;
 
+   /* 缓存的用户块先还给arena,此时还在本进程的页表下 */
+   mem_cache_drain(release_thread->u_cache, PF_USER);
+
    /* 回收页表中用户空间的页框 */
    while (pde_idx < user_pde_nr) {
       v_pde_ptr = pgdir_vaddr + pde_idx;
@@ -52,9 +56,8 @@ static void release_prog_resource(struct task_struct* release_thread) {
    }
 
    /* 回收用户虚拟地址池所占的物理内存*/
-   uint32_t bitmap_pg_cnt = (release_thread->userprog_vaddr.vaddr_bitmap.btmp_bytes_len) / PG_SIZE;
    uint8_t* user_vaddr_pool_bitmap = release_thread->userprog_vaddr.vaddr_bitmap.bits;
-   mfree_page(PF_KERNEL, user_vaddr_pool_bitmap, bitmap_pg_cnt);
+   mfree_page(PF_KERNEL, user_vaddr_pool_bitmap, USER_VADDR_BITMAP_PG_CNT);
 
    /* 关闭进程打开的文件 */
    uint8_t local_fd = 3;